@@ -0,0 +1,292 @@
+#include "auditengine.h"
+#include "breachedcorpus.h"
+#include "PasswordGenerator/pwgenerator.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+
+/**
+ * Constructor
+ * @param pDatabase         Opened persistence to read the accounts from.
+ */
+AuditEngine::AuditEngine(Persistence *pDatabase) :
+    m_pDatabase(pDatabase),
+    m_pCorpus(nullptr),
+    m_staleDays(365),
+    m_sketchUsed(0),
+    m_accountCount(0),
+    m_breachedCount(0),
+    m_policyCount(0),
+    m_staleCount(0),
+    m_reusedCount(0),
+    m_reuseGroupCount(0),
+    m_uncheckedReuseCount(0)
+{
+
+}
+
+/**
+ * Checks all accounts of a user. The results of a previous run are
+ * dropped.
+ * @param userId
+ * @return              True if all accounts were checked.
+ */
+bool AuditEngine::run(const QVariant &userId)
+{
+    m_fingerprintKey = QByteArray(16, 0);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(m_fingerprintKey.data()), 4);
+    m_planMap.clear();
+    m_sketch.fill(SketchSlot { 0, 0, 0 }, m_sketchSlots);
+    m_sketchUsed = 0;
+    m_reuseGroupMap.clear();
+    m_staleHeap.clear();
+    m_accountCount = 0;
+    m_breachedCount = 0;
+    m_policyCount = 0;
+    m_staleCount = 0;
+    m_reusedCount = 0;
+    m_reuseGroupCount = 0;
+    m_uncheckedReuseCount = 0;
+    m_breachedList.clear();
+    m_policyList.clear();
+    m_staleList.clear();
+    m_reuseGroupList.clear();
+    m_stageTimeList.clear();
+    m_error.clear();
+
+    OptionTable searchObj;
+    searchObj.insert('U', userId);
+    QList<char> optionList = QList<char>() << 'i' << 'p' << 'u' << 'k' << 'l' << 's' << 't';
+    for (char option : optionList) {
+        searchObj.insert(option, QVariant());
+    }
+    QDateTime staleBefore = QDateTime::currentDateTime().addDays(-m_staleDays);
+    QElapsedTimer totalTimer;
+    QElapsedTimer checkTimer;
+    qint64 checkTime = 0;
+    totalTimer.start();
+    bool isDone = m_pDatabase->streamAccountsLike(searchObj, [&](const QList<QVariantMap>& accountList) {
+        checkTimer.start();
+        checkBatch(accountList, staleBefore);
+        checkTime += checkTimer.elapsed();
+        return true;
+    });
+    m_sketch.clear();
+    m_sketch.squeeze();
+    if (! isDone || m_pDatabase->hasError()) {
+        m_error.append(QString("Could not read accounts !\n")).append(m_pDatabase->error());
+        return false;
+    }
+    m_stageTimeList << qMakePair(QString("read"), totalTimer.elapsed() - checkTime);
+    m_stageTimeList << qMakePair(QString("check"), checkTime);
+    QElapsedTimer reportTimer;
+    reportTimer.start();
+    finishReport();
+    m_stageTimeList << qMakePair(QString("report"), reportTimer.elapsed());
+
+    return true;
+}
+
+/**
+ * Private
+ * Checks one batch of accounts in parallel. The plans are looked up
+ * before, so the parallel part only reads shared data.
+ * @param accountList
+ * @param staleBefore       Accounts modified before are stale.
+ */
+void AuditEngine::checkBatch(const QList<QVariantMap> &accountList, const QDateTime &staleBefore)
+{
+    QString idName = m_pDatabase->optionToRealName('i');
+    QString passwordName = m_pDatabase->optionToRealName('k');
+    QString lastModifyName = m_pDatabase->optionToRealName('t');
+    QVector<Check> checkList(accountList.size());
+    for (int index=0; index<accountList.size(); ++index) {
+        Check& check = checkList[index];
+        check.pAccount = &accountList[index];
+        check.pPlan = planFor(accountList[index]);
+        check.fingerprint.accountId = accountList[index].value(idName).toLongLong();
+    }
+    const BreachedCorpus* pCorpus = m_pCorpus;
+    const QByteArray& key = m_fingerprintKey;
+    QtConcurrent::blockingMap(checkList, [&](Check& check) {
+        QString password = check.pAccount->value(passwordName).toString();
+        check.hasPassword = ! password.isEmpty();
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(key);
+        hash.addData(password.toUtf8());
+        check.fingerprint.value = qFromLittleEndian<quint64>(hash.result().constData());
+        check.violatesPolicy = check.pPlan != nullptr && ! check.pPlan->accepts(password);
+        check.isBreached = pCorpus != nullptr && check.hasPassword && pCorpus->contains(password);
+        QDateTime lastModify = check.pAccount->value(lastModifyName).toDateTime();
+        check.isStale = ! lastModify.isValid() || lastModify < staleBefore;
+    });
+    for (const Check& check : checkList) {
+        if (check.hasPassword) {
+            addFingerprint(check.fingerprint);
+        }
+        if (check.isBreached) {
+            ++m_breachedCount;
+            if (m_breachedList.size() < m_maxReported) {
+                m_breachedList << reportedAccount(*check.pAccount);
+            }
+        }
+        if (check.violatesPolicy) {
+            ++m_policyCount;
+            if (m_policyList.size() < m_maxReported) {
+                m_policyList << reportedAccount(*check.pAccount);
+            }
+        }
+        if (check.isStale) {
+            ++m_staleCount;
+            addStale(*check.pAccount, check.pAccount->value(lastModifyName).toDateTime());
+        }
+    }
+    m_accountCount += accountList.size();
+}
+
+/**
+ * Private
+ * Gets the plan for the length and definition of an account. Accounts
+ * without length or with a definition which cannot be compiled are not
+ * checked against a policy.
+ * @param account
+ * @return plan             The plan or nullptr.
+ */
+const PasswordPlan *AuditEngine::planFor(const QVariantMap &account)
+{
+    QVariant length = account.value(m_pDatabase->optionToRealName('l'));
+    if (length.isNull() || length.toInt() < 1) {
+        return nullptr;
+    }
+    QString definition = account.value(m_pDatabase->optionToRealName('s')).toString();
+    QString key = QString::number(length.toInt()).append(':').append(definition);
+    QHash<QString, QSharedPointer<const PasswordPlan>>::const_iterator iter = m_planMap.constFind(key);
+    if (iter == m_planMap.constEnd()) {
+        PwGenerator generator;
+        iter = m_planMap.insert(key, generator.planFor(static_cast<ushort>(length.toInt()), definition));
+    }
+
+    return iter.value().data();
+}
+
+/**
+ * Private
+ * Looks up a fingerprint in the sketch. The slot is found by linear
+ * probing from the low bits of the fingerprint, which is a keyed hash
+ * already. A fingerprint seen before makes a reuse. The first accounts
+ * of the first groups are kept for the report. A new fingerprint is
+ * not taken into a sketch filled up to 3/4.
+ * @param fingerprint
+ */
+void AuditEngine::addFingerprint(const Fingerprint &fingerprint)
+{
+    const int mask = m_sketchSlots - 1;
+    int index = static_cast<int>(fingerprint.value & static_cast<quint64>(mask));
+    while (m_sketch[index].count > 0 && m_sketch[index].value != fingerprint.value) {
+        index = (index + 1) & mask;
+    }
+    SketchSlot& slot = m_sketch[index];
+    if (slot.count == 0) {
+        if (m_sketchUsed >= m_sketchSlots / 4 * 3) {
+            ++m_uncheckedReuseCount;
+            return;
+        }
+        slot.value = fingerprint.value;
+        slot.firstAccountId = fingerprint.accountId;
+        slot.count = 1;
+        ++m_sketchUsed;
+        return;
+    }
+    ++slot.count;
+    if (slot.count == 2) {
+        ++m_reuseGroupCount;
+        m_reusedCount += 2;
+        if (m_reuseGroupMap.size() < m_maxReported) {
+            m_reuseGroupMap.insert(fingerprint.value, QList<qint64>() << slot.firstAccountId << fingerprint.accountId);
+        }
+        return;
+    }
+    ++m_reusedCount;
+    QHash<quint64, QList<qint64>>::iterator iter = m_reuseGroupMap.find(fingerprint.value);
+    if (iter != m_reuseGroupMap.end() && iter.value().size() < m_maxReported) {
+        iter.value() << fingerprint.accountId;
+    }
+}
+
+/**
+ * Private
+ * Keeps the oldest stale accounts in a heap with the newest on top.
+ * @param account
+ * @param lastModify
+ */
+void AuditEngine::addStale(const QVariantMap &account, const QDateTime &lastModify)
+{
+    if (m_staleHeap.size() >= m_maxReported) {
+        if (! isOlder(StaleAccount { lastModify, QVariantMap() }, m_staleHeap.first())) {
+            return;
+        }
+        std::pop_heap(m_staleHeap.begin(), m_staleHeap.end(), isOlder);
+        m_staleHeap.removeLast();
+    }
+    m_staleHeap << StaleAccount { lastModify, reportedAccount(account) };
+    std::push_heap(m_staleHeap.begin(), m_staleHeap.end(), isOlder);
+}
+
+/**
+ * Private
+ * Builds the lists of the report: the stale accounts oldest first and
+ * the reuse groups ordered by their ids.
+ */
+void AuditEngine::finishReport()
+{
+    std::sort_heap(m_staleHeap.begin(), m_staleHeap.end(), isOlder);
+    for (const StaleAccount& stale : m_staleHeap) {
+        m_staleList << stale.account;
+    }
+    m_staleHeap.clear();
+    for (QList<qint64> group : m_reuseGroupMap) {
+        std::sort(group.begin(), group.end());
+        m_reuseGroupList << group;
+    }
+    m_reuseGroupMap.clear();
+    std::sort(m_reuseGroupList.begin(), m_reuseGroupList.end());
+}
+
+/**
+ * Private
+ * Orders stale accounts by their last modify. Accounts without last
+ * modify are the oldest.
+ * @param first
+ * @param second
+ * @return              True if the first is older.
+ */
+bool AuditEngine::isOlder(const StaleAccount &first, const StaleAccount &second)
+{
+    if (! second.lastModify.isValid()) {
+        return false;
+    }
+
+    return ! first.lastModify.isValid() || first.lastModify < second.lastModify;
+}
+
+/**
+ * Private
+ * Takes the attributes of an account which are shown in a report.
+ * Never the password.
+ * @param account
+ * @return
+ */
+QVariantMap AuditEngine::reportedAccount(const QVariantMap &account) const
+{
+    QVariantMap reported;
+    QList<char> optionList = QList<char>() << 'i' << 'p' << 'u';
+    for (char option : optionList) {
+        QString name = m_pDatabase->optionToRealName(option);
+        reported.insert(name, account.value(name));
+    }
+
+    return reported;
+}
@@ -0,0 +1,122 @@
+#ifndef AUDITENGINE_H
+#define AUDITENGINE_H
+
+/* -----------------------------------------------------------------------
+ * Class AuditEngine
+ * -----------------------------------------------------------------------
+ * Checks all accounts of a user in one pass. The accounts are streamed
+ * from the persistence in batches. Each batch is checked in parallel:
+ * - Reuse: a keyed 64 bit fingerprint of each password is looked up in
+ *   a table of fixed size (the sketch). A fingerprint seen before counts
+ *   the account as reused. If the sketch is full, new fingerprints are
+ *   not taken; their accounts are counted as not checked for reuse.
+ * - Policy: the password must comply with the length and character
+ *   definition stored with the account (see PasswordPlan::accepts()).
+ * - Staleness: last modify older than a number of days.
+ * - Breach: optional lookup in a list of breached passwords.
+ * Passwords are dropped after their batch is checked. Each finding is
+ * counted. Only a bounded number of found accounts and reuse groups is
+ * kept for the report, the oldest of the stale ones. So the memory does
+ * not grow with the number of accounts.
+ * The time of each stage is measured.
+ */
+
+#include "Persistence/persistence.h"
+#include "PasswordGenerator/passwordplan.h"
+#include <QSharedPointer>
+#include <QDateTime>
+#include <QPair>
+
+class BreachedCorpus;
+
+class AuditEngine
+{
+public:
+    AuditEngine(Persistence* pDatabase);
+
+    void setBreachedCorpus(const BreachedCorpus* pCorpus)   { m_pCorpus = pCorpus; }
+    void setStaleDays(const int days)                       { m_staleDays = days; }
+    bool run(const QVariant& userId);
+
+    // Results of the last run. Found accounts hold id, provider and username.
+    // The lists hold at most maxReported() accounts or groups.
+    int accountCount() const                                { return m_accountCount; }
+    int breachedCount() const                               { return m_breachedCount; }
+    int policyCount() const                                 { return m_policyCount; }
+    int staleCount() const                                  { return m_staleCount; }
+    int reusedCount() const                                 { return m_reusedCount; }
+    int reuseGroupCount() const                             { return m_reuseGroupCount; }
+    int uncheckedReuseCount() const                         { return m_uncheckedReuseCount; }
+    const QList<QVariantMap>& breachedList() const          { return m_breachedList; }
+    const QList<QVariantMap>& policyList() const            { return m_policyList; }
+    // The oldest stale accounts, oldest first.
+    const QList<QVariantMap>& staleList() const             { return m_staleList; }
+    const QList<QList<qint64>>& reuseGroupList() const      { return m_reuseGroupList; }
+    static int maxReported()                                { return m_maxReported; }
+    // Stage name and elapsed milliseconds in the order of the stages.
+    const QList<QPair<QString, qint64>>& stageTimeList() const  { return m_stageTimeList; }
+
+    // Error messages
+    QString error() const                                   { return m_error; }
+    bool hasError() const                                   { return ! m_error.isEmpty(); }
+
+private:
+    struct Fingerprint {
+        quint64 value;
+        qint64 accountId;
+    };
+    // Slot of the sketch. Empty with count 0.
+    struct SketchSlot {
+        quint64 value;
+        qint64 firstAccountId;
+        quint32 count;
+    };
+    struct StaleAccount {
+        QDateTime lastModify;
+        QVariantMap account;
+    };
+    struct Check {
+        const QVariantMap* pAccount;
+        const PasswordPlan* pPlan;
+        Fingerprint fingerprint;
+        bool hasPassword;
+        bool isBreached;
+        bool violatesPolicy;
+        bool isStale;
+    };
+
+    Persistence* m_pDatabase;
+    const BreachedCorpus* m_pCorpus;
+    int m_staleDays;
+    QByteArray m_fingerprintKey;
+    QHash<QString, QSharedPointer<const PasswordPlan>> m_planMap;
+    QVector<SketchSlot> m_sketch;
+    int m_sketchUsed;
+    QHash<quint64, QList<qint64>> m_reuseGroupMap;
+    QVector<StaleAccount> m_staleHeap;
+    int m_accountCount;
+    int m_breachedCount;
+    int m_policyCount;
+    int m_staleCount;
+    int m_reusedCount;
+    int m_reuseGroupCount;
+    int m_uncheckedReuseCount;
+    QList<QVariantMap> m_breachedList;
+    QList<QVariantMap> m_policyList;
+    QList<QVariantMap> m_staleList;
+    QList<QList<qint64>> m_reuseGroupList;
+    QList<QPair<QString, qint64>> m_stageTimeList;
+    QString m_error;
+    static const int m_maxReported = 100;
+    static const int m_sketchSlots = 1 << 18;      // 6 MB, filled up to 3/4
+
+    void checkBatch(const QList<QVariantMap>& accountList, const QDateTime& staleBefore);
+    const PasswordPlan* planFor(const QVariantMap& account);
+    void addFingerprint(const Fingerprint& fingerprint);
+    void addStale(const QVariantMap& account, const QDateTime& lastModify);
+    void finishReport();
+    static bool isOlder(const StaleAccount& first, const StaleAccount& second);
+    QVariantMap reportedAccount(const QVariantMap& account) const;
+};
+
+#endif // AUDITENGINE_H
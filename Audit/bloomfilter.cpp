@@ -0,0 +1,174 @@
+#include "bloomfilter.h"
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cmath>
+#include <limits>
+
+static const quint32 BloomMagic = 0x50574246;      // "PWBF"
+static const int BloomHeaderLength = 4 + 8 + 8 + 4;
+static const quint32 BloomMaxHashCount = 64;
+
+/**
+ * Constructor
+ * Creates an empty filter.
+ */
+BloomFilter::BloomFilter() :
+    m_pBits(nullptr),
+    m_bitCount(0),
+    m_hashCount(0)
+{
+
+}
+
+/**
+ * Destructor
+ */
+BloomFilter::~BloomFilter()
+{
+    m_file.close();
+}
+
+/**
+ * Allocates an empty filter in memory sized for a number of entries and
+ * a false positive rate.
+ * @param entryCount
+ * @param falsePositiveRate
+ */
+void BloomFilter::reset(const quint64 entryCount, const double falsePositiveRate)
+{
+    const double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(qMax<quint64>(entryCount, 1)) * std::log(falsePositiveRate) / (ln2 * ln2);
+    const quint64 maxBitCount = static_cast<quint64>(std::numeric_limits<int>::max() - 7) * 8;
+    m_bitCount = qMin((static_cast<quint64>(bits) + 63) & ~static_cast<quint64>(63), maxBitCount);
+    m_hashCount = qMax<quint32>(1, static_cast<quint32>(std::lround(bits / qMax<quint64>(entryCount, 1) * ln2)));
+    m_file.close();
+    m_bits = QByteArray(static_cast<int>(m_bitCount / 8), 0);
+    m_pBits = reinterpret_cast<const uchar*>(m_bits.constData());
+}
+
+/**
+ * Inserts a digest into an in memory filter.
+ * @param pDigest           Pointer to at least 16 bytes of digest.
+ */
+void BloomFilter::insert(const char *pDigest)
+{
+    quint64 position;
+    quint64 step;
+    positions(pDigest, position, step);
+    uchar* pBits = reinterpret_cast<uchar*>(m_bits.data());
+    for (quint32 index=0; index<m_hashCount; ++index) {
+        quint64 bit = position % m_bitCount;
+        pBits[bit >> 3] |= static_cast<uchar>(1 << (bit & 7));
+        position += step;
+    }
+}
+
+/**
+ * Tests a digest. False means the digest was never inserted. True means
+ * it may have been inserted.
+ * @param pDigest           Pointer to at least 16 bytes of digest.
+ * @return
+ */
+bool BloomFilter::mightContain(const char *pDigest) const
+{
+    if (m_bitCount == 0) {
+        return true;
+    }
+    quint64 position;
+    quint64 step;
+    positions(pDigest, position, step);
+    for (quint32 index=0; index<m_hashCount; ++index) {
+        quint64 bit = position % m_bitCount;
+        if ((m_pBits[bit >> 3] & (1 << (bit & 7))) == 0) {
+            return false;
+        }
+        position += step;
+    }
+
+    return true;
+}
+
+/**
+ * Writes the filter to a file. The file is replaced at once, so a
+ * failed write leaves no partial filter behind.
+ * @param filePath
+ * @param tag               A value identifying the data the filter was built from.
+ * @param errorMsg          Takes the reason if the file could not be written.
+ * @return                  True if done.
+ */
+bool BloomFilter::save(const QString &filePath, const quint64 tag, QString &errorMsg) const
+{
+    QSaveFile file(filePath);
+    if (! file.open(QIODevice::WriteOnly)) {
+        errorMsg = file.errorString();
+        return false;
+    }
+    QDataStream outStream(&file);
+    outStream << BloomMagic << tag << m_bitCount << m_hashCount;
+    outStream.writeRawData(reinterpret_cast<const char*>(m_pBits), static_cast<int>(m_bitCount / 8));
+    if (outStream.status() != QDataStream::Ok) {
+        errorMsg = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if (! file.commit()) {
+        errorMsg = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Maps a filter file into memory. The tag must be the one given when
+ * the filter was saved. Otherwise the filter is outdated. A file with a
+ * bit count or hash count which save() never writes is rejected.
+ * @param filePath
+ * @param tag
+ * @return                  True if the filter could be loaded.
+ */
+bool BloomFilter::load(const QString &filePath, const quint64 tag)
+{
+    m_file.close();
+    m_file.setFileName(filePath);
+    if (! m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream inStream(&m_file);
+    quint32 magic;
+    quint64 fileTag;
+    quint64 bitCount;
+    quint32 hashCount;
+    inStream >> magic >> fileTag >> bitCount >> hashCount;
+    if (magic != BloomMagic || fileTag != tag || bitCount == 0 || bitCount % 64 != 0 ||
+        hashCount == 0 || hashCount > BloomMaxHashCount ||
+        m_file.size() != BloomHeaderLength + static_cast<qint64>(bitCount / 8)) {
+        m_file.close();
+        return false;
+    }
+    const uchar* pData = m_file.map(0, m_file.size());
+    if (pData == nullptr) {
+        m_file.close();
+        return false;
+    }
+    m_bits.clear();
+    m_pBits = pData + BloomHeaderLength;
+    m_bitCount = bitCount;
+    m_hashCount = hashCount;
+
+    return true;
+}
+
+/**
+ * Private
+ * Start position and step for double hashing taken from the digest.
+ * @param pDigest
+ * @param first
+ * @param step
+ */
+void BloomFilter::positions(const char *pDigest, quint64 &first, quint64 &step) const
+{
+    first = qFromLittleEndian<quint64>(pDigest);
+    step = qFromLittleEndian<quint64>(pDigest + 8) | 1;
+}
@@ -0,0 +1,42 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+/* -----------------------------------------------------------------------
+ * Class BloomFilter
+ * -----------------------------------------------------------------------
+ * A Bloom filter over digests of a cryptographic hash function (SHA-1,
+ * MD4). The bit positions are derived by double hashing from the first
+ * 16 bytes of the digest itself, so no further hashing is needed.
+ * A filter is either built in memory and saved to a file or loaded from
+ * a file. A loaded filter is memory mapped and read only.
+ * Lookups are thread safe.
+ */
+
+#include <QByteArray>
+#include <QFile>
+
+class BloomFilter
+{
+public:
+    BloomFilter();
+    ~BloomFilter();
+
+    void reset(const quint64 entryCount, const double falsePositiveRate);
+    void insert(const char* pDigest);
+    bool mightContain(const char* pDigest) const;
+    bool isEmpty() const                                { return m_bitCount == 0; }
+
+    bool save(const QString& filePath, const quint64 tag, QString& errorMsg) const;
+    bool load(const QString& filePath, const quint64 tag);
+
+private:
+    QByteArray m_bits;
+    QFile m_file;
+    const uchar* m_pBits;
+    quint64 m_bitCount;
+    quint32 m_hashCount;
+
+    void positions(const char* pDigest, quint64& first, quint64& step) const;
+};
+
+#endif // BLOOMFILTER_H
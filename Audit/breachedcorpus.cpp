@@ -0,0 +1,321 @@
+#include "breachedcorpus.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDateTime>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+static const quint32 IndexMagic = 0x50574958;      // "PWIX"
+static const char HexDigits[] = "0123456789ABCDEF";
+
+/**
+ * Decodes one upper or lower case hex digit.
+ * @param digit
+ * @return          Value of digit or 0 for other characters.
+ */
+static inline int hexValue(const char digit)
+{
+    if (digit >= '0' && digit <= '9') {
+        return digit - '0';
+    }
+    if (digit >= 'A' && digit <= 'F') {
+        return digit - 'A' + 10;
+    }
+    if (digit >= 'a' && digit <= 'f') {
+        return digit - 'a' + 10;
+    }
+
+    return 0;
+}
+
+/**
+ * Constructor
+ */
+BreachedCorpus::BreachedCorpus() :
+    m_pData(nullptr),
+    m_size(0),
+    m_hashType(Sha1),
+    m_hexLength(40)
+{
+
+}
+
+/**
+ * Destructor
+ * Unmaps and closes the list.
+ */
+BreachedCorpus::~BreachedCorpus()
+{
+    m_file.close();
+}
+
+/**
+ * Opens and maps a list of breached password hashes. Loads or builds
+ * the prefix index.
+ * @param filePath      Path of the sorted hash list.
+ * @return              True if the list can be used.
+ */
+bool BreachedCorpus::open(const QString &filePath)
+{
+    m_file.setFileName(filePath);
+    if (! m_file.open(QIODevice::ReadOnly)) {
+        m_error.append(QString("Could not open list of breached passwords !\n"));
+        m_error.append(m_file.errorString()).append('\n');
+        return false;
+    }
+    m_size = m_file.size();
+    m_pData = m_size > 0 ? reinterpret_cast<const char*>(m_file.map(0, m_size)) : nullptr;
+    if (m_pData == nullptr) {
+        m_error.append(QString("Could not map list of breached passwords !\n"));
+        m_error.append(m_file.errorString()).append('\n');
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    madvise(const_cast<char*>(m_pData), static_cast<size_t>(m_size), MADV_RANDOM);
+#endif
+    const char* pEnd = static_cast<const char*>(std::memchr(m_pData, ':', static_cast<size_t>(qMin<qint64>(m_size, 64))));
+    m_hexLength = pEnd == nullptr ? 0 : static_cast<int>(pEnd - m_pData);
+    if (m_hexLength == 40) {
+        m_hashType = Sha1;
+    } else if (m_hexLength == 32) {
+        m_hashType = Ntlm;
+    } else {
+        m_error.append(QString("File is not a list of SHA-1 or NTLM hashes !\n"));
+        m_pData = nullptr;
+        return false;
+    }
+    if (! loadPrefixIndex()) {
+        buildPrefixIndex();
+        QFile indexFile(filePath + QString(".idx"));
+        if (indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QDataStream outStream(&indexFile);
+            outStream << IndexMagic << fileTag() << m_prefixIndex;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Enables the Bloom filter in front of the list. It is loaded from
+ * <list>.bloom or built with a full pass over the list and saved.
+ * Building takes a while for large lists but is done once. A filter
+ * which can not be saved is used anyway; the reason is in error().
+ * @return              True if the filter is used.
+ */
+bool BreachedCorpus::useBloomFilter()
+{
+    if (m_pData == nullptr) {
+        return false;
+    }
+    QString filePath = m_file.fileName() + QString(".bloom");
+    if (m_bloomFilter.load(filePath, fileTag())) {
+        return true;
+    }
+    if (! buildBloomFilter()) {
+        return false;
+    }
+    QString saveError;
+    if (! m_bloomFilter.save(filePath, fileTag(), saveError)) {
+        m_error.append(QString("Could not write Bloom filter %1 !\n").arg(filePath));
+        m_error.append(saveError).append('\n');
+    }
+
+    return true;
+}
+
+/**
+ * Tests if a password is in the list of breached passwords.
+ * Thread safe.
+ * @param password
+ * @return              True if the hash of password was found.
+ */
+bool BreachedCorpus::contains(const QString &password) const
+{
+    if (m_pData == nullptr) {
+        return false;
+    }
+    QByteArray digest = digestOf(password);
+    if (! m_bloomFilter.isEmpty() && ! m_bloomFilter.mightContain(digest.constData())) {
+        return false;
+    }
+    char hex[40];
+    for (int index=0; index<m_hexLength / 2; ++index) {
+        uchar byte = static_cast<uchar>(digest[index]);
+        hex[2 * index] = HexDigits[byte >> 4];
+        hex[2 * index + 1] = HexDigits[byte & 0x0f];
+    }
+    int prefix = (static_cast<uchar>(digest[0]) << 8) | static_cast<uchar>(digest[1]);
+    qint64 end = m_prefixIndex[prefix + 1];
+    qint64 position = lowerBound(hex, m_hexLength, m_prefixIndex[prefix], end);
+
+    return position < end && m_size - position >= m_hexLength &&
+            std::memcmp(m_pData + position, hex, static_cast<size_t>(m_hexLength)) == 0;
+}
+
+/**
+ * Private
+ * Hash of a password as used in the list. SHA-1 of the UTF-8 bytes or
+ * NTLM (MD4 of the UTF-16LE bytes).
+ * @param password
+ * @return digest
+ */
+QByteArray BreachedCorpus::digestOf(const QString &password) const
+{
+    if (m_hashType == Ntlm) {
+        QByteArray utf16(password.size() * 2, 0);
+        for (int index=0; index<password.size(); ++index) {
+            ushort character = password.at(index).unicode();
+            utf16[2 * index] = static_cast<char>(character & 0xff);
+            utf16[2 * index + 1] = static_cast<char>(character >> 8);
+        }
+        return QCryptographicHash::hash(utf16, QCryptographicHash::Md4);
+    }
+
+    return QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha1);
+}
+
+/**
+ * Private
+ * Loads the prefix index from <list>.idx if it belongs to the list.
+ * @return              True if loaded.
+ */
+bool BreachedCorpus::loadPrefixIndex()
+{
+    QFile indexFile(m_file.fileName() + QString(".idx"));
+    if (! indexFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream inStream(&indexFile);
+    quint32 magic;
+    quint64 tag;
+    inStream >> magic >> tag >> m_prefixIndex;
+    if (inStream.status() != QDataStream::Ok || magic != IndexMagic || tag != fileTag() ||
+        m_prefixIndex.size() != PrefixCount + 1) {
+        m_prefixIndex.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Builds the prefix index with a binary search for the first line of
+ * each 16 bit prefix. Each search starts at the previous prefix.
+ */
+void BreachedCorpus::buildPrefixIndex()
+{
+    m_prefixIndex.resize(PrefixCount + 1);
+    qint64 begin = 0;
+    for (int prefix=0; prefix<PrefixCount; ++prefix) {
+        char key[4] = { HexDigits[(prefix >> 12) & 0x0f], HexDigits[(prefix >> 8) & 0x0f],
+                        HexDigits[(prefix >> 4) & 0x0f], HexDigits[prefix & 0x0f] };
+        begin = lowerBound(key, 4, begin, m_size);
+        m_prefixIndex[prefix] = begin;
+    }
+    m_prefixIndex[PrefixCount] = m_size;
+}
+
+/**
+ * Private
+ * Builds the Bloom filter with a sequential pass over the list.
+ * @return              True if done.
+ */
+bool BreachedCorpus::buildBloomFilter()
+{
+#ifdef Q_OS_UNIX
+    madvise(const_cast<char*>(m_pData), static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+#endif
+    m_bloomFilter.reset(static_cast<quint64>(m_size / (m_hexLength + 4)), 0.01);
+    char digest[20];
+    qint64 position = 0;
+    while (m_size - position >= m_hexLength) {
+        const char* pLine = m_pData + position;
+        for (int index=0; index<m_hexLength / 2; ++index) {
+            digest[index] = static_cast<char>((hexValue(pLine[2 * index]) << 4) | hexValue(pLine[2 * index + 1]));
+        }
+        m_bloomFilter.insert(digest);
+        position = nextLine(position);
+    }
+#ifdef Q_OS_UNIX
+    madvise(const_cast<char*>(m_pData), static_cast<size_t>(m_size), MADV_RANDOM);
+#endif
+
+    return ! m_bloomFilter.isEmpty();
+}
+
+/**
+ * Private
+ * A value which changes when the list file is replaced. Identifies the
+ * list in index and Bloom filter file.
+ * @return
+ */
+quint64 BreachedCorpus::fileTag() const
+{
+    QFileInfo info(m_file);
+
+    return static_cast<quint64>(m_size) * 1000003u + static_cast<quint64>(info.lastModified().toMSecsSinceEpoch());
+}
+
+/**
+ * Private
+ * Binary search over the lines between two line starts. Finds the first
+ * line which is not less than the key. Only the first characters of a
+ * line up to the key length are compared.
+ * @param pKey          Upper case hex key.
+ * @param keyLength
+ * @param begin         Start of first line of range.
+ * @param end           Start of line after the range.
+ * @return              Start of the first line not less than the key.
+ */
+qint64 BreachedCorpus::lowerBound(const char *pKey, const int keyLength, qint64 begin, qint64 end) const
+{
+    while (begin < end) {
+        qint64 start = lineStart(begin + (end - begin) / 2, begin);
+        bool isLess = m_size - start >= keyLength &&
+                std::memcmp(m_pData + start, pKey, static_cast<size_t>(keyLength)) < 0;
+        if (isLess) {
+            begin = nextLine(start);
+        } else {
+            end = start;
+        }
+    }
+
+    return begin;
+}
+
+/**
+ * Private
+ * Start of the line which holds a position. Does not go before begin.
+ * @param position
+ * @param begin
+ * @return
+ */
+qint64 BreachedCorpus::lineStart(qint64 position, const qint64 begin) const
+{
+    while (position > begin && m_pData[position - 1] != '\n') {
+        --position;
+    }
+
+    return position;
+}
+
+/**
+ * Private
+ * Start of the line following a position. Or the end of the file.
+ * @param position
+ * @return
+ */
+qint64 BreachedCorpus::nextLine(qint64 position) const
+{
+    const void* pNewLine = std::memchr(m_pData + position, '\n', static_cast<size_t>(m_size - position));
+    if (pNewLine == nullptr) {
+        return m_size;
+    }
+
+    return static_cast<const char*>(pNewLine) - m_pData + 1;
+}
@@ -0,0 +1,66 @@
+#ifndef BREACHEDCORPUS_H
+#define BREACHEDCORPUS_H
+
+/* -----------------------------------------------------------------------
+ * Class BreachedCorpus
+ * -----------------------------------------------------------------------
+ * Looks up passwords in a local list of breached password hashes. The
+ * list has the format of the offline dumps of 'Have I Been Pwned'. Each
+ * line holds a hash in upper case hex followed by a colon and a count.
+ * The lines are sorted by hash. SHA-1 and NTLM lists are supported. The
+ * kind of list is recognized by the length of the first hash.
+ *
+ * The file is memory mapped. A prefix index holds the offset of the first
+ * line for each value of the first 16 bits of a hash. A lookup does a
+ * binary search over the bytes between two index entries. The index is
+ * stored next to the list (<list>.idx) and is built on first use.
+ * An optional Bloom filter (<list>.bloom) answers most lookups of hashes
+ * which are not in the list without touching the list at all.
+ *
+ * After open() all lookups are read only and thread safe.
+ */
+
+#include "bloomfilter.h"
+#include <QFile>
+#include <QVector>
+
+class BreachedCorpus
+{
+public:
+    BreachedCorpus();
+    ~BreachedCorpus();
+
+    enum HashType { Sha1, Ntlm };
+
+    bool open(const QString& filePath);
+    bool useBloomFilter();
+    bool contains(const QString& password) const;
+    HashType hashType() const                           { return m_hashType; }
+
+    // Error messages
+    QString error() const                               { return m_error; }
+    bool hasError() const                               { return ! m_error.isEmpty(); }
+
+private:
+    enum { PrefixCount = 65536 };
+
+    QFile m_file;
+    const char* m_pData;
+    qint64 m_size;
+    HashType m_hashType;
+    int m_hexLength;
+    QVector<qint64> m_prefixIndex;
+    BloomFilter m_bloomFilter;
+    QString m_error;
+
+    QByteArray digestOf(const QString& password) const;
+    bool loadPrefixIndex();
+    void buildPrefixIndex();
+    bool buildBloomFilter();
+    quint64 fileTag() const;
+    qint64 lowerBound(const char* pKey, const int keyLength, qint64 begin, qint64 end) const;
+    qint64 lineStart(qint64 position, const qint64 begin) const;
+    qint64 nextLine(qint64 position) const;
+};
+
+#endif // BREACHEDCORPUS_H
@@ -1,22 +1,32 @@
 #include "appcommand.h"
+#include "optionregistry.h"
 
 
 /**
  * Constructor
+ * Looks up the command in the static command table. Unknown commands
+ * lead to the help command.
  * @param parameter The first parameter of command line input.
  */
 AppCommand::AppCommand(const int argc, const char * const argv[]) :
+    m_command(Help),
     m_optionAll(false),
     m_isHelpNeeded(false),
+    m_pAppPath(argv[0]),
     m_requiredParameter(0),
     m_allowedParameter(0)
 {
-    if (argc < 2) {
-        m_command = Help;
-    } else {
-        m_command = parseCommand(QString(argv[1]));
+    const OptionRegistry::CommandSpec* pSpec = nullptr;
+    if (argc >= 2) {
+        pSpec = OptionRegistry::findCommand(argv[1]);
     }
-    m_appName = applicationName(argv[0]);
+    if (pSpec == nullptr) {
+        pSpec = OptionRegistry::findCommand(Help);
+    }
+    m_command = pSpec->command;
+    m_requiredParameter = pSpec->requiredParameter;
+    m_allowedParameter = pSpec->allowedParameter;
+    m_optionSet = pSpec->options;
 }
 
 /**
@@ -28,145 +38,109 @@ AppCommand::~AppCommand()
 }
 
 /**
- * Creates a set of options to the command given
- * throuh the constructor.
- * @return list     A list of all options which can be processed from the command.
+ * Takes the switch options '-h' and '-a' out of the parsed options.
+ * @param optionTable
  */
-QList<OptionDefinition> AppCommand::commandsOptions()
+void AppCommand::takeSwitches(OptionTable &optionTable)
 {
-    QHash<char, QStringList> helpMap = optionsHelpTextMap();
-    QList<OptionDefinition> list;
-    list << OptionDefinition('h', &m_isHelpNeeded, QString("help")).setHelpTextLines(helpMap.value('h'));
-    switch (m_command) {
-    case New:
-        list << OptionDefinition('p', NeedArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('u', NeedArgument).setHelpTextLines(helpMap.value('u'));
-        list << OptionDefinition('k', OptionalArgument).setHelpTextLines(helpMap.value('k'));
-        list << OptionDefinition('l', NeedArgument).setHelpTextLines(helpMap.value('l'));
-        list << OptionDefinition('s', NeedArgument).setHelpTextLines(helpMap.value('s'));
-        list << OptionDefinition('q', OptionalArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('r', OptionalArgument, QVariant::String, QString(), QString("answer"))
-                .setHelpTextLines(helpMap.value('r'));
-        break;
-    case GeneratePW:
-        list << OptionDefinition('i', NeedArgument, QVariant::Int).setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('p', NeedArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('u', NeedArgument).setHelpTextLines(helpMap.value('u'));
-        list << OptionDefinition('l', NeedArgument, QVariant::Int).setHelpTextLines(helpMap.value('l'));
-        list << OptionDefinition('s', NeedArgument).setHelpTextLines(helpMap.value('s'));
-        break;
-    case Show:
-        list << OptionDefinition('i', OptionalArgument, QVariant::Int).setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('p', OptionalArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('u', OptionalArgument).setHelpTextLines(helpMap.value('u'));
-        list << OptionDefinition('k', OptionalArgument).setHelpTextLines(helpMap.value('k'));
-        list << OptionDefinition('l', OptionalArgument, QVariant::Int).setHelpTextLines(helpMap.value('l'));
-        list << OptionDefinition('s', OptionalArgument).setHelpTextLines(helpMap.value('s'));
-        list << OptionDefinition('q', OptionalArgument).setHelpTextLines(helpMap.value('q'));
-        list << OptionDefinition('t', OptionalArgument, QVariant::DateTime).setHelpTextLines(helpMap.value('t'));
-        list << OptionDefinition('r', OptionalArgument, QVariant::String, QString(), QString("answer"))
-                .setHelpTextLines(helpMap.value('r'));
-        list << OptionDefinition('a', &m_optionAll, QString("all")).setHelpTextLines(helpMap.value('a'));
-        break;
-    case Modify:
-        list << OptionDefinition('i', NeedArgument, QVariant::Int).setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('p', NeedArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('u', NeedArgument).setHelpTextLines(helpMap.value('u'));
-        list << OptionDefinition('k', NeedArgument).setHelpTextLines(helpMap.value('k'));
-        list << OptionDefinition('l', NeedArgument, QVariant::Int).setHelpTextLines(helpMap.value('l'));
-        list << OptionDefinition('s', NeedArgument).setHelpTextLines(helpMap.value('s'));
-        list << OptionDefinition('q', NeedArgument).setHelpTextLines(helpMap.value('q'));
-        list << OptionDefinition('r', NeedArgument, QVariant::String, QString(), QString("answer"))
-                .setHelpTextLines(helpMap.value('r'));
-        break;
-    case Remove:
-        list << OptionDefinition('i', NeedArgument).setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('p', NeedArgument).setHelpTextLines(helpMap.value('p'));
-        list << OptionDefinition('u', NeedArgument).setHelpTextLines(helpMap.value('u'));
-        break;
-    case File:
-        list << OptionDefinition('f', NeedArgument, QVariant::String, QString(), QString("file"))
-                .setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('o', NoArgument, QVariant::Invalid, QString(), QString("out"))
-                .setHelpTextLines(helpMap.value('o'));
-        list << OptionDefinition('g', NoArgument, QVariant::Invalid, QString(), QString("in"))
-                .setHelpTextLines(helpMap.value('g'));
-        list << OptionDefinition('v', NoArgument, QVariant::Invalid, QString(), QString("readable"))
-                .setHelpTextLines(helpMap.value('v'));
-        break;
-    case Find:
-        m_requiredParameter = 1;
-        m_allowedParameter = 1;
-        break;
-    case User:
-        list << OptionDefinition('n', NoArgument, QVariant::Invalid, QString(), QString("name"))
-                .setHelpTextLines(helpMap.value('n'));
-        list << OptionDefinition('i', NoArgument, QVariant::Invalid, QString(), QString("id"))
-                .setHelpTextLines(helpMap.value('i'));
-        list << OptionDefinition('m', NoArgument, QVariant::Invalid, QString(), QString("email"))
-                .setHelpTextLines(helpMap.value('m'));
-        list << OptionDefinition('x', NoArgument, QVariant::Invalid, QString(), QString("active"))
-                .setHelpTextLines(helpMap.value('x'));
-        break;
-    default:
-        break;
+    if (optionTable.contains('h')) {
+        optionTable.remove('h');
+        m_isHelpNeeded = true;
+    }
+    if (m_command == Show && optionTable.contains('a')) {
+        optionTable.remove('a');
+        m_optionAll = true;
     }
-
-    return list;
 }
 
 /**
  * Get help text to command or in general.
+ * @param withOptions     Append the help texts of the commands options.
  * @return
  */
-QStringList AppCommand::getHelpText(const QList<OptionDefinition>& optionList) const
+QStringList AppCommand::getHelpText(const bool withOptions) const
 {
+    QString appName = applicationName(m_pAppPath);
     QStringList list;
     switch (m_command) {
     case New:
-        list << QString(m_appName).append(" new -p <provider> -u <username> [other options]\n");
-        list << "Insert a new account into database.\n\n";
+        list << QString(appName).append(" new -p <provider> -u <username> [other options]\n");
+        list << "Insert a new account into database.\n";
+        list << "With --upsert an existing account with the same provider and username is updated\n";
+        list << "in the same statement. For scripts which sync accounts into the vault.\n\n";
         break;
     case GeneratePW:
-        list << QString(m_appName).append(" generatepw -i <id> [other options]\n");
-        list << QString(m_appName).append(" generatepw -p <provider> -u <username> [other options]\n");
+        list << QString(appName).append(" generatepw -i <id> [other options]\n");
+        list << QString(appName).append(" generatepw -p <provider> -u <username> [other options]\n");
         list << "Generates a new passwort for an given account.\n";
         list << "If no length and character set is given application will try\n";
-        list << "to read them from database.\n\n";
+        list << "to read them from database.\n";
+        list << QString(appName).append(" generatepw --count <n> [-l <length>] [-s <definition>]\n");
+        list << "Prints n new passwords without storing them. For provisioning.\n\n";
         break;
     case Modify:
-        list << QString(m_appName).append(" modify -i <id> [other options]\n");
-        list << QString(m_appName).append(" modify -p <provider> -u <username> [other options]\n");
-        list << "Can modify some values of an account.\n\n";
+        list << QString(appName).append(" modify -i <id> [other options]\n");
+        list << QString(appName).append(" modify -p <provider> -u <username> [other options]\n");
+        list << QString(appName).append(" modify --where <filter> [--limit <n>] [--dry-run] [values]\n");
+        list << "Can modify some values of an account. With --where the values are set to all\n";
+        list << "matching accounts in one statement.\n\n";
         break;
     case Show:
-        list << QString(m_appName).append(" show [options]\n");
+        list << QString(appName).append(" show [options]\n");
         list << "Shows chosen infomation about one or more accounts.\n";
         list << "If to any option a value is given then this value will be used to find a database entry.\n\n";
         break;
     case Remove:
-        list << QString(m_appName).append(" remove -i <id>\n");
-        list << QString(m_appName).append(" remove -p <rovider> -u <username>\n");
-        list << "Removes an account from database.\n\n";
+        list << QString(appName).append(" remove -i <id>\n");
+        list << QString(appName).append(" remove -p <rovider> -u <username>\n");
+        list << QString(appName).append(" remove --where <filter> [--limit <n>] [--dry-run]\n");
+        list << "Removes an account from database. With --where all matching accounts are removed\n";
+        list << "in one statement.\n\n";
         break;
     case File:
-        list << QString(m_appName).append(" file [options]\n");
-        list << "Writes data from database into a file. Or reads from file into database.\n\n";
+        list << QString(appName).append(" file [options]\n");
+        list << "Writes data from database into a file. Or reads a vault file and prints its accounts.\n";
+        list << "Without option '-v' the file is an encrypted vault. The passphrase is read\n";
+        list << "from environment variable PWMANAGER_PASSPHRASE or from console.\n\n";
         break;
     case Find:
-        list << QString(m_appName).append(" find <searchMask>\n");
+        list << QString(appName).append(" find <searchMask>\n");
         list << "Searches the database for all provider names and matches the 'searchMask'.\n";
         list << "It is a fuzzy string compare to find a provider with a search mask.\n";
         break;
     case User:
-        list << QString(m_appName).append(" user [options]\n");
+        list << QString(appName).append(" user [options]\n");
         list << "Shows infomation about the current computer user.\n";
         list << "The user who is logged on currently will must be registered for this application.\n";
         list << "Information to registered users are stored in database.\n\n";
         break;
+    case Rotate:
+        list << QString(appName).append(" rotate -d <days> [-p <provider pattern>] [--dry-run]\n");
+        list << QString(appName).append(" rotate -p <provider pattern> [--dry-run]\n");
+        list << QString(appName).append(" rotate --all [--dry-run]\n");
+        list << "Generates new passwords for all accounts which were not modified for some days\n";
+        list << "or whose provider matches a pattern. With --all for every account after a\n";
+        list << "confirmation. The rotated accounts are listed.\n";
+        list << "Each password is generated from the length and definition stored with the account.\n";
+        list << "The passwords are generated in parallel and stored in batched transactions.\n\n";
+        break;
+    case Audit:
+        list << QString(appName).append(" audit [-d <days>] [--breached <hash list> [--bloom]] [--timings]\n");
+        list << "Checks the passwords of all accounts in one pass. Reports passwords used by several\n";
+        list << "accounts, passwords not matching the stored length and definition and passwords\n";
+        list << "older than some days. With --breached the passwords are looked up in a sorted list\n";
+        list << "of breached password hashes (SHA-1 or NTLM offline dump of 'Have I Been Pwned').\n\n";
+        break;
+    case Migrate:
+        list << QString(appName).append(" migrate [--dry-run] [--partitions <n>]\n");
+        list << QString(appName).append(" migrate --verify\n");
+        list << "Brings the database schema up to date. Each migration is applied once in its own\n";
+        list << "transaction. With --verify the statements of the application are explained and\n";
+        list << "checked for the use of an index.\n\n";
+        break;
     default:
-        list << QString(m_appName).append(" <command> <options>\n");
-        list << QString(m_appName).append(" <command> --help\n");
+        list << QString(appName).append(" <command> <options>\n");
+        list << QString(appName).append(" <command> --help\n");
         list << "   Commands :  Help, New, GeneratePW, Show, Modify, Remove\n\n";
         list << "   help        Shows this help text.\n";
         list << "   new         Adds a new account to database.\n";
@@ -176,42 +150,33 @@ QStringList AppCommand::getHelpText(const QList<OptionDefinition>& optionList) c
         list << "   remove      Removes an existing account from database.\n";
         list << "   file        Write database content to file. Or read from file.\n";
         list << "   user        Get information about the current user.\n";
+        list << "   rotate      Generates new passwords for stale accounts.\n";
+        list << "   audit       Checks the passwords of all accounts.\n";
+        list << "   migrate     Brings the database schema up to date.\n";
         list << "   --help      Shows a help text to the command.\n";
+        list << "   --startup-profile  Prints the time of each start phase to stderr.\n";
+        list << "\n   With environment variable PWMANAGER_REPLICA=<file> the accounts are read from an\n";
+        list << "   encrypted local replica. It is updated with the changes since the last run.\n";
+        list << "   Writes go to the database. The passphrase is taken from PWMANAGER_PASSPHRASE.\n";
+        list << "   With PWMANAGER_CACHE=<directory> the results of show and find are kept in files.\n";
+        list << "   They are used again while the accounts are unchanged. Secrets are not cached.\n";
         break;
     }
-    foreach(OptionDefinition definition, optionList) {
-        list << definition.helpText();
+    if (withOptions) {
+        for (const OptionSpec& spec : m_optionSet) {
+            list << OptionDefinition(&spec).helpText();
+        }
     }
 
     return list;
 }
 
-/**
- * Parse the first command line parameter.
- * It should fit to one of the applications commands.
- * @return
- */
-AppCommand::Command AppCommand::parseCommand(const QString &parameter)
-{
-    m_commandMap.insert(QString("new"), New);
-    m_commandMap.insert(QString("generatepw"), GeneratePW);
-    m_commandMap.insert(QString("show"), Show);
-    m_commandMap.insert(QString("remove"), Remove);
-    m_commandMap.insert(QString("modify"), Modify);
-    m_commandMap.insert(QString("help"), Help);
-    m_commandMap.insert(QString("file"), File);
-    m_commandMap.insert(QString("find"), Find);
-    m_commandMap.insert(QString("user"), User);
-
-    return m_commandMap.value(parameter, Help);
-}
-
 /**
  * Get the application name from command line parameter.
  * @param parameter     The first command line parameter.
  * @return              A string with the application name.
  */
-QString AppCommand::applicationName(const char * const parameter)
+QString AppCommand::applicationName(const char * const parameter) const
 {
     QString path(parameter);
     int index = path.lastIndexOf('/');
@@ -221,45 +186,3 @@ QString AppCommand::applicationName(const char * const parameter)
 
     return path.right(path.length() - index - 1);
 }
-
-/**
- * Hash map with help texts to each option.
- * @return
- */
-QHash<char, QStringList> AppCommand::optionsHelpTextMap() const
-{
-    QHash<char, QStringList> helpTextMap;
-    helpTextMap.insert('i', QStringList() << "The id (primary key) to identify database entry.\n"
-                                          << "This can be an id of an account entry or the id of a\n"
-                                          << "registered user in database.\n");
-    helpTextMap.insert('p', QStringList() << "The name of a provider, Webpage, Device ...\n"
-                                          << "The information to where the login data belongs.\n");
-    helpTextMap.insert('u', QStringList() << "A username to login.\n");
-    helpTextMap.insert('k', QStringList() << "An existing password to store.\n");
-    helpTextMap.insert('q', QStringList() << "A security question to restore the password\n"
-                                          << "If you can't recall your password you may can get a new one\n"
-                                          << "with a security question and its answer.\n");
-    helpTextMap.insert('r', QStringList() << "An answer (replay) to the security question.\n"
-                                          << "If you have to recover a lost password.\n");
-    helpTextMap.insert('l', QStringList() << "The length of passwort used when generate any.\n");
-    helpTextMap.insert('s', QStringList() << "A definition string with characters to generate a passwort.\n"
-                                          << "For instance : 6[A-Z]8[a-z]*[0-9]4{+#-.,<>()}\n"
-                                          << "[] Range of characters, {} set of characters, * wildcard for amount\n"
-                                          << "5[a-z] means 5 characters in the range from a to z.\n"
-                                          << "The amount of defined characters MUST fit the password length.\n");
-    helpTextMap.insert('t', QStringList() << "The date of last modify.\n");
-    helpTextMap.insert('a', QStringList() << "Set all available options.\n");
-    helpTextMap.insert('e', QStringList() << "Select all accounts in database.\n");
-    helpTextMap.insert('f', QStringList() << "A full path to the file.\n");
-    helpTextMap.insert('o', QStringList() << "To write database content into a file.\n");
-    helpTextMap.insert('g', QStringList() << "Read (get) data from a file and store it to database.\n");
-    helpTextMap.insert('v', QStringList() << "Visual human readable file out put with all account information.\n"
-                                          << "(only for file out put.)\n");
-    helpTextMap.insert('n', QStringList() << "Show the name of user.\n");
-    helpTextMap.insert('m', QStringList() << "Show the users email.\n");
-    helpTextMap.insert('x', QStringList() << "Show if the user is active.\n");
-    helpTextMap.insert('h', QStringList() << "Shows help to a command.\n");
-
-
-    return helpTextMap;
-}
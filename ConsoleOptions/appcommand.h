@@ -16,13 +16,18 @@
  * - find
  * - help
  * - user
+ * - rotate
+ * - audit
+ * - migrate
  *
- * Each of these commands takes a specified set of options. the
- * option set are given here.
+ * Each of these commands takes a specified set of options. The
+ * commands and their option sets are static tables (see
+ * optionregistry.h), so nothing is built before parsing.
  * Additionaly the class provides help texts to the commands.
  */
 
 #include "optiondefinition.h"
+#include "optionparser.h"
 #include <QStringList>
 
 class AppCommand
@@ -31,30 +36,29 @@ public:
     AppCommand(const int argc, const char* const argv[]);
     ~AppCommand();
 
-    enum Command { None, New, GeneratePW, Show, Remove, Modify, Help, File, Find, User };
+    enum Command { None, New, GeneratePW, Show, Remove, Modify, Help, File, Find, User, Rotate, Audit, Migrate };
 
 private:
     Command m_command;
     bool m_optionAll;
     bool m_isHelpNeeded;
-    QString m_appName;
+    const char* m_pAppPath;
     quint8 m_requiredParameter;
     quint8 m_allowedParameter;
-    QMap<QString, Command> m_commandMap;
+    OptionSet m_optionSet;
 
 public:
     Command command() const                 { return m_command; }
     bool isOptionAllSet() const             { return m_optionAll; }
     bool isHelpNeeded() const               { return m_isHelpNeeded; }
-    QList<OptionDefinition> commandsOptions();
-    QStringList getHelpText(const QList<OptionDefinition> &optionList = QList<OptionDefinition>()) const;
+    const OptionSet& commandsOptions() const    { return m_optionSet; }
+    void takeSwitches(OptionTable& optionTable);
+    QStringList getHelpText(const bool withOptions = false) const;
     quint8 requiredParam() const            { return m_requiredParameter; }
     quint8 allowedParam() const             { return m_allowedParameter; }
 
 protected:
-    Command parseCommand(const QString &parameter);
-    QString applicationName(const char* const parameter);
-    QHash<char, QStringList> optionsHelpTextMap() const;
+    QString applicationName(const char* const parameter) const;
 };
 
 #endif // MANAGERCOMMAND_H
@@ -1,12 +1,12 @@
 #include "optionparser.h"
 
 /**
- * Constructs an option parser object. It takes a list of option definitions.
- * The defined options can be parsed of that parser.
- * @param definitionList    A list of option definitions.
+ * Constructs an option parser object. It takes the set of options of a
+ * command. The defined options can be parsed of that parser.
+ * @param optionSet         The static options of a command.
  */
-OptionParser::OptionParser(const QList<OptionDefinition> &definitionList, const quint8 requiredFreeArgs, const quint8 freeArgsAllowed) :
-    m_definitionList(definitionList),
+OptionParser::OptionParser(const OptionSet &optionSet, const quint8 requiredFreeArgs, const quint8 freeArgsAllowed) :
+    m_optionSet(optionSet),
     m_requireFreeArgs(requiredFreeArgs),
     m_freeArgsAllowed(freeArgsAllowed)
 {
@@ -115,37 +115,26 @@ OptionParser::ParseState OptionParser::stateFromParameter(const char * const par
  * Searches for a option definition for a given character.
  * Returns the option definition to that character or if there is not
  * such an option defined it returns an empty definition object.
+ * The lookup is a direct table access.
  * @param symbol        The character to search for in definitions.
  * @return              An OptionDefinition object with an option definition
  *                      or empty if there is not such an option.
  */
 OptionDefinition OptionParser::definitionOf(const char symbol) const
 {
-    for (quint16 index=0; index<m_definitionList.size(); ++index) {
-        if (m_definitionList[index].option() == symbol) {
-            return m_definitionList[index];
-        }
-    }
-
-    return OptionDefinition();
+    return OptionDefinition(m_optionSet.find(symbol));
 }
 
 /**
  * Overload of function definitionOf() to find a long name option in
- * the list of definitions.
- * @param name      The long name of an option.
+ * the set of options. The lookup is a perfect hash.
+ * @param name      The long name of an option. May be followed by '=' and a value.
  * @return          An OptionDefinition object with an option definition
  *                  or empty if such an option doesn't exist.
  */
-OptionDefinition OptionParser::definitionOf(const QString &name) const
+OptionDefinition OptionParser::definitionOf(const char * const name) const
 {
-    for (quint16 index=0; index<m_definitionList.size(); ++index) {
-        if (m_definitionList[index].longOption() == name) {
-            return m_definitionList[index];
-        }
-    }
-
-    return OptionDefinition();
+    return OptionDefinition(m_optionSet.find(name));
 }
 
 /**
@@ -178,7 +167,7 @@ bool OptionParser::parseOptions(const char * const param, OptionTable &optionTab
         case Option:
             if (definition.isValid()) {                     // Found valid option.
                 if (definition.isSwitch()) {
-                    definition.setSwitchOn();               // Option switches a boolean to true.
+                    optionTable.insert(definition.option(), QVariant(true));    // Option is a switch.
                 } else {
                     lastOption = definition;                // Is normal option.
                     optionTable.insert(definition.option(), QVariant());
@@ -229,18 +218,17 @@ bool OptionParser::parseOptions(const char * const param, OptionTable &optionTab
  */
 bool OptionParser::parseLongOption(const char * const param, OptionTable &optionTable, OptionDefinition &last) const
 {
-    QString parameter(param);
-    QString optionName = longOptionName(parameter);
-    OptionDefinition definition = definitionOf(optionName);
+    OptionDefinition definition = definitionOf(param + 2);
     if (! definition.isValid()) {
         // ERROR: Is not an option.
         return false;
     }
     if (definition.isSwitch()) {
-        definition.setSwitchOn();           // This option is just a switch which turns a boolean to true.
+        optionTable.insert(definition.option(), QVariant(true));   // This option is just a switch.
         last = OptionDefinition();
         return true;
     }
+    QString parameter(param);
     int index = parameter.indexOf('=');     // Console parameter may contain long option and argument.
     if (index > 0) {
         QString stringVal = longOptionArgument(parameter);
@@ -256,22 +244,6 @@ bool OptionParser::parseLongOption(const char * const param, OptionTable &option
     return true;
 }
 
-/**
- * Extracts the name of a long name option from the command line argument
- * like '--file=/Home/Horst/Data'.
- * @param param     A string with the command line argument.
- * @return          The found name of the long name option as a QString.
- */
-QString OptionParser::longOptionName(const QString& param) const
-{
-    int index = param.indexOf('=');
-    if (index < 0) {
-        return param.right(param.length() - 2);
-    }
-
-    return param.mid(2, index - 2);
-}
-
 /**
  * Extracts the option value from a long name option combined
  * with a value like '--file=/home/Horst/Data'.
@@ -9,7 +9,7 @@ typedef QHash<char, QVariant> OptionTable;
 class OptionParser
 {
 public:
-    OptionParser(const QList<OptionDefinition>& definitionList, const quint8 requiredFreeArgs = 0, const quint8 freeArgsAllowed = 0);
+    OptionParser(const OptionSet& optionSet, const quint8 requiredFreeArgs = 0, const quint8 freeArgsAllowed = 0);
 
     enum ParseState { None, Option, LongOption, Argument, OptionalArgument, NonOptArgument };
 
@@ -20,16 +20,15 @@ public:
 protected:
     ParseState stateFromParameter(const char* const param, const OptionDefinition &lastOption) const;
     OptionDefinition definitionOf(const char symbol) const;
-    OptionDefinition definitionOf(const QString& name) const;
+    OptionDefinition definitionOf(const char* const name) const;
     bool parseOptions(const char* const param, OptionTable& optionTable, OptionDefinition &last, char& wrong) const;
     bool parseLongOption(const char* const param, OptionTable& optionTable, OptionDefinition& last) const;
-    QString longOptionName(const QString &param) const;
     QString longOptionArgument(const QString &param) const;
     void setErrorMsg(const QString& msg);
     void checkFreeArgumentList(const OptionTable& optionTable);
 
 private:
-    const QList<OptionDefinition>& m_definitionList;
+    const OptionSet& m_optionSet;
     QString m_errorMsg;
     quint8 m_requireFreeArgs;
     quint8 m_freeArgsAllowed;
@@ -0,0 +1,314 @@
+#ifndef OPTIONREGISTRY_H
+#define OPTIONREGISTRY_H
+
+/* -------------------------------------------------------------------------------
+ * Option registry
+ *
+ * All commands of the application with their options, data types and help
+ * texts as constexpr tables. The index of each option table and of the
+ * command names is computed by the compiler. Looking up a command or an
+ * option at run time does not allocate.
+ *
+ * To add an option append an optionSpec() entry to the table of the command.
+ * To add a command add an option table, its index and a CommandSpec entry.
+ * -------------------------------------------------------------------------------
+ */
+
+#include "appcommand.h"
+#include <cstring>
+
+namespace OptionRegistry {
+
+// Help texts shared by several commands.
+constexpr const char* HelpId = "The id (primary key) to identify database entry.\n"
+                               "This can be an id of an account entry or the id of a\n"
+                               "registered user in database.\n";
+constexpr const char* HelpProvider = "The name of a provider, Webpage, Device ...\n"
+                                     "The information to where the login data belongs.\n";
+constexpr const char* HelpUsername = "A username to login.\n";
+constexpr const char* HelpPassword = "An existing password to store.\n";
+constexpr const char* HelpQuestion = "A security question to restore the password\n"
+                                     "If you can't recall your password you may can get a new one\n"
+                                     "with a security question and its answer.\n";
+constexpr const char* HelpAnswer = "An answer (replay) to the security question.\n"
+                                   "If you have to recover a lost password.\n";
+constexpr const char* HelpLength = "The length of passwort used when generate any.\n";
+constexpr const char* HelpDefinition = "A definition string with characters to generate a passwort.\n"
+                                       "For instance : 6[A-Z]8[a-z]*[0-9]4{+#-.,<>()}\n"
+                                       "[] Range of characters, {} set of characters, * wildcard for amount\n"
+                                       "5[a-z] means 5 characters in the range from a to z.\n"
+                                       "The amount of defined characters MUST fit the password length.\n";
+constexpr const char* HelpBreached = "Path of a sorted list of breached password hashes.\n"
+                                     "Passwords found in that list are rejected.\n";
+constexpr const char* HelpBloom = "Put a Bloom filter in front of the list of breached passwords.\n"
+                                  "It is built once and stored next to the list.\n";
+constexpr const char* HelpFormat = "Output format: table (default), jsonl, csv or tsv.\n"
+                                   "Rows are written as they are read, without colors.\n";
+
+constexpr const char* HelpWhere = "Filter expression. Compare columns with =, !=, <, <=, >, >=,\n"
+                                  "^= (starts with) and ~ (pattern with '*' and '?', case ignored).\n"
+                                  "Combine with AND, OR, NOT and parentheses. For instance:\n"
+                                  "\"provider^=aws AND lastmodify<2026-01-01\"\n";
+
+constexpr const char* HelpBulkLimit = "With --where: maximum number of accounts to change. If more accounts\n"
+                                      "match nothing is changed. Default is 100. 0 for no limit.\n";
+constexpr const char* HelpBulkDryRun = "With --where: just count the matching accounts. Do not change anything.\n";
+
+constexpr OptionSpec HelpOption = optionSpec('h', SwitchOn, QVariant::Invalid, "help", "Shows help to a command.\n");
+
+constexpr std::array<OptionSpec, 1> NoOptions = {{ HelpOption }};
+
+constexpr std::array<OptionSpec, 11> NewOptions = {{
+    HelpOption,
+    optionSpec('p', NeedArgument, QVariant::String, nullptr, HelpProvider),
+    optionSpec('u', NeedArgument, QVariant::String, nullptr, HelpUsername),
+    optionSpec('k', OptionalArgument, QVariant::String, nullptr, HelpPassword),
+    optionSpec('l', NeedArgument, QVariant::String, nullptr, HelpLength),
+    optionSpec('s', NeedArgument, QVariant::String, nullptr, HelpDefinition),
+    optionSpec('q', OptionalArgument, QVariant::String, nullptr, HelpQuestion),
+    optionSpec('r', OptionalArgument, QVariant::String, "answer", HelpAnswer),
+    optionSpec('b', NeedArgument, QVariant::String, "breached", HelpBreached),
+    optionSpec('B', NoArgument, QVariant::Invalid, "bloom", HelpBloom),
+    optionSpec('Y', NoArgument, QVariant::Invalid, "upsert", "Update the account if provider and username exist already.\n"
+                                                             "Without password the existing password is kept.\n")
+}};
+
+constexpr std::array<OptionSpec, 9> GeneratePWOptions = {{
+    HelpOption,
+    optionSpec('i', NeedArgument, QVariant::Int, nullptr, HelpId),
+    optionSpec('p', NeedArgument, QVariant::String, nullptr, HelpProvider),
+    optionSpec('u', NeedArgument, QVariant::String, nullptr, HelpUsername),
+    optionSpec('l', NeedArgument, QVariant::Int, nullptr, HelpLength),
+    optionSpec('s', NeedArgument, QVariant::String, nullptr, HelpDefinition),
+    optionSpec('c', NeedArgument, QVariant::Int, "count", "Number of passwords to generate and print.\n"
+                                                          "The passwords are not stored into database.\n"),
+    optionSpec('b', NeedArgument, QVariant::String, "breached", HelpBreached),
+    optionSpec('B', NoArgument, QVariant::Invalid, "bloom", HelpBloom)
+}};
+
+constexpr std::array<OptionSpec, 18> ShowOptions = {{
+    HelpOption,
+    optionSpec('i', OptionalArgument, QVariant::Int, nullptr, HelpId),
+    optionSpec('p', OptionalArgument, QVariant::String, nullptr, HelpProvider),
+    optionSpec('u', OptionalArgument, QVariant::String, nullptr, HelpUsername),
+    optionSpec('k', OptionalArgument, QVariant::String, nullptr, HelpPassword),
+    optionSpec('l', OptionalArgument, QVariant::Int, nullptr, HelpLength),
+    optionSpec('s', OptionalArgument, QVariant::String, nullptr, HelpDefinition),
+    optionSpec('q', OptionalArgument, QVariant::String, nullptr, HelpQuestion),
+    optionSpec('t', OptionalArgument, QVariant::DateTime, nullptr, "The date of last modify.\n"),
+    optionSpec('r', OptionalArgument, QVariant::String, "answer", HelpAnswer),
+    optionSpec('a', SwitchOn, QVariant::Invalid, "all", "Set all available options.\n"),
+    optionSpec('F', NeedArgument, QVariant::String, "format", HelpFormat),
+    optionSpec('w', NeedArgument, QVariant::String, "where", HelpWhere),
+    optionSpec('L', NeedArgument, QVariant::Int, "limit", "Maximum number of accounts to show. The key of the next\n"
+                                                          "page is printed to stderr.\n"),
+    optionSpec('o', NeedArgument, QVariant::String, "order-by", "Column to order the accounts by. Default is the id.\n"),
+    optionSpec('A', NeedArgument, QVariant::String, "after", "Shows the page behind this key. The key is '<id>' or\n"
+                                                             "'<value>,<id>' when ordered by another column.\n"),
+    optionSpec('M', NoArgument, QVariant::Invalid, "masked", "Do not read passwords and answers. They are shown as '********'.\n"),
+    optionSpec('R', NeedArgument, QVariant::String, "reveal", "Comma separated ids of accounts whose passwords and answers\n"
+                                                              "are read and shown in a masked listing.\n")
+}};
+
+constexpr std::array<OptionSpec, 12> ModifyOptions = {{
+    HelpOption,
+    optionSpec('i', NeedArgument, QVariant::Int, nullptr, HelpId),
+    optionSpec('p', NeedArgument, QVariant::String, nullptr, HelpProvider),
+    optionSpec('u', NeedArgument, QVariant::String, nullptr, HelpUsername),
+    optionSpec('k', NeedArgument, QVariant::String, nullptr, HelpPassword),
+    optionSpec('l', NeedArgument, QVariant::Int, nullptr, HelpLength),
+    optionSpec('s', NeedArgument, QVariant::String, nullptr, HelpDefinition),
+    optionSpec('q', NeedArgument, QVariant::String, nullptr, HelpQuestion),
+    optionSpec('r', NeedArgument, QVariant::String, "answer", HelpAnswer),
+    optionSpec('w', NeedArgument, QVariant::String, "where", HelpWhere),
+    optionSpec('L', NeedArgument, QVariant::Int, "limit", HelpBulkLimit),
+    optionSpec('D', NoArgument, QVariant::Invalid, "dry-run", HelpBulkDryRun)
+}};
+
+constexpr std::array<OptionSpec, 7> RemoveOptions = {{
+    HelpOption,
+    optionSpec('i', NeedArgument, QVariant::String, nullptr, HelpId),
+    optionSpec('p', NeedArgument, QVariant::String, nullptr, HelpProvider),
+    optionSpec('u', NeedArgument, QVariant::String, nullptr, HelpUsername),
+    optionSpec('w', NeedArgument, QVariant::String, "where", HelpWhere),
+    optionSpec('L', NeedArgument, QVariant::Int, "limit", HelpBulkLimit),
+    optionSpec('D', NoArgument, QVariant::Invalid, "dry-run", HelpBulkDryRun)
+}};
+
+constexpr std::array<OptionSpec, 6> FileOptions = {{
+    HelpOption,
+    optionSpec('f', NeedArgument, QVariant::String, "file", "A full path to the file.\n"),
+    optionSpec('o', NoArgument, QVariant::Invalid, "out", "To write database content into a file.\n"),
+    optionSpec('g', NoArgument, QVariant::Invalid, "in", "Read (get) the accounts of a vault file and print them.\n"
+                                                         "Nothing is stored to the database.\n"),
+    optionSpec('v', NoArgument, QVariant::Invalid, "readable", "Visual human readable file out put with all account information.\n"
+                                                               "(only for file out put.)\n"),
+    optionSpec('R', NeedArgument, QVariant::Int, "record", "Number of a single account to read from a vault file.\n"
+                                                           "Only the chunk holding that account is decrypted.\n")
+}};
+
+constexpr std::array<OptionSpec, 2> FindOptions = {{
+    HelpOption,
+    optionSpec('F', NeedArgument, QVariant::String, "format", HelpFormat)
+}};
+
+constexpr std::array<OptionSpec, 6> UserOptions = {{
+    HelpOption,
+    optionSpec('n', NoArgument, QVariant::Invalid, "name", "Show the name of user.\n"),
+    optionSpec('i', NoArgument, QVariant::Invalid, "id", HelpId),
+    optionSpec('m', NoArgument, QVariant::Invalid, "email", "Show the users email.\n"),
+    optionSpec('x', NoArgument, QVariant::Invalid, "active", "Show if the user is active.\n"),
+    optionSpec('F', NeedArgument, QVariant::String, "format", HelpFormat)
+}};
+
+constexpr std::array<OptionSpec, 5> RotateOptions = {{
+    HelpOption,
+    optionSpec('d', NeedArgument, QVariant::Int, "days", "Select accounts with a last modify older than this number of days.\n"
+                                                         "Accounts without a last modify are selected as well.\n"),
+    optionSpec('p', NeedArgument, QVariant::String, "provider", "Select accounts with a provider name matching this pattern.\n"
+                                                                "Wildcards '*' and '?' are allowed. Case is ignored.\n"),
+    optionSpec('a', NoArgument, QVariant::Invalid, "all", "Select all accounts. Needs a confirmation.\n"),
+    optionSpec('D', NoArgument, QVariant::Invalid, "dry-run", "Just show the selected accounts. Do not change anything.\n")
+}};
+
+constexpr std::array<OptionSpec, 5> AuditOptions = {{
+    HelpOption,
+    optionSpec('b', NeedArgument, QVariant::String, "breached", HelpBreached),
+    optionSpec('B', NoArgument, QVariant::Invalid, "bloom", HelpBloom),
+    optionSpec('d', NeedArgument, QVariant::Int, "days", "Report passwords older than this number of days. Default is 365.\n"),
+    optionSpec('T', NoArgument, QVariant::Invalid, "timings", "Print the time taken by each stage.\n")
+}};
+
+constexpr std::array<OptionSpec, 4> MigrateOptions = {{
+    HelpOption,
+    optionSpec('D', NoArgument, QVariant::Invalid, "dry-run", "Just show the pending migrations. Do not change anything.\n"),
+    optionSpec('P', NeedArgument, QVariant::Int, "partitions", "Apply the optional migration which splits the accounts into\n"
+                                                                 "this number of hash partitions by user.\n"),
+    optionSpec('v', NoArgument, QVariant::Invalid, "verify", "Check with EXPLAIN that the statements of the application\n"
+                                                              "are served by indexes. Does not migrate.\n")
+}};
+
+constexpr OptionIndex NoOptionsIndex = makeOptionIndex(NoOptions);
+constexpr OptionIndex NewIndex = makeOptionIndex(NewOptions);
+constexpr OptionIndex GeneratePWIndex = makeOptionIndex(GeneratePWOptions);
+constexpr OptionIndex ShowIndex = makeOptionIndex(ShowOptions);
+constexpr OptionIndex ModifyIndex = makeOptionIndex(ModifyOptions);
+constexpr OptionIndex RemoveIndex = makeOptionIndex(RemoveOptions);
+constexpr OptionIndex FileIndex = makeOptionIndex(FileOptions);
+constexpr OptionIndex FindIndex = makeOptionIndex(FindOptions);
+constexpr OptionIndex UserIndex = makeOptionIndex(UserOptions);
+constexpr OptionIndex RotateIndex = makeOptionIndex(RotateOptions);
+constexpr OptionIndex AuditIndex = makeOptionIndex(AuditOptions);
+constexpr OptionIndex MigrateIndex = makeOptionIndex(MigrateOptions);
+
+static_assert(NoOptionsIndex.isValid && NewIndex.isValid && GeneratePWIndex.isValid && ShowIndex.isValid &&
+              ModifyIndex.isValid && RemoveIndex.isValid && FileIndex.isValid && FindIndex.isValid &&
+              UserIndex.isValid && RotateIndex.isValid && AuditIndex.isValid && MigrateIndex.isValid,
+              "An option character is used twice or no perfect hash for the long options was found.");
+
+template<std::size_t N>
+constexpr OptionSet optionSet(const std::array<OptionSpec, N>& specs, const OptionIndex& index)
+{
+    return OptionSet { specs.data(), static_cast<int>(N), &index };
+}
+
+struct CommandSpec
+{
+    AppCommand::Command command;
+    const char* name;
+    quint8 requiredParameter;
+    quint8 allowedParameter;
+    OptionSet options;
+};
+
+constexpr std::array<CommandSpec, 12> Commands = {{
+    { AppCommand::New, "new", 0, 0, optionSet(NewOptions, NewIndex) },
+    { AppCommand::GeneratePW, "generatepw", 0, 0, optionSet(GeneratePWOptions, GeneratePWIndex) },
+    { AppCommand::Show, "show", 0, 0, optionSet(ShowOptions, ShowIndex) },
+    { AppCommand::Remove, "remove", 0, 0, optionSet(RemoveOptions, RemoveIndex) },
+    { AppCommand::Modify, "modify", 0, 0, optionSet(ModifyOptions, ModifyIndex) },
+    { AppCommand::Help, "help", 0, 0, optionSet(NoOptions, NoOptionsIndex) },
+    { AppCommand::File, "file", 0, 0, optionSet(FileOptions, FileIndex) },
+    { AppCommand::Find, "find", 1, 1, optionSet(FindOptions, FindIndex) },
+    { AppCommand::User, "user", 0, 0, optionSet(UserOptions, UserIndex) },
+    { AppCommand::Rotate, "rotate", 0, 0, optionSet(RotateOptions, RotateIndex) },
+    { AppCommand::Audit, "audit", 0, 0, optionSet(AuditOptions, AuditIndex) },
+    { AppCommand::Migrate, "migrate", 0, 0, optionSet(MigrateOptions, MigrateIndex) }
+}};
+
+/**
+ * Perfect hash index of the command names.
+ */
+struct CommandIndex
+{
+    static constexpr int Slots = 64;
+    static constexpr quint32 MaxSeed = 4096;
+
+    std::array<qint8, Slots> slots;
+    quint32 seed;
+    bool isValid;
+};
+
+constexpr CommandIndex makeCommandIndex()
+{
+    CommandIndex index {};
+    for (quint32 seed=0; seed<CommandIndex::MaxSeed; ++seed) {
+        bool isPerfect = true;
+        for (int slot=0; slot<CommandIndex::Slots; ++slot) {
+            index.slots[slot] = -1;
+        }
+        for (std::size_t position=0; position<Commands.size() && isPerfect; ++position) {
+            int slot = optionNameHash(Commands[position].name, seed) & (CommandIndex::Slots - 1);
+            if (index.slots[slot] >= 0) {
+                isPerfect = false;
+            }
+            index.slots[slot] = static_cast<qint8>(position);
+        }
+        if (isPerfect) {
+            index.seed = seed;
+            index.isValid = true;
+            return index;
+        }
+    }
+    index.isValid = false;
+
+    return index;
+}
+
+constexpr CommandIndex CommandNameIndex = makeCommandIndex();
+static_assert(CommandNameIndex.isValid, "No perfect hash for the command names was found.");
+
+/**
+ * Finds a command by its name.
+ * @param name
+ * @return          The command or nullptr.
+ */
+inline const CommandSpec* findCommand(const char* name)
+{
+    qint8 position = CommandNameIndex.slots[optionNameHash(name, CommandNameIndex.seed) & (CommandIndex::Slots - 1)];
+    if (position < 0 || std::strcmp(name, Commands[position].name) != 0) {
+        return nullptr;
+    }
+
+    return &Commands[position];
+}
+
+/**
+ * Finds the entry of a command.
+ * @param command
+ * @return          The command or nullptr.
+ */
+inline const CommandSpec* findCommand(const AppCommand::Command command)
+{
+    for (const CommandSpec& spec : Commands) {
+        if (spec.command == command) {
+            return &spec;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace OptionRegistry
+
+#endif // OPTIONREGISTRY_H
@@ -0,0 +1,250 @@
+#ifndef OPTIONSPEC_H
+#define OPTIONSPEC_H
+
+/* -------------------------------------------------------------------------------
+ * OptionSpec, OptionIndex and OptionSet
+ *
+ * Static description of console options. All option tables of the application
+ * are constexpr arrays of OptionSpec (see optionregistry.h). Nothing is built
+ * at run time.
+ *
+ * An OptionIndex is computed by the compiler for each option table. It finds
+ * an option without scanning the table:
+ * - short options: a direct table indexed by the option character.
+ * - long options: a perfect hash. The compiler searches a seed for which the
+ *   hash of each long name hits its own slot. A lookup hashes the name once
+ *   and compares one entry.
+ *
+ * Each OptionSpec has a converter function chosen by its data type. It turns
+ * the string value from command line into a QVariant.
+ * -------------------------------------------------------------------------------
+ */
+
+#include <QVariant>
+#include <array>
+#include <cstddef>
+
+enum OptionType { InvalidDefinition, OptionalArgument, NeedArgument, NoArgument, SwitchOn };
+
+// Converts a command line value. Format is used for date and time values.
+typedef QVariant (*OptionConverter)(const QString& stringValue, const char* format);
+
+QVariant convertToBool(const QString& stringValue, const char* format);
+QVariant convertToDate(const QString& stringValue, const char* format);
+QVariant convertToDateTime(const QString& stringValue, const char* format);
+QVariant convertToDouble(const QString& stringValue, const char* format);
+QVariant convertToInt(const QString& stringValue, const char* format);
+QVariant convertToLongLong(const QString& stringValue, const char* format);
+QVariant convertToString(const QString& stringValue, const char* format);
+QVariant convertToTime(const QString& stringValue, const char* format);
+QVariant convertToUInt(const QString& stringValue, const char* format);
+QVariant convertToULongLong(const QString& stringValue, const char* format);
+QVariant convertToInvalid(const QString& stringValue, const char* format);
+
+struct OptionSpec
+{
+    char option;
+    OptionType type;
+    QVariant::Type dataType;
+    const char* longOption;         // nullptr if there is no long name.
+    const char* format;             // Format of date and time values.
+    const char* helpText;           // Lines separated by '\n'.
+    OptionConverter converter;
+};
+
+/**
+ * The converter for a data type.
+ * @param dataType
+ * @return
+ */
+constexpr OptionConverter converterFor(const QVariant::Type dataType)
+{
+    switch (dataType) {
+    case QVariant::Bool:        return &convertToBool;
+    case QVariant::Date:        return &convertToDate;
+    case QVariant::DateTime:    return &convertToDateTime;
+    case QVariant::Double:      return &convertToDouble;
+    case QVariant::Int:         return &convertToInt;
+    case QVariant::LongLong:    return &convertToLongLong;
+    case QVariant::String:      return &convertToString;
+    case QVariant::Time:        return &convertToTime;
+    case QVariant::UInt:        return &convertToUInt;
+    case QVariant::ULongLong:   return &convertToULongLong;
+    default:                    return &convertToInvalid;
+    }
+}
+
+/**
+ * The standard format to parse a date or time value.
+ * @param dataType
+ * @return
+ */
+constexpr const char* formatFor(const QVariant::Type dataType)
+{
+    switch (dataType) {
+    case QVariant::Date:        return "d-M-yyyy";
+    case QVariant::DateTime:    return "d-M-yyyy+h:m";
+    case QVariant::Time:        return "h:m";
+    default:                    return nullptr;
+    }
+}
+
+/**
+ * Describes an option.
+ * @param option            The option character.
+ * @param type              NeedArgument, NoArgument, SwitchOn and OptionalArgument.
+ * @param dataType          A QVariant data type in witch a value is converted.
+ * @param longOption        A long name for a option or nullptr.
+ * @param helpText          Help text lines separated by '\n'.
+ * @return
+ */
+constexpr OptionSpec optionSpec(const char option, const OptionType type, const QVariant::Type dataType,
+                                const char* longOption, const char* helpText)
+{
+    return OptionSpec { option, type, dataType, longOption, formatFor(dataType), helpText, converterFor(dataType) };
+}
+
+/**
+ * Hash of a name (FNV-1a with seed). The name ends at a null or '='
+ * character or after length characters.
+ * @param name
+ * @param seed
+ * @param length
+ * @return
+ */
+constexpr quint32 optionNameHash(const char* name, const quint32 seed, const int length = -1)
+{
+    quint32 hash = 2166136261u ^ (seed * 16777619u);
+    for (int index=0; name[index] != 0 && name[index] != '=' && index != length; ++index) {
+        hash ^= static_cast<quint8>(name[index]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Compares a name with a long option name. The name ends at a null or
+ * '=' character.
+ * @param name
+ * @param longOption
+ * @return
+ */
+constexpr bool isSameOptionName(const char* name, const char* longOption)
+{
+    int index = 0;
+    while (longOption[index] != 0) {
+        if (name[index] != longOption[index]) {
+            return false;
+        }
+        ++index;
+    }
+
+    return name[index] == 0 || name[index] == '=';
+}
+
+struct OptionIndex
+{
+    static constexpr int ShortSlots = 128;
+    static constexpr int LongSlots = 32;
+    static constexpr quint32 MaxSeed = 4096;
+
+    std::array<qint8, ShortSlots> shortSlots;
+    std::array<qint8, LongSlots> longSlots;
+    quint32 seed;
+    bool isValid;
+};
+
+/**
+ * Builds the index of an option table. Searches the seed of a perfect
+ * hash for the long names. The index is invalid if an option character
+ * is used twice or if no seed is found.
+ * @param specs
+ * @return
+ */
+template<std::size_t N>
+constexpr OptionIndex makeOptionIndex(const std::array<OptionSpec, N>& specs)
+{
+    OptionIndex index {};
+    index.isValid = true;
+    for (int slot=0; slot<OptionIndex::ShortSlots; ++slot) {
+        index.shortSlots[slot] = -1;
+    }
+    for (std::size_t position=0; position<N; ++position) {
+        int slot = static_cast<quint8>(specs[position].option) & (OptionIndex::ShortSlots - 1);
+        if (index.shortSlots[slot] >= 0) {
+            index.isValid = false;
+        }
+        index.shortSlots[slot] = static_cast<qint8>(position);
+    }
+    for (quint32 seed=0; seed<OptionIndex::MaxSeed; ++seed) {
+        bool isPerfect = true;
+        for (int slot=0; slot<OptionIndex::LongSlots; ++slot) {
+            index.longSlots[slot] = -1;
+        }
+        for (std::size_t position=0; position<N && isPerfect; ++position) {
+            if (specs[position].longOption == nullptr) {
+                continue;
+            }
+            int slot = optionNameHash(specs[position].longOption, seed) & (OptionIndex::LongSlots - 1);
+            if (index.longSlots[slot] >= 0) {
+                isPerfect = false;
+            }
+            index.longSlots[slot] = static_cast<qint8>(position);
+        }
+        if (isPerfect) {
+            index.seed = seed;
+            return index;
+        }
+    }
+    index.isValid = false;
+
+    return index;
+}
+
+/* -------------------------------------------------------------------------------
+ * OptionSet
+ * The options of one command. A view on a static option table and its index.
+ * -------------------------------------------------------------------------------
+ */
+struct OptionSet
+{
+    const OptionSpec* pSpecs;
+    int count;
+    const OptionIndex* pIndex;
+
+    const OptionSpec* begin() const             { return pSpecs; }
+    const OptionSpec* end() const               { return pSpecs + count; }
+
+    /**
+     * Finds the option of a character.
+     * @param option
+     * @return          The option or nullptr.
+     */
+    const OptionSpec* find(const char option) const
+    {
+        qint8 position = pIndex->shortSlots[static_cast<quint8>(option) & (OptionIndex::ShortSlots - 1)];
+        if (position < 0 || pSpecs[position].option != option) {
+            return nullptr;
+        }
+
+        return pSpecs + position;
+    }
+
+    /**
+     * Finds the option of a long name. The name ends at a null or '='.
+     * @param name
+     * @return          The option or nullptr.
+     */
+    const OptionSpec* find(const char* name) const
+    {
+        qint8 position = pIndex->longSlots[optionNameHash(name, pIndex->seed) & (OptionIndex::LongSlots - 1)];
+        if (position < 0 || ! isSameOptionName(name, pSpecs[position].longOption)) {
+            return nullptr;
+        }
+
+        return pSpecs + position;
+    }
+};
+
+#endif // OPTIONSPEC_H
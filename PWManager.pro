@@ -1,55 +1,94 @@
 QT -= gui
-QT += sql
+QT += sql concurrent
 
 CONFIG += c++17 console
 CONFIG -= app_bundle
 
+LIBS += -lcrypto
+CONFIG += link_pkgconfig
+PKGCONFIG += libpq
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        Audit/auditengine.cpp \
+        Audit/bloomfilter.cpp \
+        Audit/breachedcorpus.cpp \
         ConsoleOptions/appcommand.cpp \
         ConsoleOptions/optiondefinition.cpp \
         ConsoleOptions/optionparser.cpp \
         ConsoleOptions/optiontable.cpp \
         PasswordGenerator/characterdefinition.cpp \
         PasswordGenerator/characterdefinitionlist.cpp \
+        PasswordGenerator/passwordplan.cpp \
         PasswordGenerator/pwgenerator.cpp \
+        PasswordGenerator/randomsource.cpp \
         Persistence/credentials.cpp \
         Persistence/filepersistence.cpp \
+        Persistence/localreplica.cpp \
         Persistence/persistence.cpp \
         Persistence/persistencefactory.cpp \
+        Persistence/persistenceproxy.cpp \
         Persistence/postgresql.cpp \
+        Persistence/postgresqlnative.cpp \
+        Persistence/querycache.cpp \
+        Persistence/schemamigration.cpp \
+        Persistence/transactionguard.cpp \
+        Persistence/vaultcipher.cpp \
+        SearchAccount/filterexpression.cpp \
         SearchAccount/matchobject.cpp \
         SearchAccount/matchstring.cpp \
-        UserInterface/columnwidth.cpp \
         UserInterface/consoleinterface.cpp \
+        UserInterface/recordwriter.cpp \
+        UserInterface/tablerenderer.cpp \
         Utility/range.cpp \
+        Utility/startupprofile.cpp \
         main.cpp \
         commandprocessor.cpp
 
 HEADERS += \
+        Audit/auditengine.h \
+        Audit/bloomfilter.h \
+        Audit/breachedcorpus.h \
         ConsoleOptions/appcommand.h \
         ConsoleOptions/optiondefinition.h \
         ConsoleOptions/optionparser.h \
+        ConsoleOptions/optionregistry.h \
+        ConsoleOptions/optionspec.h \
         ConsoleOptions/optiontable.h \
         PasswordGenerator/characterdefinition.h \
         PasswordGenerator/characterdefinitionlist.h \
+        PasswordGenerator/passwordplan.h \
         PasswordGenerator/pwgenerator.h \
+        PasswordGenerator/randomsource.h \
         Persistence/credentials.h \
         Persistence/filepersistence.h \
+        Persistence/localreplica.h \
         Persistence/persistence.h \
         Persistence/persistencefactory.h \
+        Persistence/persistenceproxy.h \
         Persistence/postgresql.h \
+        Persistence/postgresqlnative.h \
+        Persistence/querycache.h \
+        Persistence/schemamigration.h \
+        Persistence/transactionguard.h \
+        Persistence/vaultcipher.h \
+        SearchAccount/filterexpression.h \
         SearchAccount/matchobject.h \
         SearchAccount/matchstring.h \
-        UserInterface/columnwidth.h \
         UserInterface/consoleinterface.h \
+        UserInterface/recordwriter.h \
+        UserInterface/tablerenderer.h \
         Utility/range.h \
         Utility/sortlist.h \
+        Utility/startupprofile.h \
         commandprocessor.h
 
+RESOURCES += \
+        PostgreSql/migrations.qrc
+
 TRANSLATIONS += \
     PWManager_de_DE.ts
 CONFIG += lrelease
@@ -1,6 +1,4 @@
 #include "characterdefinition.h"
-#include <QTime>
-#include <QRandomGenerator>
 
 /**
  * Constructor
@@ -45,25 +43,6 @@ CharacterDefinition::CharacterDefinition(unsigned short amount, QList<QChar> cha
     }
 }
 
-/**
- * Get a random character list of the defined character set.
- * The returned list has the size of the amount value of this
- * object.
- * @return list     A list with randomly picked characters from member list.
- */
-QList<QChar> CharacterDefinition::getRandomSet() const
-{
-    QList<QChar> listCopy(m_characterList);
-    QList<QChar> list;
-    QRandomGenerator::global()->seed(QTime::currentTime().msec());
-    for (int i=0; i<m_amount; ++i) {
-        int index = QRandomGenerator::global()->generate() % listCopy.size();
-        list << listCopy.takeAt(index);
-    }
-
-    return list;
-}
-
 /**
  * Take two character and generate a list of character between from and to.
  * Both are included.
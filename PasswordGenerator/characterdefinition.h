@@ -37,7 +37,6 @@ public:
     QList<QChar> characterSet() const                   { return m_characterList; }
     bool hasNoAmount() const                            { return m_amount < 1; }
     int characterCount() const                          { return m_characterList.size(); }
-    QList<QChar> getRandomSet() const;
 
 private:
     void setCharacterRange(const QChar from, const QChar to);
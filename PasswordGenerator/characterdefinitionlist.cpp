@@ -42,16 +42,19 @@ bool CharacterDefinitionList::appendDefinition(const CharacterDefinition &defini
  */
 bool CharacterDefinitionList::defineAmountForUndefined()
 {
+    if (m_shareCount == 0 && m_totalShareCount == 0) {
+        return true;                                // All amounts are given.
+    }
     if (m_shareCount < 1) {
         return false;
     }
     int distributedAmount = 0;
-    CharacterDefinition& greatestDefinition = m_definitionList[0];
+    int greatestIndex = -1;
     for (int index=0; index<m_definitionList.size(); ++index) {
         CharacterDefinition& definition = m_definitionList[index];
         if (definition.hasNoAmount()) {
-            if (greatestDefinition.characterCount() < definition.characterCount()) {
-                greatestDefinition = definition;
+            if (greatestIndex < 0 || m_definitionList[greatestIndex].characterCount() < definition.characterCount()) {
+                greatestIndex = index;
             }
             int characterCount = definition.characterCount();
             float amount = (float)characterCount / (float)m_totalShareCount * (float)m_shareCount;
@@ -59,7 +62,11 @@ bool CharacterDefinitionList::defineAmountForUndefined()
             distributedAmount += amount;
         }
     }
+    if (greatestIndex < 0) {
+        return false;
+    }
     if (distributedAmount < m_shareCount) {
+        CharacterDefinition& greatestDefinition = m_definitionList[greatestIndex];
         int tmpAmount = greatestDefinition.amount();
         int toAdd = m_shareCount - distributedAmount + tmpAmount;
         greatestDefinition.setAmount(toAdd);
@@ -67,19 +74,3 @@ bool CharacterDefinitionList::defineAmountForUndefined()
 
     return true;
 }
-
-/**
- * Get a random set of characters to generate a password out of it.
- * The character list is randomly taken from the definitions.
- * @return list     A list with characters to create a password.
- */
-QList<QChar> CharacterDefinitionList::getPasswordCharacterList() const
-{
-    QList<QChar> list;
-    for (int index=0; index<m_definitionList.size(); ++index) {
-        CharacterDefinition definition = m_definitionList[index];
-        list << definition.getRandomSet();
-    }
-
-    return list;
-}
@@ -10,7 +10,7 @@ public:
 
     bool appendDefinition(const CharacterDefinition& definition);
     bool defineAmountForUndefined();
-    QList<QChar> getPasswordCharacterList() const;
+    const QList<CharacterDefinition>& definitionList() const    { return m_definitionList; }
 
 private:
     QList<CharacterDefinition> m_definitionList;
@@ -0,0 +1,97 @@
+#include "passwordplan.h"
+#include "randomsource.h"
+#include <QVarLengthArray>
+#include <algorithm>
+
+static const int MaxCheckedDefinitions = 64;
+
+/**
+ * Constructor
+ * Compiles a parsed definition list into flat tables. The amount
+ * values of the definition list must be defined already.
+ * @param definitionList
+ */
+PasswordPlan::PasswordPlan(const CharacterDefinitionList &definitionList) :
+    m_length(0)
+{
+    const QList<CharacterDefinition>& list = definitionList.definitionList();
+    for (int index=0; index<list.size(); ++index) {
+        const CharacterDefinition& definition = list[index];
+        m_offsetList << m_characterTable.size();
+        m_amountList << definition.amount();
+        m_length += definition.amount();
+        m_characterTable << definition.characterSet().toVector();
+        if (index < MaxCheckedDefinitions) {
+            for (const QChar& character : definition.characterSet()) {
+                m_membership[character.unicode()] |= static_cast<quint64>(1) << index;
+            }
+        }
+    }
+    m_offsetList << m_characterTable.size();
+}
+
+/**
+ * Generates a password from this plan. Each character of a definition
+ * is used once at most.
+ * @param random        The random source of the calling thread.
+ * @return password
+ */
+QString PasswordPlan::generate(RandomSource &random) const
+{
+    QVarLengthArray<QChar, 256> scratch(m_characterTable.size());
+    std::copy(m_characterTable.constBegin(), m_characterTable.constEnd(), scratch.begin());
+    QString password(m_length, QChar());
+    QChar* pOut = password.data();
+    for (int definition=0; definition<m_amountList.size(); ++definition) {
+        QChar* pBegin = scratch.data() + m_offsetList[definition];
+        quint32 size = static_cast<quint32>(m_offsetList[definition + 1] - m_offsetList[definition]);
+        for (int index=0; index<m_amountList[definition]; ++index) {
+            quint32 other = index + random.bounded(size - index);
+            std::swap(pBegin[index], pBegin[other]);
+            *pOut++ = pBegin[index];
+        }
+    }
+    pOut = password.data();
+    for (int index=m_length-1; index>0; --index) {
+        int other = static_cast<int>(random.bounded(static_cast<quint32>(index + 1)));
+        std::swap(pOut[index], pOut[other]);
+    }
+
+    return password;
+}
+
+/**
+ * Checks if a password could have been generated from this plan. The
+ * length must match, each character must belong to one of the
+ * definitions and each definition must contribute at least its amount
+ * of characters. Only the first 64 definitions are counted.
+ * Thread safe.
+ * @param password
+ * @return              True if the password complies with the plan.
+ */
+bool PasswordPlan::accepts(const QString &password) const
+{
+    if (password.size() != m_length) {
+        return false;
+    }
+    QVarLengthArray<int, MaxCheckedDefinitions> countList(qMin(m_amountList.size(), MaxCheckedDefinitions));
+    std::fill(countList.begin(), countList.end(), 0);
+    for (const QChar& character : password) {
+        quint64 mask = m_membership.value(character.unicode(), 0);
+        if (mask == 0) {
+            return false;
+        }
+        for (int definition=0; mask != 0; ++definition, mask >>= 1) {
+            if (mask & 1) {
+                ++countList[definition];
+            }
+        }
+    }
+    for (int definition=0; definition<countList.size(); ++definition) {
+        if (countList[definition] < m_amountList[definition]) {
+            return false;
+        }
+    }
+
+    return true;
+}
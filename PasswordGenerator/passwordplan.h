@@ -0,0 +1,47 @@
+#ifndef PASSWORDPLAN_H
+#define PASSWORDPLAN_H
+
+/* -----------------------------------------------------------------------
+ * Class PasswordPlan
+ * -----------------------------------------------------------------------
+ * A compiled password definition for one password length. The plan is
+ * created once from a parsed CharacterDefinitionList and is immutable
+ * afterwards. It keeps the characters of all definitions in one flat
+ * table together with the offset and the amount of characters to take
+ * from each definition.
+ * Generating a password copies the flat table into a scratch buffer,
+ * picks the characters of each definition with a partial Fisher-Yates
+ * shuffle and shuffles the password in place. There is no parsing and
+ * no list handling per password.
+ * A plan can be shared between threads. Each thread passes its own
+ * RandomSource object.
+ * A plan also checks if an existing password could have been generated
+ * from it. Each character must belong to a definition and each
+ * definition must contribute at least its amount of characters.
+ */
+
+#include "characterdefinitionlist.h"
+#include <QVector>
+#include <QHash>
+
+class RandomSource;
+
+class PasswordPlan
+{
+public:
+    PasswordPlan(const CharacterDefinitionList& definitionList);
+
+    int length() const                                  { return m_length; }
+    QString generate(RandomSource& random) const;
+    bool accepts(const QString& password) const;
+
+private:
+    QVector<QChar> m_characterTable;
+    QVector<int> m_offsetList;
+    QVector<int> m_amountList;
+    // Bit n is set if the character belongs to definition n (first 64 only).
+    QHash<ushort, quint64> m_membership;
+    int m_length;
+};
+
+#endif // PASSWORDPLAN_H
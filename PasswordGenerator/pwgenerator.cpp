@@ -1,6 +1,9 @@
 #include "pwgenerator.h"
-#include <QTime>
-#include <QRandomGenerator>
+#include "randomsource.h"
+#include <QStringList>
+
+QHash<QString, QSharedPointer<const PasswordPlan>> PwGenerator::m_planCache;
+QMutex PwGenerator::m_planCacheMutex;
 
 /**
  * Constructor
@@ -20,36 +23,95 @@ PwGenerator::PwGenerator() :
  * @return
  */
 QString PwGenerator::passwordFromDefinition(const ushort passwordLength, const QString &definitionString)
+{
+    QStringList passwordList = passwordsFromDefinition(1, passwordLength, definitionString);
+
+    return passwordList.value(0);
+}
+
+/**
+ * Creates a number of passwords from the same definition and length.
+ * The definition is compiled once into a PasswordPlan. Plans are
+ * cached by definition and length, so accounts sharing a definition
+ * parse it only once.
+ * @param count             Number of passwords to create.
+ * @param passwordLength
+ * @param definitionString
+ * @return passwordList     The passwords or an empty list on error.
+ */
+QStringList PwGenerator::passwordsFromDefinition(const int count, const ushort passwordLength, const QString &definitionString)
+{
+    QStringList passwordList;
+    QSharedPointer<const PasswordPlan> plan = planFor(passwordLength, definitionString);
+    if (plan.isNull()) {
+        return passwordList;
+    }
+    RandomSource& random = RandomSource::threadInstance();
+    passwordList.reserve(count);
+    for (int number=0; number<count; ++number) {
+        passwordList << plan->generate(random);
+    }
+
+    return passwordList;
+}
+
+/**
+ * Get the compiled plan for a definition and length. Takes it from the
+ * plan cache or parses the definition string and compiles a new plan.
+ * Thread safe.
+ * @param passwordLength
+ * @param definitionString
+ * @return plan             The plan or a null pointer on error.
+ */
+QSharedPointer<const PasswordPlan> PwGenerator::planFor(const ushort passwordLength, const QString &definitionString)
 {
     int pwLength = passwordLength;
     QString pwDefinition(definitionString);
     if (definitionString.isEmpty()) {
         pwDefinition = m_standardDefinition;
     }
-
     if (pwLength < 1) {
         setErrorMessage(QString("Password length is %1 this is to less !").arg(pwLength));
-        pwLength = m_standardLength;
+        return QSharedPointer<const PasswordPlan>();
     }
-    CharacterDefinitionList definitionList(passwordLength);
+    QString key = QString::number(pwLength).append(':').append(pwDefinition);
+    {
+        QMutexLocker locker(&m_planCacheMutex);
+        QSharedPointer<const PasswordPlan> plan = m_planCache.value(key);
+        if (! plan.isNull()) {
+            return plan;
+        }
+    }
+
+    CharacterDefinitionList definitionList(pwLength);
     parseCharacterDefinitionString(pwDefinition, definitionList);
     if (hasError()) {
-        return QString();
+        return QSharedPointer<const PasswordPlan>();
     }
     if (! definitionList.defineAmountForUndefined()) {
         setErrorMessage(QString("Could not define the amount values of character definitions !"));
-        return QString();
+        return QSharedPointer<const PasswordPlan>();
+    }
+    for (const CharacterDefinition& definition : definitionList.definitionList()) {
+        if (definition.amount() > definition.characterCount()) {
+            setErrorMessage(QString("Definition needs %1 different characters but has only %2 !")
+                            .arg(definition.amount()).arg(definition.characterCount()));
+            return QSharedPointer<const PasswordPlan>();
+        }
+    }
+    QSharedPointer<const PasswordPlan> plan(new PasswordPlan(definitionList));
+    if (plan->length() != pwLength) {
+        setErrorMessage(QString("Definition gives %1 characters but password length is %2 !")
+                        .arg(plan->length()).arg(pwLength));
+        return QSharedPointer<const PasswordPlan>();
     }
-    QList<QChar> characterList = definitionList.getPasswordCharacterList();
-    QString password;
-    QRandomGenerator::global()->seed(QTime::currentTime().msec());
-    while (! characterList.isEmpty()) {
-        int index = QRandomGenerator::global()->generate() % characterList.size();
-        QChar current = characterList.takeAt(index);
-        password.append(current);
+    QMutexLocker locker(&m_planCacheMutex);
+    if (m_planCache.size() >= m_maxCachedPlans) {
+        m_planCache.clear();
     }
+    m_planCache.insert(key, plan);
 
-    return password;
+    return plan;
 }
 
 /**
@@ -3,6 +3,10 @@
 
 #include "characterdefinition.h"
 #include "characterdefinitionlist.h"
+#include "passwordplan.h"
+#include <QSharedPointer>
+#include <QMutex>
+#include <QHash>
 
 class PwGenerator
 {
@@ -16,11 +20,18 @@ private:
     bool m_hasError;
     QString m_standardDefinition;
     int m_standardLength;
+    // Compiled plans shared by all generators and threads.
+    static QHash<QString, QSharedPointer<const PasswordPlan>> m_planCache;
+    static QMutex m_planCacheMutex;
+    static const int m_maxCachedPlans = 256;
 
 public:
     bool hasError() const                       { return m_hasError; }
     QString errorMessage() const                { return m_errorMessage; }
+    int standardLength() const                  { return m_standardLength; }
     QString passwordFromDefinition(const ushort passwordLength, const QString &definitionString);
+    QStringList passwordsFromDefinition(const int count, const ushort passwordLength, const QString &definitionString);
+    QSharedPointer<const PasswordPlan> planFor(const ushort passwordLength, const QString &definitionString);
 
 private:
     CharacterDefinitionList parseCharacterDefinitionString(const QString &definitionString, CharacterDefinitionList& definitionList);
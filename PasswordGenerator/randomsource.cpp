@@ -0,0 +1,133 @@
+#include "randomsource.h"
+#include <QRandomGenerator>
+#include <cstring>
+
+static inline quint32 rotateLeft(const quint32 value, const int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static inline void quarterRound(quint32& a, quint32& b, quint32& c, quint32& d)
+{
+    a += b; d ^= a; d = rotateLeft(d, 16);
+    c += d; b ^= c; b = rotateLeft(b, 12);
+    a += b; d ^= a; d = rotateLeft(d, 8);
+    c += d; b ^= c; b = rotateLeft(b, 7);
+}
+
+/**
+ * Constructor
+ * Seeds the key from the random source of the operating system.
+ */
+RandomSource::RandomSource() :
+    m_counter(0),
+    m_position(BlockWords * BufferBlocks)
+{
+    QRandomGenerator::system()->fillRange(m_key);
+}
+
+/**
+ * Destructor
+ * Wipes key and buffered key stream.
+ */
+RandomSource::~RandomSource()
+{
+    std::memset(m_key, 0, sizeof(m_key));
+    std::memset(m_buffer, 0, sizeof(m_buffer));
+}
+
+/**
+ * Get the next random 32 bit word.
+ * @return
+ */
+quint32 RandomSource::generate()
+{
+    if (m_position >= BlockWords * BufferBlocks) {
+        refill();
+    }
+    quint32 value = m_buffer[m_position];
+    m_buffer[m_position++] = 0;
+
+    return value;
+}
+
+/**
+ * Get a uniformly distributed random value in the range [0, range).
+ * Uses multiply and shift and rejects the few values which would make
+ * the result biased. There is no modulo bias.
+ * @param range         Upper bound (exclusive). Must be greater than 0.
+ * @return
+ */
+quint32 RandomSource::bounded(const quint32 range)
+{
+    quint64 product = static_cast<quint64>(generate()) * range;
+    quint32 low = static_cast<quint32>(product);
+    if (low < range) {
+        const quint32 threshold = (0u - range) % range;
+        while (low < threshold) {
+            product = static_cast<quint64>(generate()) * range;
+            low = static_cast<quint32>(product);
+        }
+    }
+
+    return static_cast<quint32>(product >> 32);
+}
+
+/**
+ * Static
+ * Get the RandomSource object of the calling thread.
+ * @return
+ */
+RandomSource &RandomSource::threadInstance()
+{
+    thread_local RandomSource instance;
+
+    return instance;
+}
+
+/**
+ * Private
+ * Fills the buffer with key stream. The first half of the first block
+ * becomes the new key and is never handed out.
+ */
+void RandomSource::refill()
+{
+    for (int block=0; block<BufferBlocks; ++block) {
+        chachaBlock(m_counter++, m_buffer + block * BlockWords);
+    }
+    std::memcpy(m_key, m_buffer, sizeof(m_key));
+    std::memset(m_buffer, 0, sizeof(m_key));
+    m_position = KeyWords;
+}
+
+/**
+ * Private
+ * Computes one ChaCha20 block (RFC 8439) with the current key and a 64 bit
+ * block counter. The nonce is zero because every key is used only once.
+ * @param counter
+ * @param output        16 words of key stream.
+ */
+void RandomSource::chachaBlock(const quint64 counter, quint32 output[BlockWords]) const
+{
+    quint32 state[BlockWords] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        m_key[0], m_key[1], m_key[2], m_key[3],
+        m_key[4], m_key[5], m_key[6], m_key[7],
+        static_cast<quint32>(counter), static_cast<quint32>(counter >> 32), 0, 0
+    };
+    quint32 x[BlockWords];
+    std::memcpy(x, state, sizeof(x));
+    for (int round=0; round<10; ++round) {
+        quarterRound(x[0], x[4], x[8], x[12]);
+        quarterRound(x[1], x[5], x[9], x[13]);
+        quarterRound(x[2], x[6], x[10], x[14]);
+        quarterRound(x[3], x[7], x[11], x[15]);
+        quarterRound(x[0], x[5], x[10], x[15]);
+        quarterRound(x[1], x[6], x[11], x[12]);
+        quarterRound(x[2], x[7], x[8], x[13]);
+        quarterRound(x[3], x[4], x[9], x[14]);
+    }
+    for (int index=0; index<BlockWords; ++index) {
+        output[index] = x[index] + state[index];
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef RANDOMSOURCE_H
+#define RANDOMSOURCE_H
+
+/* -----------------------------------------------------------------------
+ * Class RandomSource
+ * -----------------------------------------------------------------------
+ * A cryptographically secure random number generator to pick password
+ * characters. It produces a ChaCha20 key stream into a buffer and hands
+ * out 32 bit words from that buffer. The key is seeded from the operating
+ * system. Each refill of the buffer replaces the key with key stream
+ * output (fast key erasure), so output already handed out can not be
+ * reconstructed from a later state.
+ * A RandomSource object is not thread safe. Use threadInstance() to get
+ * an object owned by the calling thread.
+ */
+
+#include <QtGlobal>
+
+class RandomSource
+{
+public:
+    RandomSource();
+    ~RandomSource();
+
+    quint32 generate();
+    quint32 bounded(const quint32 range);
+
+    static RandomSource& threadInstance();
+
+private:
+    enum { KeyWords = 8, BlockWords = 16, BufferBlocks = 16 };
+
+    quint32 m_key[KeyWords];
+    quint64 m_counter;
+    quint32 m_buffer[BlockWords * BufferBlocks];
+    int m_position;
+
+    void refill();
+    void chachaBlock(const quint64 counter, quint32 output[BlockWords]) const;
+};
+
+#endif // RANDOMSOURCE_H
@@ -11,6 +11,7 @@ Credentials::Credentials()
     m_keyMap.insert(QString("hostname"), Hostname);
     m_keyMap.insert(QString("port"), Port);
     m_keyMap.insert(QString("tablename"), TableName);
+    m_keyMap.insert(QString("replicahosts"), ReplicaHosts);
 }
 
 /**
@@ -66,6 +67,8 @@ bool Credentials::storeCredentialsToFile(const QString &path)
  * Credentials stored like:
  * password:pwofhorst
  * username:horst
+ * replicahosts:replica1,replica2:5433
+ * The key ends at the first colon. Unknown keys are skipped.
  * @param path
  * @return      True is done.
  */
@@ -83,9 +86,12 @@ bool Credentials::loadCredentialsFromFile(const QString &path)
     QTextStream inStream(&file);
     while (! inStream.atEnd()) {
         QString line = inStream.readLine();
-        QStringList keyValueList = line.split(QChar(':'), Qt::SkipEmptyParts);
-        Key key = static_cast<Key>(m_keyMap.value(keyValueList[0]));
-        QString value = keyValueList[1];
+        int separator = line.indexOf(QChar(':'));
+        if (separator < 0 || ! m_keyMap.contains(line.left(separator))) {
+            continue;
+        }
+        Key key = m_keyMap.value(line.left(separator));
+        QString value = line.mid(separator + 1);
         m_credentials.insert(key, value);
     }
     file.close();
@@ -9,7 +9,7 @@ class Credentials
 public:
     Credentials();
 
-    enum Key { Password, Username, DatabaseName, Hostname, Port, TableName };
+    enum Key { Password, Username, DatabaseName, Hostname, Port, TableName, ReplicaHosts };
 
     void addValue(const Key key, const QString &value);
     QString value(const Key key) const;
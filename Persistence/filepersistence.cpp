@@ -1,13 +1,17 @@
 #include "filepersistence.h"
+#include "vaultcipher.h"
 #include <QTextStream>
 #include <QDataStream>
+#include <QThread>
+#include <QtConcurrent>
 
 /**
  * @brief FilePersistence::FilePersistence
  */
 FilePersistence::FilePersistence() :
     m_pFile(NULL),
-    m_isModified(false)
+    m_isModified(false),
+    m_isTransactionModified(false)
 {
 
 }
@@ -37,7 +41,7 @@ QString FilePersistence::error() const
 bool FilePersistence::persistAccountObject(const OptionTable &account)
 {
     int index = findAccountObj(account);
-    if (index > 0) {
+    if (index >= 0) {
         m_error.append(QString("There is a existing Account object with that keys !\n"));
         m_error.append(QString("Can not insert new Account object !\n"));
 
@@ -46,6 +50,11 @@ bool FilePersistence::persistAccountObject(const OptionTable &account)
     m_isModified = true;
     QVariantMap object = variantMapFromOptionTable(account);
     m_fileContent << object;
+    index = m_fileContent.size() - 1;
+    if (object.contains("id")) {
+        m_primaryIndex.insert(object.value("id").toString(), index);
+    }
+    m_uniqueIndex.insert(qMakePair(object.value("provider").toString(), object.value("username").toString()), index);
 
     return true;
 }
@@ -65,6 +74,7 @@ int FilePersistence::deleteAccountObject(const OptionTable &account)
     }
     m_fileContent.removeAt(index);
     m_isModified = true;
+    buildIndexes();
 
     return 1;
 }
@@ -89,17 +99,60 @@ bool FilePersistence::modifyAccountObject(const OptionTable &modifications)
         modifyValues.remove(optionToRealName('p'));
         modifyValues.remove(optionToRealName('u'));
     }
-    QVariantMap originObject = m_fileContent[index];
+    QVariantMap& originObject = m_fileContent[index];
     QStringList keyList = modifyValues.keys();
     for (int index=0; index<keyList.size(); ++index) {
         QVariant value = modifyValues.value(keyList[index]);
         originObject.insert(keyList[index], value);
     }
     m_isModified = true;
+    if (modifyValues.contains("id") || modifyValues.contains("provider") || modifyValues.contains("username")) {
+        buildIndexes();
+    }
 
     return true;
 }
 
+/**
+ * Modifies a list of Account objects one by one. Stops at the first
+ * modification which fails.
+ * @param modificationList
+ * @return                  Number of modified Account objects.
+ */
+int FilePersistence::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    int modified = 0;
+    for (const OptionTable& modifications : modificationList) {
+        if (! modifyAccountObject(modifications)) {
+            break;
+        }
+        ++modified;
+    }
+
+    return modified;
+}
+
+/**
+ * Inserts an Account object or updates the one with the same provider
+ * and username. The Account object is found by the unique index.
+ * @param account           Values of the Account object. Needs provider and username.
+ * @param insertOnlyList    Options which are not changed on update.
+ * @return                  Inserted, updated or failed.
+ */
+Persistence::UpsertResult FilePersistence::upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList)
+{
+    OptionTable values(account);
+    values.remove('i');
+    if (findWithUnique(values.value('p'), values.value('u')) < 0) {
+        return persistAccountObject(values) ? UpsertInserted : UpsertFailed;
+    }
+    for (const char option : insertOnlyList) {
+        values.remove(option);
+    }
+
+    return modifyAccountObject(values) ? UpsertUpdated : UpsertFailed;
+}
+
 /**
  * @brief FilePersistence::findAccount
  * @param searchObj
@@ -136,8 +189,68 @@ QVariantMap FilePersistence::findUser(const OptionTable &userInfo)
  */
 QList<QVariantMap> FilePersistence::findAccountsLike(const OptionTable &searchObj)
 {
-    Q_UNUSED(searchObj)
-    return QList<QVariantMap>();
+    QList<QVariantMap> accountList;
+    streamAccountsLike(searchObj, [&accountList](const QList<QVariantMap>& batch) {
+        accountList << batch;
+        return true;
+    });
+
+    return accountList;
+}
+
+/**
+ * Hands all Account objects which match the values of the search object
+ * in batches to a visitor. Only the attributes given as options are
+ * taken into the Account objects.
+ * @param searchObj
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if done.
+ */
+bool FilePersistence::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                                         const int batchSize)
+{
+    QVariantMap searchValues;
+    QStringList columnList;
+    for (OptionTable::const_iterator iter=searchObj.constBegin(); iter!=searchObj.constEnd(); ++iter) {
+        QString columnName = optionToRealName(iter.key());
+        if (columnName.isEmpty()) {
+            continue;
+        }
+        columnList << columnName;
+        if (iter.value().isValid()) {
+            searchValues.insert(columnName, iter.value());
+        }
+    }
+    QList<QVariantMap> accountList;
+    for (const QVariantMap& object : m_fileContent) {
+        bool isMatch = true;
+        for (QVariantMap::const_iterator iter=searchValues.constBegin(); iter!=searchValues.constEnd(); ++iter) {
+            if (object.value(iter.key()) != iter.value()) {
+                isMatch = false;
+                break;
+            }
+        }
+        if (! isMatch) {
+            continue;
+        }
+        QVariantMap account;
+        for (const QString& column : columnList) {
+            account.insert(column, object.value(column));
+        }
+        accountList << account;
+        if (accountList.size() >= batchSize) {
+            if (! visitor(accountList)) {
+                return true;
+            }
+            accountList.clear();
+        }
+    }
+    if (! accountList.isEmpty()) {
+        visitor(accountList);
+    }
+
+    return true;
 }
 
 /**
@@ -201,6 +314,92 @@ bool FilePersistence::hasError() const
     return ! m_error.isEmpty();
 }
 
+/**
+ * Protected
+ * Begins a transaction. The content is kept in memory until close(), so
+ * a transaction is a copy of the content to return to.
+ * @return
+ */
+bool FilePersistence::executeBegin()
+{
+    m_transactionContent = m_fileContent;
+    m_isTransactionModified = m_isModified;
+
+    return true;
+}
+
+/**
+ * Protected
+ * Commits a transaction. The changes are written with the content on close().
+ * @return
+ */
+bool FilePersistence::executeCommit()
+{
+    m_transactionContent.clear();
+
+    return true;
+}
+
+/**
+ * Deletes all Account objects which match the search values and the
+ * filter. All of them are removed in one pass and the indexes are built
+ * once, not once per Account object.
+ * @param searchObj         Search values.
+ * @param filter
+ * @param maxRows           Nothing is deleted if more Account objects match. 0 for no limit.
+ * @param isDryRun          Only count the matching Account objects.
+ * @return                  Number of matching Account objects. -1 on error.
+ */
+int FilePersistence::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                         const int maxRows, const bool isDryRun)
+{
+    QVariantList idList;
+    if (! matchingIds(searchObj, filter, idList)) {
+        return -1;
+    }
+    if (isDryRun || (maxRows > 0 && idList.size() > maxRows)) {
+        return idList.size();
+    }
+    QSet<int> deletedSet;
+    deletedSet.reserve(idList.size());
+    for (const QVariant& id : idList) {
+        int index = findWithPrimaryKey(id);
+        if (index < 0) {
+            m_error.append(QString("Could not delete Account object !\n"));
+            m_error.append(QString("There is no such Account object stored !\n"));
+            return -1;
+        }
+        deletedSet.insert(index);
+    }
+    QList<QVariantMap> keptList;
+    keptList.reserve(m_fileContent.size() - deletedSet.size());
+    for (int index=0; index<m_fileContent.size(); ++index) {
+        if (! deletedSet.contains(index)) {
+            keptList << m_fileContent[index];
+        }
+    }
+    m_fileContent.swap(keptList);
+    m_isModified = true;
+    buildIndexes();
+
+    return idList.size();
+}
+
+/**
+ * Protected
+ * Rolls back a transaction to the content at its begin.
+ * @return
+ */
+bool FilePersistence::executeRollback()
+{
+    m_fileContent = m_transactionContent;
+    m_isModified = m_isTransactionModified;
+    m_transactionContent.clear();
+    buildIndexes();
+
+    return true;
+}
+
 /**
  * @brief FilePersistence::persistContent
  * @return
@@ -222,6 +421,8 @@ bool FilePersistence::persistContent()
         QVariantMap object = m_fileContent.takeFirst();
         outStream << object;
     }
+    m_primaryIndex.clear();
+    m_uniqueIndex.clear();
 
     return true;
 }
@@ -233,14 +434,7 @@ bool FilePersistence::persistContent()
  */
 int FilePersistence::findWithPrimaryKey(const QVariant& primaryKey) const
 {
-    for (int index=0; index<m_fileContent.size(); ++index) {
-        QVariant key = m_fileContent[index].value("id");
-        if (key == primaryKey) {
-            return index;
-        }
-    }
-
-    return -1;
+    return m_primaryIndex.value(primaryKey.toString(), -1);
 }
 
 /**
@@ -251,15 +445,25 @@ int FilePersistence::findWithPrimaryKey(const QVariant& primaryKey) const
  */
 int FilePersistence::findWithUnique(const QVariant &provider, const QVariant &username) const
 {
+    return m_uniqueIndex.value(qMakePair(provider.toString(), username.toString()), -1);
+}
+
+/**
+ * Protected
+ * Builds the indexes by id and by provider and username. Needed after
+ * the positions of the Account objects have changed.
+ */
+void FilePersistence::buildIndexes()
+{
+    m_primaryIndex.clear();
+    m_uniqueIndex.clear();
     for (int index=0; index<m_fileContent.size(); ++index) {
-        QVariant existProvider = m_fileContent[index].value("provider");
-        QVariant existUsername = m_fileContent[index].value("username");
-        if (existProvider == provider && existUsername == username) {
-            return index;
+        const QVariantMap& object = m_fileContent[index];
+        if (object.contains("id")) {
+            m_primaryIndex.insert(object.value("id").toString(), index);
         }
+        m_uniqueIndex.insert(qMakePair(object.value("provider").toString(), object.value("username").toString()), index);
     }
-
-    return -1;
 }
 
 /**
@@ -298,36 +502,121 @@ QVariantMap FilePersistence::variantMapFromOptionTable(const OptionTable &accoun
 }
 
 /**
- * @brief FilePersistence::persistReadableFile
+ * Writes all accounts into a readable text file. Each attribute is
+ * written as 'key: value' line, accounts are separated by a line.
+ * An existing file is overwritten.
+ * The accounts are cut into chunks. A window of chunks is formatted in
+ * parallel into one buffer per chunk, then the buffers are written in
+ * order. So only one window of text is held in memory.
  * @param filePath
- * @return
+ * @param accountList
+ * @return                  True if done.
  */
 bool FilePersistence::persistReadableFile(const QString &filePath, const QList<QVariantMap>& accountList)
 {
-    if (! open(filePath)) {
+    QFile file(filePath);
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
         m_error += QString("Could not open file !\n");
-        m_error += m_pFile->errorString().append('\n');
+        m_error += file.errorString().append('\n');
         return false;
     }
-    QTextStream outStream(m_pFile);
-    for (int index=0; index<accountList.size(); ++index) {
-        const QVariantMap& account = accountList.at(index);
-        QStringList keyList = account.keys();
-        for (int keyIndex=0; keyIndex<keyList.size(); ++keyIndex) {
-            const QVariant value = account.value(keyList[keyIndex]);
-            if (! value.isValid()) {
-                continue;
+    struct FormatJob {
+        int firstRecord;
+        int recordCount;
+        QByteArray text;
+    };
+    const int windowSize = qMax(QThread::idealThreadCount(), 1) * 2;
+    const int chunkSize = m_exportChunkSize;
+    int nextRecord = 0;
+    while (nextRecord < accountList.size()) {
+        QVector<FormatJob> jobList;
+        while (jobList.size() < windowSize && nextRecord < accountList.size()) {
+            FormatJob job;
+            job.firstRecord = nextRecord;
+            job.recordCount = qMin(chunkSize, accountList.size() - nextRecord);
+            jobList << job;
+            nextRecord += job.recordCount;
+        }
+        QtConcurrent::blockingMap(jobList, [&accountList](FormatJob& job) {
+            QString text;
+            for (int index=job.firstRecord; index<job.firstRecord + job.recordCount; ++index) {
+                const QVariantMap& account = accountList.at(index);
+                for (QVariantMap::const_iterator iter=account.constBegin(); iter!=account.constEnd(); ++iter) {
+                    if (! iter.value().isValid()) {
+                        continue;
+                    }
+                    text.append(iter.key()).append(QLatin1String(": ")).append(iter.value().toString()).append('\n');
+                }
+                text.append(QLatin1String("-----------------------------------------\n"));
+            }
+            job.text = text.toUtf8();
+        });
+        for (const FormatJob& job : jobList) {
+            if (file.write(job.text) != job.text.size()) {
+                m_error += QString("Could not write file !\n");
+                m_error += file.errorString().append('\n');
+                return false;
             }
-            QString line = keyList[keyIndex] + ": " + value.toString();
-            outStream << line << Qt::endl;
         }
-        outStream << QString("-----------------------------------------") << Qt::endl;
     }
-    close();
+    file.close();
 
     return true;
 }
 
+/**
+ * Writes all accounts into an encrypted vault file. An existing file
+ * is overwritten.
+ * @param filePath          Path of the vault file.
+ * @param passphrase        Passphrase to derive the key from.
+ * @param accountList       The Account objects to store.
+ * @return                  True if done.
+ */
+bool FilePersistence::persistEncryptedFile(const QString &filePath, const QString &passphrase,
+                                           const QList<QVariantMap> &accountList)
+{
+    VaultCipher cipher(passphrase);
+    if (! cipher.writeVault(filePath, accountList)) {
+        m_error.append(cipher.error());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Reads all accounts from an encrypted vault file.
+ * @param filePath          Path of the vault file.
+ * @param passphrase        Passphrase to derive the key from.
+ * @return accountList      The Account objects of the vault.
+ */
+QList<QVariantMap> FilePersistence::readEncryptedFile(const QString &filePath, const QString &passphrase)
+{
+    VaultCipher cipher(passphrase);
+    QList<QVariantMap> accountList = cipher.readVault(filePath);
+    m_error.append(cipher.error());
+
+    return accountList;
+}
+
+/**
+ * Reads a single account from an encrypted vault file. Just the
+ * chunk which holds the account is decrypted.
+ * @param filePath          Path of the vault file.
+ * @param passphrase        Passphrase to derive the key from.
+ * @param recordIndex       Position of account in vault. Starts with 0.
+ * @return account          The Account object or an empty map.
+ */
+QVariantMap FilePersistence::readEncryptedRecord(const QString &filePath, const QString &passphrase,
+                                                 const int recordIndex)
+{
+    VaultCipher cipher(passphrase);
+    QVariantMap account = cipher.readRecord(filePath, recordIndex);
+    m_error.append(cipher.error());
+
+    return account;
+}
+
 /**
  * @brief FilePersistence::open
  * @param parameter
@@ -348,6 +637,7 @@ bool FilePersistence::open(const QString &parameter)
         inStream >> object;
         m_fileContent << object;
     }
+    buildIndexes();
 
     return true;
 }
@@ -357,6 +647,7 @@ bool FilePersistence::open(const QString &parameter)
  */
 void FilePersistence::close()
 {
+    abortTransaction();
     if (isOpen()) {
         persistContent();
         m_pFile->close();
@@ -2,6 +2,9 @@
 #define FILEPERSISTENCE_H
 
 #include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 #include "Persistence/persistence.h"
 
 class FilePersistence : public Persistence
@@ -12,6 +15,10 @@ public:
 
     // Opens the file and writes the content.
     bool persistReadableFile(const QString& filePath, const QList<QVariantMap> &accountList);
+    // Encrypted vault file.
+    bool persistEncryptedFile(const QString& filePath, const QString& passphrase, const QList<QVariantMap> &accountList);
+    QList<QVariantMap> readEncryptedFile(const QString& filePath, const QString& passphrase);
+    QVariantMap readEncryptedRecord(const QString& filePath, const QString& passphrase, const int recordIndex);
 
     // Persistence interface
     bool open(const QString &parameter) override;
@@ -20,25 +27,44 @@ public:
     bool persistAccountObject(const OptionTable &account) override;
     int deleteAccountObject(const OptionTable &account) override;
     bool modifyAccountObject(const OptionTable &modifications) override;
+    int modifyAccountObjects(const QList<OptionTable> &modificationList) override;
+    int deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    UpsertResult upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList) override;
     QVariantMap findAccount(const OptionTable &searchObj) override;
     QVariantMap findUser(const OptionTable &userInfo) override;
     QList<QVariantMap> findAccountsLike(const OptionTable &searchObj) override;
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                            const int batchSize = 4096) override;
     QList<QVariantMap> allPersistedAccounts() override;
     QString optionToRealName(const char option) const override;
     bool hasError() const override;
 
 protected:
+    // Transactions
+    bool executeBegin() override;
+    bool executeCommit() override;
+    bool executeRollback() override;
     bool persistContent();
     int findWithPrimaryKey(const QVariant &primaryKey) const;
     int findWithUnique(const QVariant &provider, const QVariant &username) const;
     int findAccountObj(const OptionTable& account) const;
     QVariantMap variantMapFromOptionTable(const OptionTable& account) const;
+    void buildIndexes();
 
 private:
     QFile* m_pFile;
     QString m_error;
     QList<QVariantMap> m_fileContent;
+    // Positions in m_fileContent by id and by provider and username.
+    QHash<QString, int> m_primaryIndex;
+    QHash<QPair<QString, QString>, int> m_uniqueIndex;
+    // Content at begin of the transaction.
+    QList<QVariantMap> m_transactionContent;
+    bool m_isTransactionModified;
     bool m_isModified;
+    // Records per chunk of the readable export.
+    static const int m_exportChunkSize = 4096;
 };
 
 #endif // FILEPERSISTENCE_H
@@ -0,0 +1,441 @@
+#include "localreplica.h"
+#include "vaultcipher.h"
+#include <QFile>
+#include <QSet>
+
+/**
+ * Constructor
+ * Takes the ownership of the server persistence.
+ * @param pServer           Persistence which gets all writes.
+ * @param filePath          Path of the vault file of the copy.
+ * @param passphrase        Passphrase of the vault file.
+ */
+LocalReplica::LocalReplica(Persistence *pServer, const QString &filePath, const QString &passphrase) :
+    PersistenceProxy(pServer),
+    m_filePath(filePath),
+    m_passphrase(passphrase),
+    m_isSynced(false),
+    m_isModified(false),
+    m_isUnsupported(false),
+    m_hasWritten(false)
+{
+
+}
+
+/**
+ * Destructor
+ */
+LocalReplica::~LocalReplica()
+{
+    close();
+}
+
+/**
+ * Opens the server and reads the copy. A copy which can not be read is
+ * loaded again from the server.
+ * @param parameter         Parameter of the server.
+ * @return                  False if the server can not be opened.
+ */
+bool LocalReplica::open(const QString &parameter)
+{
+    if (! PersistenceProxy::open(parameter)) {
+        return false;
+    }
+    if (! readReplica()) {
+        m_accountList.clear();
+        m_userKey.clear();
+        m_watermark = QVariant();
+        m_syncedAt = QDateTime();
+        buildIndex();
+    }
+
+    return true;
+}
+
+/**
+ * Writes the copy if it was changed and closes the server.
+ */
+void LocalReplica::close()
+{
+    abortTransaction();
+    if (isOpen() && m_isModified) {
+        writeReplica();
+    }
+    PersistenceProxy::close();
+}
+
+// Override
+bool LocalReplica::persistAccountObject(const OptionTable &account)
+{
+    m_hasWritten = true;
+    return PersistenceProxy::persistAccountObject(account);
+}
+
+// Override
+int LocalReplica::deleteAccountObject(const OptionTable &account)
+{
+    m_hasWritten = true;
+    return PersistenceProxy::deleteAccountObject(account);
+}
+
+// Override
+bool LocalReplica::modifyAccountObject(const OptionTable &modifications)
+{
+    m_hasWritten = true;
+    return PersistenceProxy::modifyAccountObject(modifications);
+}
+
+// Override
+int LocalReplica::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    m_hasWritten = true;
+    return PersistenceProxy::modifyAccountObjects(modificationList);
+}
+
+// Override
+int LocalReplica::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                      const int maxRows, const bool isDryRun)
+{
+    m_hasWritten = m_hasWritten || ! isDryRun;
+    return PersistenceProxy::deleteAccountsWhere(searchObj, filter, maxRows, isDryRun);
+}
+
+// Override
+int LocalReplica::modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                                      const int maxRows, const bool isDryRun)
+{
+    m_hasWritten = m_hasWritten || ! isDryRun;
+    return PersistenceProxy::modifyAccountsWhere(modifications, filter, maxRows, isDryRun);
+}
+
+// Override
+Persistence::UpsertResult LocalReplica::upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList)
+{
+    m_hasWritten = true;
+    return PersistenceProxy::upsertAccountObject(account, insertOnlyList);
+}
+
+/**
+ * Finds an Account object in the copy by its id or by provider and
+ * username. Like the server there is no error if it is not found.
+ * @param searchObj
+ * @return                  The selected columns. Or an empty map.
+ */
+QVariantMap LocalReplica::findAccount(const OptionTable &searchObj)
+{
+    if (! isServedLocally(searchObj)) {
+        return hasOwnError() ? QVariantMap() : PersistenceProxy::findAccount(searchObj);
+    }
+    int index = findAccountIndex(searchObj);
+    if (index < 0) {
+        return QVariantMap();
+    }
+
+    return selectColumns(m_accountList[index], searchObj);
+}
+
+/**
+ * Hands the Account objects of the copy which match the values of the
+ * search object in batches to a visitor.
+ * @param searchObj
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if done.
+ */
+bool LocalReplica::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                                      const int batchSize)
+{
+    if (! isServedLocally(searchObj)) {
+        return ! hasOwnError() && PersistenceProxy::streamAccountsLike(searchObj, visitor, batchSize);
+    }
+    QVariantMap searchValues;
+    for (OptionTable::const_iterator iter=searchObj.constBegin(); iter!=searchObj.constEnd(); ++iter) {
+        QString columnName = optionToRealName(iter.key());
+        if (! columnName.isEmpty() && iter.value().isValid()) {
+            searchValues.insert(columnName, iter.value());
+        }
+    }
+    QList<QVariantMap> accountList;
+    for (const QVariantMap& object : m_accountList) {
+        bool isMatch = true;
+        for (QVariantMap::const_iterator iter=searchValues.constBegin(); iter!=searchValues.constEnd(); ++iter) {
+            if (object.value(iter.key()) != iter.value()) {
+                isMatch = false;
+                break;
+            }
+        }
+        if (! isMatch) {
+            continue;
+        }
+        accountList << selectColumns(object, searchObj);
+        if (accountList.size() >= batchSize) {
+            if (! visitor(accountList)) {
+                return true;
+            }
+            accountList.clear();
+        }
+    }
+    if (! accountList.isEmpty()) {
+        visitor(accountList);
+    }
+
+    return true;
+}
+
+/**
+ * The copy is filtered and paged in memory by the default of the
+ * interface. Otherwise the server compiles the filter.
+ * @param searchObj
+ * @param filter
+ * @param page
+ * @param visitor
+ * @param batchSize
+ * @return
+ */
+bool LocalReplica::streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                       const AccountPage &page, const AccountBatchVisitor &visitor,
+                                       const int batchSize)
+{
+    if (! isServedLocally(searchObj)) {
+        return ! hasOwnError() && PersistenceProxy::streamAccountsWhere(searchObj, filter, page, visitor, batchSize);
+    }
+
+    return Persistence::streamAccountsWhere(searchObj, filter, page, visitor, batchSize);
+}
+
+/**
+ * Protected
+ * Begins a transaction of the server. Reads go to the server until the
+ * end of the process.
+ * @return
+ */
+bool LocalReplica::executeBegin()
+{
+    m_hasWritten = true;
+
+    return PersistenceProxy::executeBegin();
+}
+
+/**
+ * Private
+ * True if a read is served by the copy. The copy is brought up to date
+ * first. It is false after a write, within a transaction and if the
+ * copy could not be updated. An error is set if updating has failed.
+ * @param searchObj
+ * @return
+ */
+bool LocalReplica::isServedLocally(const OptionTable &searchObj)
+{
+    if (m_hasWritten || isInTransaction() || m_isUnsupported) {
+        return false;
+    }
+
+    return syncReplica(searchObj);
+}
+
+/**
+ * Private
+ * Pulls the changes since the watermark into the copy. It is done once
+ * per run. A copy of another user or behind the kept tombstones is
+ * loaded again.
+ * @param searchObj         Option table with the user ('U').
+ * @return                  False on error or if the server has no change tracking.
+ */
+bool LocalReplica::syncReplica(const OptionTable &searchObj)
+{
+    if (m_isSynced) {
+        return true;
+    }
+    QString currentUserKey = userKey(searchObj);
+    QDateTime currentTime = QDateTime::currentDateTimeUtc();
+    QVariant since;
+    // A day is left for the difference of the clocks.
+    if (currentUserKey == m_userKey && m_watermark.isValid() && m_syncedAt.isValid()
+            && m_syncedAt.addDays(m_tombstoneDays - 1) > currentTime) {
+        since = m_watermark;
+    }
+    OptionTable userObj;
+    userObj.insert('U', searchObj.value('U'));
+    QList<QVariantMap> changedList;
+    QVariantList deletedList;
+    QVariant watermark;
+    bool isDone = server()->findChangesSince(userObj, since, [&changedList](const QList<QVariantMap>& batch) {
+        changedList << batch;
+        return true;
+    }, deletedList, watermark);
+    if (! isDone) {
+        if (server()->hasError()) {
+            appendError(QString("Could not update the local replica '%1' !\n").arg(m_filePath));
+        } else {
+            m_isUnsupported = true;
+        }
+        return false;
+    }
+    if (! since.isValid()) {
+        m_accountList.clear();
+        buildIndex();
+        m_isModified = true;
+    }
+    if (applyChanges(changedList, deletedList)) {
+        m_isModified = true;
+    }
+    m_userKey = currentUserKey;
+    m_watermark = watermark;
+    m_syncedAt = currentTime;
+    m_isSynced = true;
+
+    return true;
+}
+
+/**
+ * Private
+ * Replaces or appends the changed Account objects and removes the
+ * deleted ones. Account objects read again unchanged are no change.
+ * @param changedList
+ * @param deletedList       Ids of deleted Account objects.
+ * @return                  True if the copy was changed.
+ */
+bool LocalReplica::applyChanges(const QList<QVariantMap> &changedList, const QVariantList &deletedList)
+{
+    QString idName = optionToRealName('i');
+    bool isChanged = false;
+    for (const QVariantMap& account : changedList) {
+        QString id = account.value(idName).toString();
+        int index = m_idIndex.value(id, -1);
+        if (index < 0) {
+            m_idIndex.insert(id, m_accountList.size());
+            m_accountList << account;
+            isChanged = true;
+        } else if (m_accountList[index] != account) {
+            m_accountList[index] = account;
+            isChanged = true;
+        }
+    }
+    QSet<QString> deletedSet;
+    for (const QVariant& id : deletedList) {
+        if (m_idIndex.contains(id.toString())) {
+            deletedSet.insert(id.toString());
+        }
+    }
+    if (! deletedSet.isEmpty()) {
+        QList<QVariantMap> accountList;
+        accountList.reserve(m_accountList.size() - deletedSet.size());
+        for (const QVariantMap& account : m_accountList) {
+            if (! deletedSet.contains(account.value(idName).toString())) {
+                accountList << account;
+            }
+        }
+        m_accountList = accountList;
+        buildIndex();
+        isChanged = true;
+    }
+
+    return isChanged;
+}
+
+/**
+ * Private
+ * Reads the copy from the vault file. The first record holds the state
+ * of the copy. No file is an empty copy.
+ * @return                  False if the file can not be read.
+ */
+bool LocalReplica::readReplica()
+{
+    if (! QFile::exists(m_filePath)) {
+        return false;
+    }
+    VaultCipher cipher(m_passphrase);
+    QList<QVariantMap> recordList = cipher.readVault(m_filePath);
+    if (cipher.hasError() || recordList.isEmpty() || recordList.first().value("replica").toInt() != m_version) {
+        return false;
+    }
+    QVariantMap state = recordList.takeFirst();
+    m_userKey = state.value("user").toString();
+    m_watermark = state.value("watermark");
+    m_syncedAt = state.value("synced").toDateTime();
+    m_accountList = recordList;
+    buildIndex();
+
+    return true;
+}
+
+/**
+ * Private
+ * Writes the state and the copy into the vault file. Only the owner
+ * may read it.
+ * @return                  False on error.
+ */
+bool LocalReplica::writeReplica()
+{
+    QVariantMap state;
+    state.insert("replica", m_version);
+    state.insert("user", m_userKey);
+    state.insert("watermark", m_watermark);
+    state.insert("synced", m_syncedAt);
+    VaultCipher cipher(m_passphrase);
+    if (! cipher.writeVault(m_filePath, QList<QVariantMap>() << state << m_accountList)) {
+        appendError(cipher.error());
+        return false;
+    }
+    QFile::setPermissions(m_filePath, QFile::ReadOwner | QFile::WriteOwner);
+    m_isModified = false;
+
+    return true;
+}
+
+/**
+ * Private
+ * Builds the index of positions by id.
+ */
+void LocalReplica::buildIndex()
+{
+    QString idName = optionToRealName('i');
+    m_idIndex.clear();
+    for (int index=0; index<m_accountList.size(); ++index) {
+        m_idIndex.insert(m_accountList[index].value(idName).toString(), index);
+    }
+}
+
+/**
+ * Private
+ * Position of an Account object by its id. Or by provider and username
+ * if there is no id.
+ * @param searchObj
+ * @return                  The position. Or -1.
+ */
+int LocalReplica::findAccountIndex(const OptionTable &searchObj) const
+{
+    if (searchObj.value('i').isValid()) {
+        return m_idIndex.value(searchObj.value('i').toString(), -1);
+    }
+    QString providerName = optionToRealName('p');
+    QString usernameName = optionToRealName('u');
+    for (int index=0; index<m_accountList.size(); ++index) {
+        const QVariantMap& object = m_accountList[index];
+        if (object.value(providerName) == searchObj.value('p') && object.value(usernameName) == searchObj.value('u')) {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Private
+ * Takes the columns of the options of the search object.
+ * @param object
+ * @param searchObj
+ * @return
+ */
+QVariantMap LocalReplica::selectColumns(const QVariantMap &object, const OptionTable &searchObj) const
+{
+    QVariantMap account;
+    for (OptionTable::const_iterator iter=searchObj.constBegin(); iter!=searchObj.constEnd(); ++iter) {
+        QString columnName = optionToRealName(iter.key());
+        if (! columnName.isEmpty()) {
+            account.insert(columnName, object.value(columnName));
+        }
+    }
+
+    return account;
+}
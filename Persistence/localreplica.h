@@ -0,0 +1,89 @@
+#ifndef LOCALREPLICA_H
+#define LOCALREPLICA_H
+
+/* ------------------------------------------------------------------------------
+ * Class LocalReplica
+ *
+ * A persistence which serves the reads of Account objects from a local copy
+ * and sends all writes to a server persistence. The copy holds the Account
+ * objects of the current user in an encrypted vault file (see VaultCipher).
+ * - Before the first read the copy is brought up to date. Only the Account
+ *   objects changed since the watermark and the ids of the deleted ones are
+ *   pulled (see Persistence::findChangesSince()). The watermark is ordered
+ *   by the commits of the server, so a late commit is not missed.
+ * - After a write or within a transaction all reads go to the server. The
+ *   next run pulls the changes.
+ * - A copy of another user, an unreadable copy or a copy older than the
+ *   tombstones kept by the server is loaded again.
+ * - A server without change tracking serves all reads itself.
+ * The replica is chosen with environment variable PWMANAGER_REPLICA=<file>.
+ * The passphrase is taken from environment variable PWMANAGER_PASSPHRASE.
+ * ------------------------------------------------------------------------------
+ */
+
+#include "persistenceproxy.h"
+#include <QDateTime>
+#include <QHash>
+
+class LocalReplica : public PersistenceProxy
+{
+public:
+    LocalReplica(Persistence* pServer, const QString& filePath, const QString& passphrase);
+    ~LocalReplica() override;
+
+    // Persistence interface
+public:
+    bool open(const QString& parameter = QString()) override;
+    void close() override;
+    // Writes go to the server.
+    bool persistAccountObject(const OptionTable &account) override;
+    int deleteAccountObject(const OptionTable &account) override;
+    bool modifyAccountObject(const OptionTable &modifications) override;
+    int modifyAccountObjects(const QList<OptionTable> &modificationList) override;
+    int deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    int modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    UpsertResult upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList) override;
+    // Reads are served by the copy.
+    QVariantMap findAccount(const OptionTable &searchObj) override;
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                            const int batchSize = 4096) override;
+    bool streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                             const AccountPage &page, const AccountBatchVisitor &visitor,
+                             const int batchSize = 4096) override;
+
+protected:
+    bool executeBegin() override;
+
+private:
+    QString m_filePath;
+    QString m_passphrase;
+    // The copy
+    QList<QVariantMap> m_accountList;
+    QHash<QString, int> m_idIndex;
+    QString m_userKey;
+    QVariant m_watermark;
+    QDateTime m_syncedAt;
+    bool m_isSynced;
+    bool m_isModified;
+    bool m_isUnsupported;
+    bool m_hasWritten;
+    static const int m_version = 2;
+    // The server prunes older tombstones (see migration 005).
+    static const int m_tombstoneDays = 30;
+
+    // Synchronization
+    bool isServedLocally(const OptionTable& searchObj);
+    bool syncReplica(const OptionTable& searchObj);
+    bool applyChanges(const QList<QVariantMap>& changedList, const QVariantList& deletedList);
+    // Vault file
+    bool readReplica();
+    bool writeReplica();
+    void buildIndex();
+    // Lookup
+    int findAccountIndex(const OptionTable& searchObj) const;
+    QVariantMap selectColumns(const QVariantMap& object, const OptionTable& searchObj) const;
+};
+
+#endif // LOCALREPLICA_H
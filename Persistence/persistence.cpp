@@ -1,10 +1,15 @@
 #include "persistence.h"
+#include "transactionguard.h"
+#include <QDateTime>
+#include <algorithm>
 
 /**
  * Constructor
  */
 Persistence::Persistence() :
-    m_isOpen(false)
+    m_isOpen(false),
+    m_transactionDepth(0),
+    m_isRollbackOnly(false)
 {
 
 }
@@ -29,3 +34,507 @@ bool Persistence::isOpen() const
 {
     return m_isOpen;
 }
+
+/**
+ * Virtual public
+ * Deletes all Account objects which match the search values and the
+ * filter. This default finds their ids first and deletes them one by one
+ * in one transaction. The first failed delete rolls all of them back.
+ * @param searchObj         Search values. The user id ('U') restricts to the user.
+ * @param filter
+ * @param maxRows           Nothing is deleted if more Account objects match. 0 for no limit.
+ * @param isDryRun          Only count the matching Account objects.
+ * @return                  Number of matching Account objects. -1 on error.
+ */
+int Persistence::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                     const int maxRows, const bool isDryRun)
+{
+    QVariantList idList;
+    if (! matchingIds(searchObj, filter, idList)) {
+        return -1;
+    }
+    if (isDryRun || (maxRows > 0 && idList.size() > maxRows)) {
+        return idList.size();
+    }
+    TransactionGuard transaction(this);
+    if (! transaction.isActive()) {
+        return -1;
+    }
+    for (const QVariant& id : idList) {
+        OptionTable account;
+        account.insert('i', id);
+        if (searchObj.contains('U')) {
+            account.insert('U', searchObj.value('U'));
+        }
+        if (deleteAccountObject(account) < 0) {
+            transaction.rollback();
+            return -1;
+        }
+    }
+
+    return transaction.commit() ? idList.size() : -1;
+}
+
+/**
+ * Virtual public
+ * Sets the values of the modifications to all Account objects of the
+ * user which match the filter. This default finds their ids first and
+ * modifies them one by one in one transaction.
+ * @param modifications     The values to set. The user id ('U') restricts to the user.
+ * @param filter
+ * @param maxRows           Nothing is modified if more Account objects match. 0 for no limit.
+ * @param isDryRun          Only count the matching Account objects.
+ * @return                  Number of matching Account objects. -1 on error.
+ */
+int Persistence::modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                                     const int maxRows, const bool isDryRun)
+{
+    OptionTable searchObj;
+    if (modifications.contains('U')) {
+        searchObj.insert('U', modifications.value('U'));
+    }
+    QVariantList idList;
+    if (! matchingIds(searchObj, filter, idList)) {
+        return -1;
+    }
+    if (isDryRun || (maxRows > 0 && idList.size() > maxRows)) {
+        return idList.size();
+    }
+    TransactionGuard transaction(this);
+    if (! transaction.isActive()) {
+        return -1;
+    }
+    for (const QVariant& id : idList) {
+        OptionTable account(modifications);
+        account.insert('i', id);
+        if (! modifyAccountObject(account)) {
+            transaction.rollback();
+            return -1;
+        }
+    }
+
+    return transaction.commit() ? idList.size() : -1;
+}
+
+/**
+ * Virtual public
+ * Inserts an Account object or updates the existing one with the same
+ * provider and username. This default needs two statements: it looks
+ * the Account object up and then inserts or modifies it.
+ * @param account           Values of the Account object. Needs provider and username.
+ * @param insertOnlyList    Options which are not changed on update.
+ * @return                  Inserted, updated or failed.
+ */
+Persistence::UpsertResult Persistence::upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList)
+{
+    OptionTable searchObj;
+    for (const char option : { 'p', 'u', 'U' }) {
+        if (account.contains(option)) {
+            searchObj.insert(option, account.value(option));
+        }
+    }
+    searchObj.insert('i', QVariant());
+    QVariantMap existing = findAccount(searchObj);
+    if (existing.isEmpty()) {
+        return persistAccountObject(account) ? UpsertInserted : UpsertFailed;
+    }
+    OptionTable modifications(account);
+    for (const char option : insertOnlyList) {
+        modifications.remove(option);
+    }
+
+    return modifyAccountObject(modifications) ? UpsertUpdated : UpsertFailed;
+}
+
+/**
+ * Begins a transaction. Inside a transaction only the depth is counted.
+ * Writes between begin and the outermost commit are committed together.
+ * @return              False if the persistence has no transactions or on error.
+ */
+bool Persistence::beginTransaction()
+{
+    if (m_transactionDepth > 0) {
+        ++m_transactionDepth;
+        return true;
+    }
+    if (! executeBegin()) {
+        return false;
+    }
+    m_transactionDepth = 1;
+    m_isRollbackOnly = false;
+
+    return true;
+}
+
+/**
+ * Commits a transaction. A nested commit only counts down. The outermost
+ * commit rolls back if a nested transaction was rolled back.
+ * @return              True if committed or nested.
+ */
+bool Persistence::commitTransaction()
+{
+    if (m_transactionDepth <= 0) {
+        return false;
+    }
+    if (--m_transactionDepth > 0) {
+        return true;
+    }
+    if (m_isRollbackOnly) {
+        executeRollback();
+        return false;
+    }
+
+    return executeCommit();
+}
+
+/**
+ * Rolls back a transaction. A nested rollback only marks the outermost
+ * transaction to roll back.
+ * @return              False without transaction or on error.
+ */
+bool Persistence::rollbackTransaction()
+{
+    if (m_transactionDepth <= 0) {
+        return false;
+    }
+    if (--m_transactionDepth > 0) {
+        m_isRollbackOnly = true;
+        return true;
+    }
+
+    return executeRollback();
+}
+
+/**
+ * Virtual protected
+ * Begins the outermost transaction. The default has no transactions.
+ * @return
+ */
+bool Persistence::executeBegin()
+{
+    return false;
+}
+
+/**
+ * Virtual protected
+ * Commits the outermost transaction.
+ * @return
+ */
+bool Persistence::executeCommit()
+{
+    return false;
+}
+
+/**
+ * Virtual protected
+ * Rolls back the outermost transaction.
+ * @return
+ */
+bool Persistence::executeRollback()
+{
+    return false;
+}
+
+/**
+ * Protected
+ * Rolls back an open transaction at any depth. For close().
+ */
+void Persistence::abortTransaction()
+{
+    if (m_transactionDepth > 0) {
+        m_transactionDepth = 0;
+        executeRollback();
+    }
+}
+
+/**
+ * Virtual public
+ * Lets the persistence find the current user inside the statements of
+ * the Account objects. Option tables without a user id value ('U') are
+ * then restricted to the Account objects of this user. A persistence
+ * which can not do this returns false and needs a user id.
+ * @param userName      Name of the current user.
+ * @return              True if the persistence resolves the user.
+ */
+bool Persistence::resolveUserByName(const QString &userName)
+{
+    Q_UNUSED(userName)
+    return false;
+}
+
+/**
+ * Virtual public
+ * Finds the changes of the Account objects since a watermark. The
+ * watermark is opaque to the caller; it is stored and handed back.
+ * @param userObj           Option table with the user ('U').
+ * @param since             Watermark of the last call. Invalid for all Account objects.
+ * @param visitor           Takes each batch of changed Account objects.
+ * @param deletedList       Takes the ids of the deleted Account objects.
+ * @param watermark         Takes the watermark for the next call.
+ * @return                  False on error or if the persistence has no change tracking.
+ */
+bool Persistence::findChangesSince(const OptionTable &userObj, const QVariant &since, const AccountBatchVisitor &visitor,
+                                   QVariantList &deletedList, QVariant &watermark)
+{
+    Q_UNUSED(userObj)
+    Q_UNUSED(since)
+    Q_UNUSED(visitor)
+    Q_UNUSED(deletedList)
+    Q_UNUSED(watermark)
+    return false;
+}
+
+/**
+ * Virtual public
+ * A stamp which tells if the Account objects of the user have changed.
+ * @param userObj           Option table with the user ('U').
+ * @return                  The stamp. Or an empty string without change tracking.
+ */
+QString Persistence::changeStamp(const OptionTable &userObj)
+{
+    Q_UNUSED(userObj)
+    return QString();
+}
+
+/**
+ * Virtual public
+ * The identity of the store of the Account objects.
+ * @return                  The identity. Or an empty string.
+ */
+QString Persistence::storeKey() const
+{
+    return QString();
+}
+
+/**
+ * Virtual public
+ * Applies the pending migrations of the schema.
+ * @param isDryRun          Only report the pending migrations.
+ * @param partitionCount    Number of partitions of the Account objects. 0 for none.
+ * @param reportList        Takes a line for each pending migration.
+ * @return                  False on error or if the persistence has no schema.
+ */
+bool Persistence::migrateSchema(const bool isDryRun, const int partitionCount, QStringList &reportList)
+{
+    Q_UNUSED(isDryRun)
+    Q_UNUSED(partitionCount)
+    Q_UNUSED(reportList)
+    return false;
+}
+
+/**
+ * Virtual public
+ * Checks if the statements of the application are served by indexes.
+ * @param reportList        Takes a line for each statement.
+ * @return                  False on error, if a statement is not served or
+ *                          if the persistence has no schema.
+ */
+bool Persistence::verifySchema(QStringList &reportList)
+{
+    Q_UNUSED(reportList)
+    return false;
+}
+
+/**
+ * Virtual public
+ * Reads the Account objects like streamAccountsLike() and evaluates the
+ * filter for each of them. Columns used by the filter are read as well
+ * and dropped before the Account objects are handed to the visitor.
+ * A page is taken by streamAccountPage().
+ * @param searchObj
+ * @param filter            Column names must be real names of the persistence.
+ * @param page              Order, limit and key of the page. Or an empty page.
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool Persistence::streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                      const AccountPage &page, const AccountBatchVisitor &visitor,
+                                      const int batchSize)
+{
+    if (! page.isEmpty()) {
+        return streamAccountPage(searchObj, filter, page, visitor, batchSize);
+    }
+    if (filter.isEmpty()) {
+        return streamAccountsLike(searchObj, visitor, batchSize);
+    }
+    OptionTable readObj(searchObj);
+    QStringList addedList;
+    QStringList filterColumnList = filter.columnNames();
+    const char optionList[] = { 'i', 'p', 'u', 'k', 'q', 'r', 'l', 's', 't' };
+    for (const char option : optionList) {
+        QString name = optionToRealName(option);
+        if (filterColumnList.contains(name) && ! readObj.contains(option)) {
+            readObj.insert(option, QVariant());
+            addedList << name;
+        }
+    }
+    QList<QVariantMap> matchList;
+    bool isStopped = false;
+    bool isDone = streamAccountsLike(readObj, [&](const QList<QVariantMap>& accountList) {
+        for (QVariantMap account : accountList) {
+            if (! filter.matches(account)) {
+                continue;
+            }
+            for (const QString& name : addedList) {
+                account.remove(name);
+            }
+            matchList << account;
+        }
+        if (matchList.size() >= batchSize) {
+            isStopped = ! visitor(matchList);
+            matchList.clear();
+        }
+        return ! isStopped;
+    }, batchSize);
+    if (isDone && ! isStopped && ! matchList.isEmpty()) {
+        visitor(matchList);
+    }
+
+    return isDone;
+}
+
+/**
+ * Protected
+ * Takes a page of Account objects in memory. All matching Account objects
+ * are read and sorted by the order column and the id. The page starts
+ * behind its key. This is the behaviour of keyset pagination for a
+ * persistence which can not order and limit by itself.
+ * @param searchObj
+ * @param filter
+ * @param page
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool Persistence::streamAccountPage(const OptionTable &searchObj, const FilterExpression &filter, const AccountPage &page,
+                                    const AccountBatchVisitor &visitor, const int batchSize)
+{
+    QString idName = optionToRealName('i');
+    QString orderName = page.orderBy.isEmpty() ? idName : page.orderBy;
+    OptionTable readObj(searchObj);
+    QStringList addedList;
+    const char optionList[] = { 'i', 'p', 'u', 'k', 'q', 'r', 'l', 's', 't' };
+    for (const char option : optionList) {
+        QString name = optionToRealName(option);
+        if ((name == idName || name == orderName) && ! readObj.contains(option)) {
+            readObj.insert(option, QVariant());
+            addedList << name;
+        }
+    }
+    QList<QVariantMap> accountList;
+    bool isDone = streamAccountsWhere(readObj, filter, AccountPage(), [&accountList](const QList<QVariantMap>& batch) {
+        accountList << batch;
+        return true;
+    }, batchSize);
+    if (! isDone) {
+        return false;
+    }
+    auto isBefore = [&orderName, &idName](const QVariantMap& first, const QVariantMap& second) {
+        int order = compareValues(first.value(orderName), second.value(orderName));
+        if (order != 0) {
+            return order < 0;
+        }
+        return compareValues(first.value(idName), second.value(idName)) < 0;
+    };
+    std::sort(accountList.begin(), accountList.end(), isBefore);
+    int begin = 0;
+    if (page.afterId.isValid()) {
+        QVariantMap key;
+        key.insert(orderName, page.afterValue);
+        key.insert(idName, page.afterId);
+        begin = static_cast<int>(std::upper_bound(accountList.begin(), accountList.end(), key, isBefore) - accountList.begin());
+    }
+    int end = accountList.size();
+    if (page.limit > 0) {
+        end = qMin(begin + page.limit, end);
+    }
+    QList<QVariantMap> batch;
+    for (int index=begin; index<end; ++index) {
+        QVariantMap& account = accountList[index];
+        for (const QString& name : addedList) {
+            account.remove(name);
+        }
+        batch << account;
+        if (batch.size() >= batchSize) {
+            if (! visitor(batch)) {
+                return true;
+            }
+            batch.clear();
+        }
+    }
+    if (! batch.isEmpty()) {
+        visitor(batch);
+    }
+
+    return true;
+}
+
+/**
+ * Static protected
+ * Compares two values for ordering. A string is converted to the type of
+ * the other value first. Null values are ordered last like in SQL.
+ * @param first
+ * @param second
+ * @return              Negative, 0 or positive.
+ */
+int Persistence::compareValues(const QVariant &first, const QVariant &second)
+{
+    if (first.isNull() || second.isNull()) {
+        return static_cast<int>(first.isNull()) - static_cast<int>(second.isNull());
+    }
+    QVariant own(first);
+    QVariant other(second);
+    if (own.type() == QVariant::String && other.type() != QVariant::String) {
+        own.convert(other.userType());
+    } else if (other.type() == QVariant::String && own.type() != QVariant::String) {
+        other.convert(own.userType());
+    }
+    switch (own.type()) {
+    case QVariant::DateTime: {
+        QDateTime ownDateTime = own.toDateTime();
+        QDateTime otherDateTime = other.toDateTime();
+        return (ownDateTime < otherDateTime) ? -1 : (otherDateTime < ownDateTime) ? 1 : 0;
+    }
+    case QVariant::Date: {
+        QDate ownDate = own.toDate();
+        QDate otherDate = other.toDate();
+        return (ownDate < otherDate) ? -1 : (otherDate < ownDate) ? 1 : 0;
+    }
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double: {
+        double ownNumber = own.toDouble();
+        double otherNumber = other.toDouble();
+        return (ownNumber < otherNumber) ? -1 : (otherNumber < ownNumber) ? 1 : 0;
+    }
+    default:
+        return QString::compare(own.toString(), other.toString());
+    }
+}
+
+/**
+ * Protected
+ * Finds the ids of all Account objects which match the search values and
+ * the filter.
+ * @param searchObj
+ * @param filter
+ * @param idList            Takes the ids.
+ * @return                  False on error.
+ */
+bool Persistence::matchingIds(const OptionTable &searchObj, const FilterExpression &filter, QVariantList &idList)
+{
+    OptionTable readObj(searchObj);
+    readObj.insert('i', QVariant());
+    QString idName = optionToRealName('i');
+    streamAccountsWhere(readObj, filter, AccountPage(), [&idList, &idName](const QList<QVariantMap>& accountList) {
+        for (const QVariantMap& account : accountList) {
+            idList << account.value(idName);
+        }
+        return true;
+    });
+
+    return ! hasError();
+}
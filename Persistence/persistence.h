@@ -12,9 +12,25 @@
  * ------------------------------------------------------------------------------
  */
 
+#include "SearchAccount/filterexpression.h"
 #include <QVariantMap>
+#include <functional>
 
 typedef QHash<char, QVariant> OptionTable;
+// Takes a batch of Account objects. Returns false to stop reading.
+typedef std::function<bool(const QList<QVariantMap>& accountList)> AccountBatchVisitor;
+
+// Keyset pagination. The rows are ordered by a column and the id. A page
+// starts behind the key of the last row of the previous page.
+struct AccountPage
+{
+    QString orderBy;                // Real column name. Empty to order by id.
+    int limit = 0;                  // Maximum number of rows. 0 for all.
+    QVariant afterValue;            // Order column value of the key. Unused when ordered by id.
+    QVariant afterId;               // Id of the key. Invalid for the first page.
+
+    bool isEmpty() const            { return orderBy.isEmpty() && limit <= 0 && ! afterId.isValid(); }
+};
 
 class Persistence
 {
@@ -22,21 +38,78 @@ public:
     Persistence();
     virtual ~Persistence();
 
+    // Result of upsertAccountObject()
+    enum UpsertResult { UpsertFailed, UpsertInserted, UpsertUpdated };
+
     // Open and close persistence
     virtual bool open(const QString& parameter = QString()) = 0;
     virtual void close() = 0;
     virtual bool isOpen() const;
 
+    // Transactions. They can be nested. Only the outermost commit ends the
+    // transaction. A nested rollback makes the outermost commit roll back.
+    // A persistence without transactions returns false on begin.
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    bool isInTransaction() const                    { return m_transactionDepth > 0; }
+
     // Modify persistent objects.
     // Database connection must be made before call one of these methods.
     virtual bool persistAccountObject(const OptionTable& account) = 0;
     virtual int deleteAccountObject(const OptionTable& account) = 0;
     virtual bool modifyAccountObject(const OptionTable& modifications) = 0;
+    // All modifications of the list must have the same set of options.
+    virtual int modifyAccountObjects(const QList<OptionTable>& modificationList) = 0;
+    // Bulk changes of all Account objects matching the search values and
+    // the filter. They return the number of matching Account objects or -1
+    // on error. Nothing is changed on a dry run or if the number is above
+    // the limit (0 for no limit). The defaults change one by one.
+    virtual int deleteAccountsWhere(const OptionTable& searchObj, const FilterExpression& filter,
+                                    const int maxRows, const bool isDryRun);
+    virtual int modifyAccountsWhere(const OptionTable& modifications, const FilterExpression& filter,
+                                    const int maxRows, const bool isDryRun);
+    // Inserts the Account object or updates the one with the same provider
+    // and username. Options of the insert only list are not updated. The
+    // default looks up the Account object first.
+    virtual UpsertResult upsertAccountObject(const OptionTable& account, const QList<char>& insertOnlyList);
     virtual QVariantMap findAccount(const OptionTable& searchObj) = 0;
     virtual QList<QVariantMap> findAccountsLike(const OptionTable& searchObj) = 0;
+    // Same as findAccountsLike() but hands the Account objects in batches
+    // to a visitor. The whole result is never held in memory.
+    virtual bool streamAccountsLike(const OptionTable& searchObj, const AccountBatchVisitor& visitor,
+                                    const int batchSize = 4096) = 0;
+    // Same as streamAccountsLike() but only Account objects matching the
+    // filter are handed to the visitor. They are ordered and limited by the
+    // page. The default evaluates the filter for each Account object read
+    // and sorts the result in memory.
+    virtual bool streamAccountsWhere(const OptionTable& searchObj, const FilterExpression& filter,
+                                     const AccountPage& page, const AccountBatchVisitor& visitor,
+                                     const int batchSize = 4096);
+    // Changes of the Account objects of the user since a watermark, for a
+    // local replica. Changed Account objects are handed to the visitor with
+    // all columns, the ids of deleted ones are taken into the deleted list.
+    // An invalid watermark reads all Account objects. The watermark takes
+    // the value for the next call. A persistence without change tracking
+    // returns false without an error.
+    virtual bool findChangesSince(const OptionTable& userObj, const QVariant& since, const AccountBatchVisitor& visitor,
+                                  QVariantList& deletedList, QVariant& watermark);
+    // A stamp of the Account objects of the user. It changes with each
+    // committed insert, update and delete. A persistence without change
+    // tracking returns an empty stamp without an error.
+    virtual QString changeStamp(const OptionTable& userObj);
+    // Tells the stores of the Account objects apart, e.g. for files which
+    // keep data of the store. Empty for a persistence with only one store.
+    virtual QString storeKey() const;
 
     // User management
     virtual QVariantMap findUser(const OptionTable& userInfo) = 0;
+    virtual bool resolveUserByName(const QString& userName);
+
+    // Schema management. A persistence without a schema returns false
+    // without an error.
+    virtual bool migrateSchema(const bool isDryRun, const int partitionCount, QStringList& reportList);
+    virtual bool verifySchema(QStringList& reportList);
 
     // Read from persistence.
     // These methods open database connection by it self and close it afterwarts.
@@ -51,9 +124,20 @@ public:
 
 protected:
     void setOpen(const bool isOpen)                 { m_isOpen = isOpen; }
+    // Statements of the outermost transaction.
+    virtual bool executeBegin();
+    virtual bool executeCommit();
+    virtual bool executeRollback();
+    void abortTransaction();
+    bool streamAccountPage(const OptionTable& searchObj, const FilterExpression& filter, const AccountPage& page,
+                           const AccountBatchVisitor& visitor, const int batchSize);
+    static int compareValues(const QVariant& first, const QVariant& second);
+    bool matchingIds(const OptionTable& searchObj, const FilterExpression& filter, QVariantList& idList);
 
 private:
     bool m_isOpen;
+    int m_transactionDepth;
+    bool m_isRollbackOnly;
 };
 
 #endif // PERSISTENCE_H
@@ -15,7 +15,10 @@ Persistence* PersistenceFactory::createPersistence(const PersistenceFactory::Typ
     Persistence* object = nullptr;
     switch (type) {
     case SqlPostgre:
-        object = new PostgreSQL();
+        object = withLocalCopy(new PostgreSQL());
+        break;
+    case SqlPostgreNative:
+        object = withLocalCopy(new PostgreSQLNative());
         break;
     case File:
         object = new FilePersistence();
@@ -24,3 +27,43 @@ Persistence* PersistenceFactory::createPersistence(const PersistenceFactory::Typ
 
     return object;
 }
+
+/**
+ * The database backend. Environment variable PWMANAGER_BACKEND=libpq
+ * chooses the native libpq backend. Default is the QtSql backend.
+ * @return
+ */
+PersistenceFactory::Type PersistenceFactory::databaseType()
+{
+    if (qEnvironmentVariable("PWMANAGER_BACKEND") == QString("libpq")) {
+        return SqlPostgreNative;
+    }
+
+    return SqlPostgre;
+}
+
+/**
+ * Private
+ * Serves the reads of a database from a local copy.
+ * - A local replica if environment variable PWMANAGER_REPLICA names its
+ *   file. The file is encrypted with the passphrase of PWMANAGER_PASSPHRASE.
+ *   Without a passphrase there is no replica.
+ * - Otherwise a query cache if environment variable PWMANAGER_CACHE names
+ *   its directory.
+ * @param pServer
+ * @return                  The local copy or the database itself.
+ */
+Persistence* PersistenceFactory::withLocalCopy(Persistence *pServer)
+{
+    QString filePath = qEnvironmentVariable("PWMANAGER_REPLICA");
+    QString passphrase = qEnvironmentVariable("PWMANAGER_PASSPHRASE");
+    if (! filePath.isEmpty() && ! passphrase.isEmpty()) {
+        return new LocalReplica(pServer, filePath, passphrase);
+    }
+    QString directory = qEnvironmentVariable("PWMANAGER_CACHE");
+    if (! directory.isEmpty()) {
+        return new QueryCache(pServer, directory);
+    }
+
+    return pServer;
+}
@@ -2,17 +2,24 @@
 #define PERSISTENCEFACTORY_H
 
 #include "postgresql.h"
+#include "postgresqlnative.h"
 #include "filepersistence.h"
+#include "localreplica.h"
+#include "querycache.h"
 
 class PersistenceFactory
 {
 public:
     PersistenceFactory();
 
-    enum Type { SqlPostgre, File };
+    enum Type { SqlPostgre, SqlPostgreNative, File };
 
 
     static Persistence* createPersistence(const Type type);
+    static Type databaseType();
+
+private:
+    static Persistence* withLocalCopy(Persistence* pServer);
 };
 
 #endif // PERSISTENCEFACTORY_H
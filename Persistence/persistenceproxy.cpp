@@ -0,0 +1,237 @@
+#include "persistenceproxy.h"
+
+/**
+ * Constructor
+ * Takes the ownership of the server persistence.
+ * @param pServer           Persistence which gets the calls.
+ */
+PersistenceProxy::PersistenceProxy(Persistence *pServer) :
+    m_pServer(pServer)
+{
+
+}
+
+/**
+ * Destructor
+ */
+PersistenceProxy::~PersistenceProxy()
+{
+    delete m_pServer;
+}
+
+// Override
+bool PersistenceProxy::open(const QString &parameter)
+{
+    if (! m_pServer->open(parameter)) {
+        return false;
+    }
+    setOpen(true);
+
+    return true;
+}
+
+// Override
+void PersistenceProxy::close()
+{
+    abortTransaction();
+    if (isOpen()) {
+        m_pServer->close();
+        setOpen(false);
+    }
+}
+
+// Override
+bool PersistenceProxy::persistAccountObject(const OptionTable &account)
+{
+    return m_pServer->persistAccountObject(account);
+}
+
+// Override
+int PersistenceProxy::deleteAccountObject(const OptionTable &account)
+{
+    return m_pServer->deleteAccountObject(account);
+}
+
+// Override
+bool PersistenceProxy::modifyAccountObject(const OptionTable &modifications)
+{
+    return m_pServer->modifyAccountObject(modifications);
+}
+
+// Override
+int PersistenceProxy::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    return m_pServer->modifyAccountObjects(modificationList);
+}
+
+// Override
+int PersistenceProxy::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                          const int maxRows, const bool isDryRun)
+{
+    return m_pServer->deleteAccountsWhere(searchObj, filter, maxRows, isDryRun);
+}
+
+// Override
+int PersistenceProxy::modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                                          const int maxRows, const bool isDryRun)
+{
+    return m_pServer->modifyAccountsWhere(modifications, filter, maxRows, isDryRun);
+}
+
+// Override
+Persistence::UpsertResult PersistenceProxy::upsertAccountObject(const OptionTable &account,
+                                                                const QList<char> &insertOnlyList)
+{
+    return m_pServer->upsertAccountObject(account, insertOnlyList);
+}
+
+// Override
+QVariantMap PersistenceProxy::findAccount(const OptionTable &searchObj)
+{
+    return m_pServer->findAccount(searchObj);
+}
+
+/**
+ * Collects the batches of streamAccountsLike(). A proxy which serves
+ * the stream serves this call as well.
+ * @param searchObj
+ * @return
+ */
+QList<QVariantMap> PersistenceProxy::findAccountsLike(const OptionTable &searchObj)
+{
+    QList<QVariantMap> accountList;
+    streamAccountsLike(searchObj, [&accountList](const QList<QVariantMap>& batch) {
+        accountList << batch;
+        return true;
+    });
+
+    return accountList;
+}
+
+// Override
+bool PersistenceProxy::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                                          const int batchSize)
+{
+    return m_pServer->streamAccountsLike(searchObj, visitor, batchSize);
+}
+
+// Override
+bool PersistenceProxy::streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                           const AccountPage &page, const AccountBatchVisitor &visitor,
+                                           const int batchSize)
+{
+    return m_pServer->streamAccountsWhere(searchObj, filter, page, visitor, batchSize);
+}
+
+// Override
+bool PersistenceProxy::findChangesSince(const OptionTable &userObj, const QVariant &since,
+                                        const AccountBatchVisitor &visitor, QVariantList &deletedList,
+                                        QVariant &watermark)
+{
+    return m_pServer->findChangesSince(userObj, since, visitor, deletedList, watermark);
+}
+
+// Override
+QString PersistenceProxy::changeStamp(const OptionTable &userObj)
+{
+    return m_pServer->changeStamp(userObj);
+}
+
+// Override
+QString PersistenceProxy::storeKey() const
+{
+    return m_pServer->storeKey();
+}
+
+// Override
+QList<QVariantMap> PersistenceProxy::allPersistedAccounts()
+{
+    return m_pServer->allPersistedAccounts();
+}
+
+// Override
+QVariantMap PersistenceProxy::findUser(const OptionTable &userInfo)
+{
+    return m_pServer->findUser(userInfo);
+}
+
+/**
+ * The name is kept to tell the users apart (see userKey()).
+ * @param userName
+ * @return
+ */
+bool PersistenceProxy::resolveUserByName(const QString &userName)
+{
+    m_userName = userName;
+
+    return m_pServer->resolveUserByName(userName);
+}
+
+// Override
+bool PersistenceProxy::migrateSchema(const bool isDryRun, const int partitionCount, QStringList &reportList)
+{
+    return m_pServer->migrateSchema(isDryRun, partitionCount, reportList);
+}
+
+// Override
+bool PersistenceProxy::verifySchema(QStringList &reportList)
+{
+    return m_pServer->verifySchema(reportList);
+}
+
+// Override
+QString PersistenceProxy::error() const
+{
+    return QString(m_errorMsg).append(m_pServer->error());
+}
+
+// Override
+bool PersistenceProxy::hasError() const
+{
+    return ! m_errorMsg.isEmpty() || m_pServer->hasError();
+}
+
+// Override
+QString PersistenceProxy::optionToRealName(const char option) const
+{
+    return m_pServer->optionToRealName(option);
+}
+
+/**
+ * Protected
+ * Begins a transaction of the server.
+ * @return
+ */
+bool PersistenceProxy::executeBegin()
+{
+    return m_pServer->beginTransaction();
+}
+
+// Override
+bool PersistenceProxy::executeCommit()
+{
+    return m_pServer->commitTransaction();
+}
+
+// Override
+bool PersistenceProxy::executeRollback()
+{
+    return m_pServer->rollbackTransaction();
+}
+
+/**
+ * Protected
+ * Tells the users of the statements apart. By id or, if the server finds
+ * the user by name, by name.
+ * @param searchObj         Option table with the user ('U').
+ * @return
+ */
+QString PersistenceProxy::userKey(const OptionTable &searchObj) const
+{
+    QVariant userId = searchObj.value('U');
+    if (userId.isValid()) {
+        return QString("id:").append(userId.toString());
+    }
+
+    return QString("name:").append(m_userName);
+}
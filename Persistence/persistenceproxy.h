@@ -0,0 +1,75 @@
+#ifndef PERSISTENCEPROXY_H
+#define PERSISTENCEPROXY_H
+
+/* ------------------------------------------------------------------------------
+ * Class PersistenceProxy
+ *
+ * Forwards all calls to a server persistence. It is the base of the
+ * persistences which keep some of the server's data locally (see
+ * LocalReplica and QueryCache). They override just the calls they serve.
+ * The transactions of the proxy are the transactions of the server. Error
+ * messages of the proxy come before the ones of the server.
+ * ------------------------------------------------------------------------------
+ */
+
+#include "persistence.h"
+
+class PersistenceProxy : public Persistence
+{
+public:
+    explicit PersistenceProxy(Persistence* pServer);
+    ~PersistenceProxy() override;
+
+    // Persistence interface
+public:
+    bool open(const QString& parameter = QString()) override;
+    void close() override;
+    bool persistAccountObject(const OptionTable &account) override;
+    int deleteAccountObject(const OptionTable &account) override;
+    bool modifyAccountObject(const OptionTable &modifications) override;
+    int modifyAccountObjects(const QList<OptionTable> &modificationList) override;
+    int deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    int modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    UpsertResult upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList) override;
+    QVariantMap findAccount(const OptionTable &searchObj) override;
+    QList<QVariantMap> findAccountsLike(const OptionTable &searchObj) override;
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                            const int batchSize = 4096) override;
+    bool streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                             const AccountPage &page, const AccountBatchVisitor &visitor,
+                             const int batchSize = 4096) override;
+    bool findChangesSince(const OptionTable &userObj, const QVariant &since, const AccountBatchVisitor &visitor,
+                          QVariantList &deletedList, QVariant &watermark) override;
+    QString changeStamp(const OptionTable &userObj) override;
+    QString storeKey() const override;
+    QList<QVariantMap> allPersistedAccounts() override;
+    QVariantMap findUser(const OptionTable &userInfo) override;
+    bool resolveUserByName(const QString &userName) override;
+    bool migrateSchema(const bool isDryRun, const int partitionCount, QStringList &reportList) override;
+    bool verifySchema(QStringList &reportList) override;
+    QString error() const override;
+    bool hasError() const override;
+    QString optionToRealName(const char option) const override;
+
+protected:
+    // Transactions of the server
+    bool executeBegin() override;
+    bool executeCommit() override;
+    bool executeRollback() override;
+    Persistence* server() const                     { return m_pServer; }
+    // Error messages of the proxy
+    void appendError(const QString& message)        { m_errorMsg.append(message); }
+    bool hasOwnError() const                        { return ! m_errorMsg.isEmpty(); }
+    // The user of the statements. By id or, if the server finds the user
+    // by name, by name.
+    QString userKey(const OptionTable& searchObj) const;
+
+private:
+    Persistence* m_pServer;
+    QString m_errorMsg;
+    QString m_userName;
+};
+
+#endif // PERSISTENCEPROXY_H
@@ -1,20 +1,39 @@
 #include "postgresql.h"
 #include "credentials.h"
+#include "schemamigration.h"
+#include "transactionguard.h"
 #include <QSqlDatabase>
 #include <QSqlField>
 #include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlError>
 
-PostgreSQL::PostgreSQL()
+// Finds the id of the current user. The name is the first bind value.
+const QString PostgreSQL::m_sqlCurrentUser = QString("WITH current_user_id AS (SELECT id AS current_userid "
+                                                     "FROM public.user WHERE name = ?)");
+
+/**
+ * Constructor
+ * Does not touch the driver or the credentials file. Both are needed
+ * only when the connection is opened (see initializeDatabase()).
+ */
+PostgreSQL::PostgreSQL() :
+    m_isInitialized(false),
+    m_isReplicaOpen(false),
+    m_hasWritten(false)
 {
-    initializeDatabase();
+
 }
 
 // Override
 bool PostgreSQL::open(const QString &parameter)
 {
     Q_UNUSED(parameter)
+    initializeDatabase();
+    if (openReplica()) {
+        setOpen(true);
+        return true;
+    }
     QSqlDatabase db = QSqlDatabase::database("local", false);
     if (db.open()) {
         setOpen(true);
@@ -28,16 +47,30 @@ bool PostgreSQL::open(const QString &parameter)
 // Override
 void PostgreSQL::close()
 {
+    abortTransaction();
     QSqlDatabase db = QSqlDatabase::database("local", false);
     db.close();
+    if (m_isReplicaOpen) {
+        QSqlDatabase::database(QString("replica"), false).close();
+        m_isReplicaOpen = false;
+    }
     setOpen(false);
 }
 
 // Override
 bool PostgreSQL::persistAccountObject(const OptionTable &account)
 {
+    if (isUserDeferred(account)) {
+        OptionTable accountValues(account);
+        accountValues.remove('U');
+        QSqlRecord record = recordFromOptionTable(accountValues);
+        QString sqlInsert = QString("INSERT INTO %1 (%2, %3) SELECT %4current_userid FROM current_user_id")
+                .arg(m_tableName, sqlFieldList(record, QString(), QString(", ")), optionToRealName('U'),
+                     QString("?, ").repeated(record.count()));
+        return execModifyOfUser(sqlModifyOfUser(sqlInsert), record) >= 0;
+    }
     QSqlRecord record = recordFromOptionTable(account);
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    QSqlDatabase db = writeDatabase();
     QString sqlInsert = db.driver()->sqlStatement(QSqlDriver::InsertStatement, m_tableName, record, true);
     QSqlQuery query(db);
     if (! query.prepare(sqlInsert)) {
@@ -55,6 +88,59 @@ bool PostgreSQL::persistAccountObject(const OptionTable &account)
     return true;
 }
 
+/**
+ * Inserts an Account object or updates the one with the same user,
+ * provider and username in one statement:
+ * INSERT ... ON CONFLICT (userid, provider, username) DO UPDATE.
+ * Needs the unique constraint of migration 002.
+ * @param account           Values of the Account object. Needs provider and username.
+ * @param insertOnlyList    Options which are not changed on update.
+ * @return                  Inserted, updated or failed.
+ */
+Persistence::UpsertResult PostgreSQL::upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList)
+{
+    bool isDeferred = isUserDeferred(account);
+    OptionTable accountValues(account);
+    if (isDeferred) {
+        accountValues.remove('U');
+    }
+    QSqlRecord record = recordFromOptionTable(accountValues);
+    QSqlDatabase db = writeDatabase();
+    QString sqlUpsert;
+    if (isDeferred) {
+        QString sqlInsert = QString("INSERT INTO %1 (%2, %3) SELECT %4current_userid FROM current_user_id")
+                .arg(m_tableName, sqlFieldList(record, QString(), QString(", ")), optionToRealName('U'),
+                     QString("?, ").repeated(record.count()));
+        sqlUpsert = m_sqlCurrentUser;
+        sqlUpsert.append(", changed AS (").append(sqlInsert).append(sqlOnConflict(record, insertOnlyList)).append(')');
+        sqlUpsert.append(" SELECT (SELECT count(*) FROM current_user_id), (SELECT bool_and(inserted) FROM changed)");
+    } else {
+        sqlUpsert = db.driver()->sqlStatement(QSqlDriver::InsertStatement, m_tableName, record, true);
+        sqlUpsert.append(sqlOnConflict(record, insertOnlyList));
+    }
+    QSqlQuery query(db);
+    if (! query.prepare(sqlUpsert)) {
+        setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
+        return UpsertFailed;
+    }
+    if (isDeferred) {
+        query.addBindValue(m_userName);
+    }
+    for (int index=0; index<record.count(); ++index) {
+        query.addBindValue(record.value(index));
+    }
+    if (! query.exec() || ! query.next()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return UpsertFailed;
+    }
+    if (isDeferred && query.value(0).toInt() == 0) {
+        setErrorUserNotRegistered();
+        return UpsertFailed;
+    }
+
+    return query.value(isDeferred ? 1 : 0).toBool() ? UpsertInserted : UpsertUpdated;
+}
+
 // Override
 int PostgreSQL::deleteAccountObject(const OptionTable &account)
 {
@@ -64,7 +150,12 @@ int PostgreSQL::deleteAccountObject(const OptionTable &account)
         m_errorMsg.append(QString("It needs a 'id' value. Or 'provider' and 'username' to identify an Account object.\n"));
         return 0;
     }
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    if (isUserDeferred(account)) {
+        QString sqlDelete = QString("DELETE FROM %1 WHERE %2 = (SELECT current_userid FROM current_user_id) AND %3")
+                .arg(m_tableName, optionToRealName('U'), sqlFieldList(record, QString(" = ?"), QString(" AND ")));
+        return execModifyOfUser(sqlModifyOfUser(sqlDelete), record);
+    }
+    QSqlDatabase db = writeDatabase();
     QString sqlDelete = db.driver()->sqlStatement(QSqlDriver::DeleteStatement, m_tableName, record, false);
     QString whereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, record, true);
     sqlDelete.append(' ').append(whereClause);
@@ -94,7 +185,13 @@ bool PostgreSQL::modifyAccountObject(const OptionTable &modifications)
         return false;
     }
     QSqlRecord recordValues = recordWithoutIdentifier(modifications);
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    if (isUserDeferred(modifications)) {
+        QString sqlUpdate = QString("UPDATE %1 SET %2 WHERE %3 = (SELECT current_userid FROM current_user_id) AND %4")
+                .arg(m_tableName, sqlFieldList(recordValues, QString(" = ?"), QString(", ")), optionToRealName('U'),
+                     sqlFieldList(recordIdentifier, QString(" = ?"), QString(" AND ")));
+        return execModifyOfUser(sqlModifyOfUser(sqlUpdate), recordConcardinate(recordValues, recordIdentifier)) >= 0;
+    }
+    QSqlDatabase db = writeDatabase();
     QString sqlUpdate = db.driver()->sqlStatement(QSqlDriver::UpdateStatement, m_tableName, recordValues, true);
     QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordIdentifier, true);
     sqlUpdate.append(' ').append(sqlWhereClause);
@@ -115,6 +212,143 @@ bool PostgreSQL::modifyAccountObject(const OptionTable &modifications)
     return true;
 }
 
+/**
+ * Modifies a list of Account objects. The update statement is prepared
+ * once. The modifications are written in batches, each batch in its own
+ * transaction. If a modification fails its batch is rolled back and
+ * processing stops. A user found by name restricts each update to the
+ * Account objects of the user, as modifyAccountObject() does.
+ * @param modificationList      Modifications with the same set of options.
+ * @return                      Number of modifications committed.
+ */
+int PostgreSQL::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    if (modificationList.isEmpty()) {
+        return 0;
+    }
+    QSqlRecord recordIdentifier = recordWithIdentifier(modificationList.first());
+    if (recordIdentifier.isEmpty()) {
+        m_errorMsg.append(QString("Can not identify Account object in database!\n"));
+        m_errorMsg.append(QString("It needs a 'id' value. Or 'provider' and 'username' to identify an Account object.\n"));
+        return 0;
+    }
+    QSqlRecord recordValues = recordWithoutIdentifier(modificationList.first());
+    QSqlDatabase db = writeDatabase();
+    bool isDeferred = isUserDeferred(modificationList.first());
+    QString sqlUpdate;
+    if (isDeferred) {
+        sqlUpdate = sqlModifyOfUser(QString("UPDATE %1 SET %2 WHERE %3 = (SELECT current_userid FROM current_user_id) AND %4")
+                .arg(m_tableName, sqlFieldList(recordValues, QString(" = ?"), QString(", ")), optionToRealName('U'),
+                     sqlFieldList(recordIdentifier, QString(" = ?"), QString(" AND "))));
+    } else {
+        sqlUpdate = db.driver()->sqlStatement(QSqlDriver::UpdateStatement, m_tableName, recordValues, true);
+        QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordIdentifier, true);
+        sqlUpdate.append(' ').append(sqlWhereClause);
+    }
+    QSqlQuery query(db);
+    if (! query.prepare(sqlUpdate)) {
+        setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
+        return 0;
+    }
+    QSqlRecord templateRecord = recordConcardinate(recordValues, recordIdentifier);
+    // The statement of a deferred user takes the user name first.
+    int firstField = isDeferred ? 1 : 0;
+    int modified = 0;
+    for (int begin=0; begin<modificationList.size(); begin+=m_batchSize) {
+        int end = qMin(begin + m_batchSize, modificationList.size());
+        // Inside a transaction of the caller the batches join it.
+        TransactionGuard transaction(this);
+        if (! transaction.isActive()) {
+            return modified;
+        }
+        for (int index=begin; index<end; ++index) {
+            const OptionTable& modifications = modificationList[index];
+            QSqlRecord record = recordConcardinate(recordWithoutIdentifier(modifications),
+                                                   recordWithIdentifier(modifications));
+            if (isDeferred) {
+                query.bindValue(0, m_userName);
+            }
+            for (int field=0; field<templateRecord.count(); ++field) {
+                query.bindValue(firstField + field, record.value(templateRecord.fieldName(field)));
+            }
+            if (! query.exec()) {
+                setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+                return modified;
+            }
+            if (isDeferred && (! query.next() || query.value(0).toInt() == 0)) {
+                setErrorUserNotRegistered();
+                return modified;
+            }
+        }
+        if (! transaction.commit()) {
+            return modified;
+        }
+        modified += end - begin;
+    }
+
+    return modified;
+}
+
+/**
+ * Deletes all Account objects which match the search values and the
+ * filter with one statement. The statement runs in a transaction which
+ * is rolled back if it deletes more rows than the limit.
+ * @param searchObj         Search values. The user id ('U') restricts to the user.
+ * @param filter            Column names must be real names of this persistence.
+ * @param maxRows           Nothing is deleted if more rows match. 0 for no limit.
+ * @param isDryRun          Only count the matching rows.
+ * @return                  Number of matching rows. -1 on error.
+ */
+int PostgreSQL::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                    const int maxRows, const bool isDryRun)
+{
+    QVariantList valueList;
+    QString sqlWhereClause = sqlWhereOf(searchObj, filter, valueList);
+    QString sqlStatement = isDryRun ? QString("SELECT count(*) FROM %1 %2") : QString("DELETE FROM %1 %2");
+
+    return execBulk(sqlStatement.arg(m_tableName, sqlWhereClause), valueList, maxRows, isDryRun);
+}
+
+/**
+ * Sets the values of the modifications to all Account objects of the
+ * user which match the filter with one statement. The statement runs in
+ * a transaction which is rolled back if it updates more rows than the
+ * limit.
+ * @param modifications     The values to set. The user id ('U') restricts to the user.
+ * @param filter            Column names must be real names of this persistence.
+ * @param maxRows           Nothing is modified if more rows match. 0 for no limit.
+ * @param isDryRun          Only count the matching rows.
+ * @return                  Number of matching rows. -1 on error.
+ */
+int PostgreSQL::modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                                    const int maxRows, const bool isDryRun)
+{
+    OptionTable values(modifications);
+    values.remove('U');
+    values.remove('i');
+    QSqlRecord recordValues = recordFieldsWithValues(values);
+    if (recordValues.isEmpty()) {
+        m_errorMsg.append(QString("There are no values to modify !\n"));
+        return -1;
+    }
+    OptionTable searchObj;
+    searchObj.insert('U', modifications.value('U'));
+    QVariantList valueList;
+    QString sqlStatement;
+    if (isDryRun) {
+        sqlStatement = QString("SELECT count(*) FROM %1 %2").arg(m_tableName, sqlWhereOf(searchObj, filter, valueList));
+    } else {
+        for (int index=0; index<recordValues.count(); ++index) {
+            valueList << recordValues.value(index);
+        }
+        sqlStatement = QString("UPDATE %1 SET %2 %3").arg(m_tableName,
+                                                         sqlFieldList(recordValues, QString(" = ?"), QString(", ")),
+                                                         sqlWhereOf(searchObj, filter, valueList));
+    }
+
+    return execBulk(sqlStatement, valueList, maxRows, isDryRun);
+}
+
 /**
  * Find a Account object in database.
  * @param searchObj
@@ -122,17 +356,26 @@ bool PostgreSQL::modifyAccountObject(const OptionTable &modifications)
  */
 QVariantMap PostgreSQL::findAccount(const OptionTable &searchObj)
 {
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    QSqlDatabase db = readDatabase();
     QSqlRecord record = recordFromOptionTable(searchObj);
-    QString sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, record, false);
     QSqlRecord recordIdentifier = recordWithIdentifier(searchObj);
-    QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordIdentifier, true);
-    sqlSelect.append(' ').append(sqlWhereClause);
+    bool isDeferred = isUserDeferred(searchObj);
+    QString sqlSelect;
+    if (isDeferred) {
+        sqlSelect = sqlSelectOfUser(record, recordIdentifier);
+    } else {
+        sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, record, false);
+        QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordIdentifier, true);
+        sqlSelect.append(' ').append(sqlWhereClause);
+    }
     QSqlQuery query(db);
     if (! query.prepare(sqlSelect)) {
         setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
         return QVariantMap();
     }
+    if (isDeferred) {
+        query.addBindValue(m_userName);
+    }
     for (int index=0; index<recordIdentifier.count(); ++index) {
         query.addBindValue(recordIdentifier.value(index));
     }
@@ -141,8 +384,18 @@ QVariantMap PostgreSQL::findAccount(const OptionTable &searchObj)
         return QVariantMap();
     }
     if (! query.next()) {
+        if (isDeferred) {
+            setErrorUserNotRegistered();
+        }
         return QVariantMap();
     }
+    if (isDeferred) {
+        // The user row without a matching Account object.
+        if (! query.value(1).toBool()) {
+            return QVariantMap();
+        }
+        return accountOfUser(query.record());
+    }
 
     return accountObject(query.record());
 }
@@ -154,32 +407,292 @@ QVariantMap PostgreSQL::findAccount(const OptionTable &searchObj)
  */
 QList<QVariantMap> PostgreSQL::findAccountsLike(const OptionTable &searchObj)
 {
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    QList<QVariantMap> accountList;
+    streamAccountsLike(searchObj, [&accountList](const QList<QVariantMap>& batch) {
+        accountList << batch;
+        return true;
+    });
+
+    return accountList;
+}
+
+/**
+ * Find Account objects which fits to the search values of search object.
+ * Same as streamAccountsWhere() with an empty filter and page.
+ * @param searchObj
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool PostgreSQL::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor, const int batchSize)
+{
+    return streamAccountsWhere(searchObj, FilterExpression(), AccountPage(), visitor, batchSize);
+}
+
+/**
+ * Find Account objects which fits to the search values of search object
+ * and to the filter. The filter is compiled into the where clause, so the
+ * database can use its indexes. A page is taken by keyset pagination:
+ * WHERE (column, id) > (key) ORDER BY column, id LIMIT n. Rows with a
+ * NULL in the order column are not part of a page behind a key.
+ * The query is forward only, so the driver fetches rows one by one. The
+ * rows are handed in batches to the visitor.
+ * @param searchObj
+ * @param filter            Column names must be real names of this persistence.
+ * @param page              Order, limit and key of the page. Or an empty page.
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool PostgreSQL::streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                     const AccountPage &page, const AccountBatchVisitor &visitor,
+                                     const int batchSize)
+{
+    QSqlDatabase db = readDatabase();
     QSqlRecord record = recordFromOptionTable(searchObj);
-    QString sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, record, false);
     QSqlRecord recordSearch = recordFieldsWithValues(searchObj);
-    if (! recordSearch.isEmpty()) {
-        QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordSearch, true);
-        sqlSelect.append(' ').append(sqlWhereClause);
+    auto quoteName = [&db](const QString& name) {
+        return db.driver()->escapeIdentifier(name, QSqlDriver::FieldName);
+    };
+    // Conditions of filter and page key.
+    QStringList conditionList;
+    QVariantList conditionValueList;
+    QString sqlFilter = filter.sqlCondition(quoteName, conditionValueList);
+    if (! sqlFilter.isEmpty()) {
+        conditionList << sqlFilter;
+    }
+    QString idColumn = quoteName(optionToRealName('i'));
+    QString orderColumn = page.orderBy.isEmpty() ? idColumn : quoteName(page.orderBy);
+    if (page.afterId.isValid()) {
+        if (orderColumn == idColumn) {
+            conditionList << QString("%1 > ?").arg(idColumn);
+        } else {
+            conditionList << QString("(%1, %2) > (?, ?)").arg(orderColumn, idColumn);
+            conditionValueList << page.afterValue;
+        }
+        conditionValueList << page.afterId;
+    }
+    QString sqlConditions = conditionList.join(" AND ");
+    bool isDeferred = isUserDeferred(searchObj);
+    QString sqlSelect;
+    if (isDeferred) {
+        sqlSelect = sqlSelectOfUser(record, recordSearch);
+        if (! sqlConditions.isEmpty()) {
+            sqlSelect.append(" AND ").append(sqlConditions);
+        }
+    } else {
+        sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, record, false);
+        if (! recordSearch.isEmpty()) {
+            QString sqlWhereClause = db.driver()->sqlStatement(QSqlDriver::WhereStatement, m_tableName, recordSearch, true);
+            sqlSelect.append(' ').append(sqlWhereClause);
+            if (! sqlConditions.isEmpty()) {
+                sqlSelect.append(" AND ").append(sqlConditions);
+            }
+        } else if (! sqlConditions.isEmpty()) {
+            sqlSelect.append(" WHERE ").append(sqlConditions);
+        }
+    }
+    if (! page.isEmpty()) {
+        if (orderColumn == idColumn) {
+            sqlSelect.append(QString(" ORDER BY %1").arg(idColumn));
+        } else {
+            sqlSelect.append(QString(" ORDER BY %1, %2").arg(orderColumn, idColumn));
+        }
+        if (page.limit > 0) {
+            sqlSelect.append(QString(" LIMIT %1").arg(page.limit));
+        }
     }
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     if (! query.prepare(sqlSelect)) {
         setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
-        return QList<QVariantMap>();
+        return false;
+    }
+    if (isDeferred) {
+        query.addBindValue(m_userName);
     }
     for (int index=0; index<recordSearch.count(); ++index) {
         query.addBindValue(recordSearch.value(index));
     }
+    for (const QVariant& value : conditionValueList) {
+        query.addBindValue(value);
+    }
     if (! query.exec()) {
         setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
-        return QList<QVariantMap>();
+        return false;
+    }
+    QList<QVariantMap> accountList;
+    accountList.reserve(batchSize);
+    bool isUserFound = false;
+    while (query.next()) {
+        if (isDeferred) {
+            // The user row without any Account object has no match.
+            isUserFound = true;
+            if (! query.value(1).toBool()) {
+                continue;
+            }
+            accountList << accountOfUser(query.record());
+        } else {
+            accountList << accountObject(query.record());
+        }
+        if (accountList.size() >= batchSize) {
+            if (! visitor(accountList)) {
+                return true;
+            }
+            accountList.clear();
+        }
+    }
+    if (query.lastError().isValid()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    if (isDeferred && ! isUserFound) {
+        setErrorUserNotRegistered();
+        return false;
+    }
+    if (! accountList.isEmpty()) {
+        visitor(accountList);
+    }
+
+    return true;
+}
+
+/**
+ * Finds the changes since a watermark by the column 'changexid' and the
+ * tombstones of migration 005. Both hold the id of the transaction which
+ * made the change. The watermark is the xmin of a snapshot taken first:
+ * each transaction below it has ended and is seen by the statements
+ * after it. A transaction which commits later has an id at or above the
+ * watermark, so the next call finds its changes. Changes may be found
+ * twice; the caller applies them again.
+ * @param userObj           Option table with the user ('U').
+ * @param since             Watermark of the last call. Invalid for all Account objects.
+ * @param visitor           Takes each batch of changed Account objects.
+ * @param deletedList       Takes the ids of the deleted Account objects.
+ * @param watermark         Takes the watermark for the next call.
+ * @return                  False on error.
+ */
+bool PostgreSQL::findChangesSince(const OptionTable &userObj, const QVariant &since, const AccountBatchVisitor &visitor,
+                                  QVariantList &deletedList, QVariant &watermark)
+{
+    QSqlQuery query(readDatabase());
+    if (! query.exec(QString("SELECT pg_snapshot_xmin(pg_current_snapshot())::text")) || ! query.next()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    QString snapshotXmin = query.value(0).toString();
+    OptionTable searchObj;
+    searchObj.insert('U', userObj.value('U'));
+    const char optionList[] = { 'i', 'p', 'u', 'k', 'q', 'r', 'l', 's', 't' };
+    for (const char option : optionList) {
+        searchObj.insert(option, QVariant());
+    }
+    if (! since.isValid()) {
+        if (! streamAccountsWhere(searchObj, FilterExpression(), AccountPage(), visitor)) {
+            return false;
+        }
+        watermark = snapshotXmin;
+        return true;
+    }
+    // The watermark is bound as xid8. It is not part of the filter grammar,
+    // which would compare it as text.
+    QSqlDatabase db = readDatabase();
+    OptionTable userSearchObj;
+    userSearchObj.insert('U', userObj.value('U'));
+    QVariantList valueList;
+    QString sqlWhere = sqlWhereOf(userSearchObj, FilterExpression(), valueList);
+    sqlWhere.append(sqlWhere.isEmpty() ? QString("WHERE ") : QString(" AND "));
+    QString sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, recordFromOptionTable(searchObj), false);
+    sqlSelect.append(' ').append(sqlWhere).append(QString("changexid >= ?::xid8"));
+    query.setForwardOnly(true);
+    if (! query.prepare(sqlSelect)) {
+        setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    for (const QVariant& value : valueList) {
+        query.addBindValue(value);
+    }
+    query.addBindValue(since.toString());
+    if (! query.exec()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
     }
     QList<QVariantMap> accountList;
     while (query.next()) {
         accountList << accountObject(query.record());
+        if (accountList.size() >= m_batchSize) {
+            visitor(accountList);
+            accountList.clear();
+        }
     }
+    if (query.lastError().isValid()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    if (! accountList.isEmpty()) {
+        visitor(accountList);
+    }
+    QString sqlDeleted = QString("SELECT id FROM %1_tombstone ").arg(m_tableName);
+    sqlDeleted.append(sqlWhere).append(QString("deletexid >= ?::xid8"));
+    if (! query.prepare(sqlDeleted)) {
+        setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    for (const QVariant& value : valueList) {
+        query.addBindValue(value);
+    }
+    query.addBindValue(since.toString());
+    if (! query.exec()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    while (query.next()) {
+        deletedList << query.value(0);
+    }
+    watermark = snapshotXmin;
 
-    return accountList;
+    return true;
+}
+
+/**
+ * The change counter of the user from migration 006. It is raised in the
+ * transaction of each change, so a change is counted when it commits.
+ * Without a user the counters of all users are summed up. A database
+ * without the counter table is no error. The stamp is empty then.
+ * @param userObj           Option table with the user ('U').
+ * @return                  The stamp. Or an empty string.
+ */
+QString PostgreSQL::changeStamp(const OptionTable &userObj)
+{
+    OptionTable searchObj;
+    searchObj.insert('U', userObj.value('U'));
+    QVariantList valueList;
+    QString sqlSelect = QString("SELECT COALESCE(sum(changes), 0) FROM %1_counter ").arg(m_tableName);
+    sqlSelect.append(sqlWhereOf(searchObj, FilterExpression(), valueList));
+    QSqlQuery query(readDatabase());
+    if (! query.prepare(sqlSelect)) {
+        return QString();
+    }
+    for (const QVariant& value : valueList) {
+        query.addBindValue(value);
+    }
+    if (! query.exec() || ! query.next()) {
+        return QString();
+    }
+
+    return query.value(0).toString();
+}
+
+/**
+ * The primary server, the database and the table of the Account objects.
+ * The replicas hold the same data.
+ * @return
+ */
+QString PostgreSQL::storeKey() const
+{
+    QSqlDatabase db = QSqlDatabase::database(QString("local"), false);
+
+    return QString("postgresql://%1:%2/%3/%4").arg(db.hostName()).arg(db.port()).arg(db.databaseName()).arg(m_tableName);
 }
 
 /**
@@ -189,11 +702,10 @@ QList<QVariantMap> PostgreSQL::findAccountsLike(const OptionTable &searchObj)
  */
 QList<QVariantMap> PostgreSQL::allPersistedAccounts()
 {
-    QSqlDatabase db = QSqlDatabase::database(QString("local"), false);
-    if (! db.open()) {
-        setErrorDatabaseConectionFailed(db.lastError().databaseText(), db.lastError().driverText());
+    if (! isOpen() && ! open()) {
         return QList<QVariantMap>();
     }
+    QSqlDatabase db = readDatabase();
     QSqlRecord record = db.record(m_tableName);
     QString sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, m_tableName, record, false);
     QSqlQuery query(sqlSelect, db);
@@ -216,7 +728,7 @@ QList<QVariantMap> PostgreSQL::allPersistedAccounts()
  */
 QVariantMap PostgreSQL::findUser(const OptionTable& userInfo)
 {
-    QSqlDatabase db = QSqlDatabase::database(QString("local"));
+    QSqlDatabase db = readDatabase();
     QSqlRecord record = recordFromOptionTable(userInfo);
     QString sqlSelect = db.driver()->sqlStatement(QSqlDriver::SelectStatement, QString("public.user"), record, false);
     QSqlRecord whereRecord = recordFieldsWithValues(userInfo);
@@ -234,12 +746,71 @@ QVariantMap PostgreSQL::findUser(const OptionTable& userInfo)
     return accountObject(query.record());
 }
 
+/**
+ * Lets the statements of Account objects find the current user by name.
+ * An option table without a user id value ('U') is then restricted to
+ * the Account objects of this user. No separate query for the user is
+ * needed. If the user is not registered the statement sets an error.
+ * @param userName
+ * @return              False if the name is empty.
+ */
+bool PostgreSQL::resolveUserByName(const QString &userName)
+{
+    m_userName = userName;
+
+    return ! m_userName.isEmpty();
+}
+
+/**
+ * Applies the pending migrations of the schema (see SchemaMigration).
+ * @param isDryRun          Only report the pending migrations.
+ * @param partitionCount    Number of hash partitions of the account table. 0 for none.
+ * @param reportList        Takes a line for each pending migration.
+ * @return                  False on error.
+ */
+bool PostgreSQL::migrateSchema(const bool isDryRun, const int partitionCount, QStringList &reportList)
+{
+    if (! writeDatabase().isOpen()) {
+        return false;
+    }
+    SchemaMigration migration(QString("local"), m_tableName);
+    if (! migration.migrate(isDryRun, partitionCount, reportList)) {
+        m_errorMsg.append(migration.error());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Checks with EXPLAIN if the statements of the application are served
+ * by indexes (see SchemaMigration).
+ * @param reportList        Takes a line for each statement.
+ * @return                  False on error or if a statement is not served.
+ */
+bool PostgreSQL::verifySchema(QStringList &reportList)
+{
+    if (! primaryDatabase().isOpen()) {
+        return false;
+    }
+    SchemaMigration migration(QString("local"), m_tableName);
+    bool isServed = migration.verify(reportList);
+    m_errorMsg.append(migration.error());
+
+    return isServed;
+}
+
 /**
  * Private
  * Reads credentials from a file and initializes the database.
+ * Loads the driver. Runs only once, on first use of the connection.
  */
 void PostgreSQL::initializeDatabase()
 {
+    if (m_isInitialized) {
+        return;
+    }
+    m_isInitialized = true;
     QString path = Credentials::usersHomePath() + QString("/.pwmanager");
     Credentials credentials = Credentials::credentialsFromFile(path);
     QSqlDatabase db = QSqlDatabase::addDatabase(QString("QPSQL"), "local");
@@ -249,6 +820,131 @@ void PostgreSQL::initializeDatabase()
     db.setUserName(credentials.value(Credentials::Username));
     db.setPassword(credentials.value(Credentials::Password));
     m_tableName = credentials.value(Credentials::TableName);
+    m_replicaHostList = credentials.value(Credentials::ReplicaHosts).split(QChar(','), Qt::SkipEmptyParts);
+}
+
+/**
+ * Protected
+ * Begins a transaction on the primary.
+ * @return
+ */
+bool PostgreSQL::executeBegin()
+{
+    QSqlDatabase db = writeDatabase();
+    if (! db.transaction()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Protected
+ * Commits the transaction on the primary.
+ * @return
+ */
+bool PostgreSQL::executeCommit()
+{
+    QSqlDatabase db = QSqlDatabase::database(QString("local"), false);
+    if (! db.commit()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Protected
+ * Rolls back the transaction on the primary.
+ * @return
+ */
+bool PostgreSQL::executeRollback()
+{
+    QSqlDatabase db = QSqlDatabase::database(QString("local"), false);
+    if (! db.rollback()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Opens a connection to the first replica which answers. The replicas
+ * are taken from the credentials ('replicahosts:host[:port],...'). They
+ * have the same database, user and password as the primary.
+ * @return              False if there is no replica or none answers.
+ */
+bool PostgreSQL::openReplica()
+{
+    if (m_replicaHostList.isEmpty()) {
+        return false;
+    }
+    QSqlDatabase primary = QSqlDatabase::database(QString("local"), false);
+    QSqlDatabase replica = QSqlDatabase::contains(QString("replica"))
+            ? QSqlDatabase::database(QString("replica"), false)
+            : QSqlDatabase::cloneDatabase(primary, QString("replica"));
+    // A replica which is down must not delay the start much.
+    replica.setConnectOptions(QString("connect_timeout=%1").arg(m_replicaTimeout));
+    for (const QString& host : m_replicaHostList) {
+        QStringList hostPort = host.trimmed().split(QChar(':'));
+        replica.setHostName(hostPort.first());
+        replica.setPort(hostPort.size() > 1 ? hostPort[1].toInt() : primary.port());
+        if (replica.open()) {
+            m_isReplicaOpen = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Private
+ * Get the connection to the primary. It is opened on first use, so a
+ * command which only reads from a replica never connects to the primary.
+ * @return
+ */
+QSqlDatabase PostgreSQL::primaryDatabase()
+{
+    QSqlDatabase db = QSqlDatabase::database(QString("local"), false);
+    if (! db.isOpen() && ! db.open()) {
+        setErrorDatabaseConectionFailed(db.lastError().databaseText(), db.lastError().driverText());
+    }
+
+    return db;
+}
+
+/**
+ * Private
+ * Get the connection for a statement which changes data. That is always
+ * the primary. All later reads go to the primary as well, so a command
+ * reads its own writes. A replica may not have received them yet.
+ * @return
+ */
+QSqlDatabase PostgreSQL::writeDatabase()
+{
+    m_hasWritten = true;
+
+    return primaryDatabase();
+}
+
+/**
+ * Private
+ * Get the connection for a statement which only reads. That is the
+ * replica until the first write. Without replica it is the primary.
+ * @return
+ */
+QSqlDatabase PostgreSQL::readDatabase()
+{
+    if (m_isReplicaOpen && ! m_hasWritten) {
+        return QSqlDatabase::database(QString("replica"), false);
+    }
+
+    return primaryDatabase();
 }
 
 /**
@@ -289,8 +985,10 @@ QSqlRecord PostgreSQL::recordFromOptionTable(const OptionTable &optionTable) con
 QSqlRecord PostgreSQL::recordWithIdentifier(const OptionTable &optionTable) const
 {
     QSqlRecord record;
-    QVariant userId = optionTable.value('U');
-    recordAppendField(record, optionToRealName('U'), userId);
+    if (! isUserDeferred(optionTable)) {
+        QVariant userId = optionTable.value('U');
+        recordAppendField(record, optionToRealName('U'), userId);
+    }
     QVariant valueId = optionTable.value('i', QVariant(QVariant::Invalid));
     if (valueId.isValid()) {
         recordAppendField(record, optionToRealName('i'), valueId);
@@ -354,6 +1052,252 @@ QSqlRecord PostgreSQL::recordFieldsWithValues(const OptionTable &optionTable) co
     return record;
 }
 
+/**
+ * Private
+ * True if the user of an option table is found by name inside the
+ * statement. That is if a user name is set and the table has no user id.
+ * @param optionTable
+ * @return
+ */
+bool PostgreSQL::isUserDeferred(const OptionTable &optionTable) const
+{
+    return ! m_userName.isEmpty() && ! optionTable.value('U').isValid();
+}
+
+/**
+ * Private
+ * Joins the escaped field names of a record. Each name is followed by
+ * a suffix. E.g. suffix ' = ?' and separator ' AND ' builds a condition.
+ * @param record
+ * @param suffix
+ * @param separator
+ * @return
+ */
+QString PostgreSQL::sqlFieldList(const QSqlRecord &record, const QString &suffix, const QString &separator) const
+{
+    QSqlDriver* pDriver = QSqlDatabase::database(QString("local"), false).driver();
+    QString list;
+    for (int index=0; index<record.count(); ++index) {
+        if (index > 0) {
+            list.append(separator);
+        }
+        list.append(pDriver->escapeIdentifier(record.fieldName(index), QSqlDriver::FieldName)).append(suffix);
+    }
+
+    return list;
+}
+
+/**
+ * Private
+ * Conflict clause of an upsert. The row of the same user, provider and
+ * username is updated with the values of the insert. A row which was
+ * inserted has no deleting transaction yet (xmax = 0). So the statement
+ * returns true for an insert and false for an update.
+ * @param record            The inserted columns.
+ * @param insertOnlyList    Options which are not changed on update.
+ * @return
+ */
+QString PostgreSQL::sqlOnConflict(const QSqlRecord &record, const QList<char> &insertOnlyList) const
+{
+    QSqlDriver* pDriver = QSqlDatabase::database(QString("local"), false).driver();
+    QStringList keyList;
+    for (const char option : { 'U', 'p', 'u' }) {
+        keyList << pDriver->escapeIdentifier(optionToRealName(option), QSqlDriver::FieldName);
+    }
+    QStringList skipList;
+    skipList << optionToRealName('U') << optionToRealName('p') << optionToRealName('u') << optionToRealName('i');
+    for (const char option : insertOnlyList) {
+        skipList << optionToRealName(option);
+    }
+    QStringList setList;
+    for (int index=0; index<record.count(); ++index) {
+        if (! skipList.contains(record.fieldName(index))) {
+            setList << QString("%1 = EXCLUDED.%1").arg(pDriver->escapeIdentifier(record.fieldName(index), QSqlDriver::FieldName));
+        }
+    }
+    // Without values to update the row is set to itself. So it is returned.
+    if (setList.isEmpty()) {
+        setList << QString("%1 = EXCLUDED.%1").arg(keyList[1]);
+    }
+
+    return QString(" ON CONFLICT (%1) DO UPDATE SET %2 RETURNING (xmax = 0) AS inserted")
+            .arg(keyList.join(", "), setList.join(", "));
+}
+
+/**
+ * Private
+ * Where clause of a bulk change. It restricts to the user, to the search
+ * values and to the filter. A user found by name is looked up inside the
+ * statement. An unknown user matches no rows.
+ * @param searchObj
+ * @param filter
+ * @param valueList         Takes the bind values of the clause.
+ * @return                  The where clause. Or an empty string without conditions.
+ */
+QString PostgreSQL::sqlWhereOf(const OptionTable &searchObj, const FilterExpression &filter, QVariantList &valueList) const
+{
+    QSqlDriver* pDriver = QSqlDatabase::database(QString("local"), false).driver();
+    QStringList conditionList;
+    if (isUserDeferred(searchObj)) {
+        conditionList << QString("%1 = (SELECT id FROM public.user WHERE name = ?)").arg(optionToRealName('U'));
+        valueList << m_userName;
+    }
+    QSqlRecord recordSearch = recordFieldsWithValues(searchObj);
+    if (! recordSearch.isEmpty()) {
+        conditionList << sqlFieldList(recordSearch, QString(" = ?"), QString(" AND "));
+        for (int index=0; index<recordSearch.count(); ++index) {
+            valueList << recordSearch.value(index);
+        }
+    }
+    QString sqlFilter = filter.sqlCondition([pDriver](const QString& name) {
+        return pDriver->escapeIdentifier(name, QSqlDriver::FieldName);
+    }, valueList);
+    if (! sqlFilter.isEmpty()) {
+        conditionList << sqlFilter;
+    }
+    if (conditionList.isEmpty()) {
+        return QString();
+    }
+
+    return QString("WHERE ").append(conditionList.join(" AND "));
+}
+
+/**
+ * Private
+ * Executes a bulk change or its count on a dry run. A change which
+ * affects more rows than the limit is rolled back.
+ * @param sqlStatement
+ * @param valueList         Bind values.
+ * @param maxRows           0 for no limit.
+ * @param isDryRun          The statement is a count.
+ * @return                  Number of affected or counted rows. -1 on error.
+ */
+int PostgreSQL::execBulk(const QString &sqlStatement, const QVariantList &valueList, const int maxRows, const bool isDryRun)
+{
+    if (isDryRun) {
+        QSqlQuery query(readDatabase());
+        bool isDone = query.prepare(sqlStatement);
+        for (const QVariant& value : valueList) {
+            query.addBindValue(value);
+        }
+        if (! isDone || ! query.exec()) {
+            setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+            return -1;
+        }
+        return query.next() ? query.value(0).toInt() : 0;
+    }
+    TransactionGuard transaction(this);
+    if (! transaction.isActive()) {
+        return -1;
+    }
+    QSqlQuery query(writeDatabase());
+    bool isDone = query.prepare(sqlStatement);
+    for (const QVariant& value : valueList) {
+        query.addBindValue(value);
+    }
+    if (! isDone || ! query.exec()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return -1;
+    }
+    int affected = query.numRowsAffected();
+    if (maxRows > 0 && affected > maxRows) {
+        transaction.rollback();
+    } else if (! transaction.commit()) {
+        return -1;
+    }
+
+    return affected;
+}
+
+/**
+ * Private
+ * Select statement which finds the user by name and its Account objects.
+ * There is no row if the user is not registered. There is one row with
+ * 'current_matched' false if the user has no matching Account object.
+ * Bind values are the user name and then the values of conditions.
+ * @param columns           The selected columns.
+ * @param conditions        Columns which must be equal to their values.
+ * @return
+ */
+QString PostgreSQL::sqlSelectOfUser(const QSqlRecord &columns, const QSqlRecord &conditions) const
+{
+    QString userColumn = optionToRealName('U');
+    QString sqlSelect = m_sqlCurrentUser;
+    sqlSelect.append(QString(" SELECT current_userid, %1 IS NOT NULL AS current_matched").arg(userColumn));
+    if (! columns.isEmpty()) {
+        sqlSelect.append(", ").append(sqlFieldList(columns, QString(), QString(", ")));
+    }
+    sqlSelect.append(QString(" FROM current_user_id LEFT JOIN %1 ON %2 = current_userid").arg(m_tableName, userColumn));
+    if (! conditions.isEmpty()) {
+        sqlSelect.append(" AND ").append(sqlFieldList(conditions, QString(" = ?"), QString(" AND ")));
+    }
+
+    return sqlSelect;
+}
+
+/**
+ * Private
+ * Wraps an insert, update or delete statement. The statement and the
+ * search for the user are executed together. The result is the number
+ * of users found and the number of rows changed.
+ * @param sqlStatement
+ * @return
+ */
+QString PostgreSQL::sqlModifyOfUser(const QString &sqlStatement) const
+{
+    QString sqlModify = m_sqlCurrentUser;
+    sqlModify.append(", changed AS (").append(sqlStatement).append(" RETURNING 1)");
+    sqlModify.append(" SELECT (SELECT count(*) FROM current_user_id), (SELECT count(*) FROM changed)");
+
+    return sqlModify;
+}
+
+/**
+ * Private
+ * Executes a statement of sqlModifyOfUser(). Binds the user name and
+ * then the values of the record.
+ * @param sqlStatement
+ * @param record
+ * @return                  Number of rows changed. -1 on error.
+ */
+int PostgreSQL::execModifyOfUser(const QString &sqlStatement, const QSqlRecord &record)
+{
+    QSqlQuery query(writeDatabase());
+    if (! query.prepare(sqlStatement)) {
+        setErrorPrepareStatement(query.lastError().databaseText(), query.lastError().driverText());
+        return -1;
+    }
+    query.addBindValue(m_userName);
+    for (int index=0; index<record.count(); ++index) {
+        query.addBindValue(record.value(index));
+    }
+    if (! query.exec() || ! query.next()) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return -1;
+    }
+    if (query.value(0).toInt() == 0) {
+        setErrorUserNotRegistered();
+        return -1;
+    }
+
+    return query.value(1).toInt();
+}
+
+/**
+ * Private
+ * Account object of a row from sqlSelectOfUser(). Drops the columns
+ * 'current_userid' and 'current_matched'.
+ * @param record
+ * @return
+ */
+QVariantMap PostgreSQL::accountOfUser(QSqlRecord record) const
+{
+    record.remove(0);
+    record.remove(0);
+
+    return accountObject(record);
+}
+
 /**
  * Public
  * Translates the option char into an string. The string is the
@@ -362,6 +1306,18 @@ QSqlRecord PostgreSQL::recordFieldsWithValues(const OptionTable &optionTable) co
  * @return              A database column name. Or an emty string.
  */
 QString PostgreSQL::optionToRealName(const char option) const
+{
+    return columnName(option);
+}
+
+/**
+ * Static
+ * The column name of an option. The tables are the same for all
+ * PostgreSQL backends.
+ * @param option        The option character.
+ * @return              A database column name. Or an emty string.
+ */
+QString PostgreSQL::columnName(const char option)
 {
     QString name;
     switch (option) {
@@ -411,6 +1367,15 @@ QString PostgreSQL::optionToRealName(const char option) const
     return name;
 }
 
+/**
+ * Private
+ * Set an error message if the current user is not found by name.
+ */
+void PostgreSQL::setErrorUserNotRegistered()
+{
+    m_errorMsg.append(QString("You are not registered in this application.\n"));
+}
+
 /**
  * Private
  * Set an error message if database connection fails.
@@ -2,7 +2,9 @@
 #define POSTGRESQL_H
 
 #include "persistence.h"
+#include <QSqlDatabase>
 #include <QSqlRecord>
+#include <QStringList>
 
 class PostgreSQL : public Persistence
 {
@@ -17,30 +19,80 @@ public:
     bool persistAccountObject(const OptionTable &account);
     int deleteAccountObject(const OptionTable &account);
     bool modifyAccountObject(const OptionTable &modifications);
+    int modifyAccountObjects(const QList<OptionTable> &modificationList);
+    UpsertResult upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList);
+    int deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun);
+    int modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun);
     QVariantMap findAccount(const OptionTable &searchObj);
     QList<QVariantMap> findAccountsLike(const OptionTable &searchObj);
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor, const int batchSize = 4096);
+    bool streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                             const AccountPage &page, const AccountBatchVisitor &visitor,
+                             const int batchSize = 4096);
+    bool findChangesSince(const OptionTable &userObj, const QVariant &since, const AccountBatchVisitor &visitor,
+                          QVariantList &deletedList, QVariant &watermark);
+    QString changeStamp(const OptionTable &userObj);
+    QString storeKey() const;
     // Can be called without open database connection. (Reads the whole table)
     QList<QVariantMap> allPersistedAccounts();
     // User management
     QVariantMap findUser(const OptionTable &userInfo);
+    bool resolveUserByName(const QString &userName);
+    // Schema management
+    bool migrateSchema(const bool isDryRun, const int partitionCount, QStringList &reportList);
+    bool verifySchema(QStringList &reportList);
     // Error messages
     QString error() const               { return m_errorMsg; }
     bool hasError() const               { return !m_errorMsg.isEmpty(); }
     // Translation
     QString optionToRealName(const char option) const;
+    static QString columnName(const char option);
+
+protected:
+    // Transactions
+    bool executeBegin();
+    bool executeCommit();
+    bool executeRollback();
 
 private:
     QString m_tableName;
     QString m_errorMsg;
+    bool m_isInitialized;
+    QStringList m_replicaHostList;
+    bool m_isReplicaOpen;
+    bool m_hasWritten;
+    QString m_userName;
+    static const QString m_sqlCurrentUser;
+    static const int m_batchSize = 1000;
+    static const int m_replicaTimeout = 2;          // Seconds
 
     // Initialization
     void initializeDatabase();
+    // Connections
+    bool openReplica();
+    QSqlDatabase primaryDatabase();
+    QSqlDatabase writeDatabase();
+    QSqlDatabase readDatabase();
     // Translation
     QSqlRecord recordFromOptionTable(const OptionTable& optionTable) const;
     QSqlRecord recordWithIdentifier(const OptionTable &optionTable) const;
     QSqlRecord recordWithoutIdentifier(OptionTable optionTable) const;
     QSqlRecord recordFieldsWithValues(const OptionTable& optionTable) const;
+    // Statements which resolve the user by name
+    bool isUserDeferred(const OptionTable& optionTable) const;
+    QString sqlFieldList(const QSqlRecord& record, const QString& suffix, const QString& separator) const;
+    QString sqlSelectOfUser(const QSqlRecord& columns, const QSqlRecord& conditions) const;
+    QString sqlModifyOfUser(const QString& sqlStatement) const;
+    QString sqlOnConflict(const QSqlRecord& record, const QList<char>& insertOnlyList) const;
+    // Bulk changes
+    QString sqlWhereOf(const OptionTable& searchObj, const FilterExpression& filter, QVariantList& valueList) const;
+    int execBulk(const QString& sqlStatement, const QVariantList& valueList, const int maxRows, const bool isDryRun);
+    int execModifyOfUser(const QString& sqlStatement, const QSqlRecord& record);
+    QVariantMap accountOfUser(QSqlRecord record) const;
     // Error messages
+    void setErrorUserNotRegistered();
     void setErrorDatabaseConectionFailed(const QString& database, const QString& driver);
     void setErrorPrepareStatement(const QString& database, const QString& driver);
     void setErrorExecutionFailed(const QString& database, const QString& driver);
@@ -0,0 +1,956 @@
+#include "postgresqlnative.h"
+#include "postgresql.h"
+#include "credentials.h"
+#include "transactionguard.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <libpq-fe.h>
+#include <cstring>
+
+// Type oids of the PostgreSQL catalog (pg_type) which are decoded.
+enum TypeOid {
+    BoolOid = 16, NameOid = 19, Int8Oid = 20, Int2Oid = 21, Int4Oid = 23, TextOid = 25,
+    Float4Oid = 700, Float8Oid = 701, BpcharOid = 1042, VarcharOid = 1043,
+    DateOid = 1082, TimestampOid = 1114, TimestampTzOid = 1184
+};
+
+// Binary results are requested for all statements.
+static const int s_binaryFormat = 1;
+
+
+/**
+ * Constructor
+ * Does not connect. The credentials are read by open().
+ */
+PostgreSQLNative::PostgreSQLNative() :
+    m_pConnection(nullptr)
+{
+
+}
+
+/**
+ * Destructor
+ * Closes an open connection.
+ */
+PostgreSQLNative::~PostgreSQLNative()
+{
+    close();
+}
+
+// Override
+bool PostgreSQLNative::open(const QString &parameter)
+{
+    Q_UNUSED(parameter)
+    if (m_pConnection != nullptr) {
+        return true;
+    }
+    QString path = Credentials::usersHomePath() + QString("/.pwmanager");
+    Credentials credentials = Credentials::credentialsFromFile(path);
+    m_tableName = credentials.value(Credentials::TableName);
+    QByteArray host = credentials.value(Credentials::Hostname).toUtf8();
+    QByteArray port = credentials.value(Credentials::Port).toUtf8();
+    QByteArray database = credentials.value(Credentials::DatabaseName).toUtf8();
+    QByteArray user = credentials.value(Credentials::Username).toUtf8();
+    QByteArray password = credentials.value(Credentials::Password).toUtf8();
+    const char* keywords[] = { "host", "port", "dbname", "user", "password", nullptr };
+    const char* values[] = { host.constData(), port.constData(), database.constData(),
+                             user.constData(), password.constData(), nullptr };
+    m_pConnection = PQconnectdbParams(keywords, values, 0);
+    if (PQstatus(m_pConnection) != CONNECTION_OK) {
+        setErrorDatabaseConectionFailed();
+        PQfinish(m_pConnection);
+        m_pConnection = nullptr;
+        return false;
+    }
+    if (! loadColumnTypes(m_tableName) || ! loadColumnTypes(QString("public.user"))) {
+        PQfinish(m_pConnection);
+        m_pConnection = nullptr;
+        return false;
+    }
+    setOpen(true);
+
+    return true;
+}
+
+// Override
+void PostgreSQLNative::close()
+{
+    abortTransaction();
+    if (m_pConnection != nullptr) {
+        PQfinish(m_pConnection);
+        m_pConnection = nullptr;
+    }
+    setOpen(false);
+}
+
+// Override
+bool PostgreSQLNative::persistAccountObject(const OptionTable &account)
+{
+    ColumnList columns = columnsFromOptionTable(account);
+    QByteArray sqlInsert = "INSERT INTO " + m_tableName.toUtf8() + " (" + sqlNameList(columns) + ") VALUES (";
+    for (int index=1; index<=columns.size(); ++index) {
+        sqlInsert.append(index > 1 ? ", $" : "$").append(QByteArray::number(index));
+    }
+    sqlInsert.append(')');
+    Parameters parameters;
+    parameters.append(columns);
+    PGresult* pResult = execute(sqlInsert, parameters);
+    if (pResult == nullptr) {
+        return false;
+    }
+    PQclear(pResult);
+
+    return true;
+}
+
+// Override
+int PostgreSQLNative::deleteAccountObject(const OptionTable &account)
+{
+    ColumnList identifier = columnsWithIdentifier(account);
+    if (identifier.isEmpty()) {
+        m_errorMsg.append(QString("Can not identify Account object in database!\n"));
+        m_errorMsg.append(QString("It needs a 'id' value. Or 'provider' and 'username' to identify an Account object.\n"));
+        return 0;
+    }
+    int parameter = 1;
+    QByteArray sqlDelete = "DELETE FROM " + m_tableName.toUtf8() + " WHERE "
+                         + sqlConditionList(identifier, " AND ", parameter);
+    Parameters parameters;
+    parameters.append(identifier);
+    PGresult* pResult = execute(sqlDelete, parameters);
+    if (pResult == nullptr) {
+        return -1;
+    }
+    int rowsRemoved = QByteArray(PQcmdTuples(pResult)).toInt();
+    PQclear(pResult);
+
+    return rowsRemoved;
+}
+
+// Override
+bool PostgreSQLNative::modifyAccountObject(const OptionTable &modifications)
+{
+    ColumnList identifier = columnsWithIdentifier(modifications);
+    if (identifier.isEmpty()) {
+        m_errorMsg.append(QString("Can not identify Account object in database!\n"));
+        m_errorMsg.append(QString("It needs a 'id' value. Or 'provider' and 'username' to identify an Account object.\n"));
+        return false;
+    }
+    ColumnList values = columnsWithoutIdentifier(modifications);
+    int parameter = 1;
+    QByteArray sqlUpdate = "UPDATE " + m_tableName.toUtf8() + " SET " + sqlConditionList(values, ", ", parameter);
+    sqlUpdate.append(" WHERE ").append(sqlConditionList(identifier, " AND ", parameter));
+    Parameters parameters;
+    parameters.append(values);
+    parameters.append(identifier);
+    PGresult* pResult = execute(sqlUpdate, parameters);
+    if (pResult == nullptr) {
+        return false;
+    }
+    PQclear(pResult);
+
+    return true;
+}
+
+/**
+ * Modifies a list of Account objects. The update statement is prepared
+ * once. The modifications are sent in batches. Each batch is one
+ * transaction. If a modification fails its batch is rolled back and
+ * processing stops.
+ * @param modificationList      Modifications with the same set of options.
+ * @return                      Number of modifications committed.
+ */
+int PostgreSQLNative::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    if (modificationList.isEmpty()) {
+        return 0;
+    }
+    ColumnList identifier = columnsWithIdentifier(modificationList.first());
+    if (identifier.isEmpty()) {
+        m_errorMsg.append(QString("Can not identify Account object in database!\n"));
+        m_errorMsg.append(QString("It needs a 'id' value. Or 'provider' and 'username' to identify an Account object.\n"));
+        return 0;
+    }
+    ColumnList values = columnsWithoutIdentifier(modificationList.first());
+    int parameter = 1;
+    QByteArray sqlUpdate = "UPDATE " + m_tableName.toUtf8() + " SET " + sqlConditionList(values, ", ", parameter);
+    sqlUpdate.append(" WHERE ").append(sqlConditionList(identifier, " AND ", parameter));
+    ColumnList templateColumns = values + identifier;
+
+    return modifyInPipeline(modificationList, sqlUpdate, templateColumns);
+}
+
+/**
+ * Find a Account object in database.
+ * @param searchObj
+ * @return
+ */
+QVariantMap PostgreSQLNative::findAccount(const OptionTable &searchObj)
+{
+    ColumnList identifier = columnsWithIdentifier(searchObj);
+    Parameters parameters;
+    parameters.append(identifier);
+    PGresult* pResult = execute(sqlSelect(m_tableName, columnsFromOptionTable(searchObj), identifier), parameters);
+    if (pResult == nullptr) {
+        return QVariantMap();
+    }
+    QVariantMap account;
+    if (PQntuples(pResult) > 0) {
+        account = accountObject(pResult, 0);
+    }
+    PQclear(pResult);
+
+    return account;
+}
+
+/**
+ * Find Account objects which fits to the search values of search object.
+ * @param searchObj
+ * @return
+ */
+QList<QVariantMap> PostgreSQLNative::findAccountsLike(const OptionTable &searchObj)
+{
+    QList<QVariantMap> accountList;
+    streamAccountsLike(searchObj, [&accountList](const QList<QVariantMap>& batch) {
+        accountList << batch;
+        return true;
+    });
+
+    return accountList;
+}
+
+/**
+ * Find Account objects which fits to the search values of search object.
+ * The rows are read in single row mode and handed in batches to the
+ * visitor. If the visitor stops the query is canceled.
+ * @param searchObj
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool PostgreSQLNative::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor, const int batchSize)
+{
+    ColumnList conditions = columnsWithValues(searchObj);
+    QByteArray sqlStatement = sqlSelect(m_tableName, columnsFromOptionTable(searchObj), conditions);
+    Parameters parameters;
+    parameters.append(conditions);
+    if (PQsendQueryParams(m_pConnection, sqlStatement.constData(), parameters.count(), nullptr,
+                          parameters.values(), nullptr, nullptr, s_binaryFormat) != 1) {
+        setErrorExecutionFailed(nullptr);
+        return false;
+    }
+    PQsetSingleRowMode(m_pConnection);
+    QList<QVariantMap> accountList;
+    accountList.reserve(batchSize);
+    bool isStopped = false;
+    bool isDone = true;
+    // All results must be read before the connection takes the next statement.
+    while (PGresult* pResult = PQgetResult(m_pConnection)) {
+        // Rows and the cancel error after the visitor stopped are dropped.
+        ExecStatusType status = PQresultStatus(pResult);
+        if (! isStopped && status == PGRES_SINGLE_TUPLE) {
+            accountList << accountObject(pResult, 0);
+            if (accountList.size() >= batchSize) {
+                if (! visitor(accountList)) {
+                    isStopped = true;
+                    char errorBuffer[256];
+                    PGcancel* pCancel = PQgetCancel(m_pConnection);
+                    PQcancel(pCancel, errorBuffer, sizeof(errorBuffer));
+                    PQfreeCancel(pCancel);
+                }
+                accountList.clear();
+            }
+        } else if (! isStopped && status != PGRES_TUPLES_OK) {
+            setErrorExecutionFailed(pResult);
+            isDone = false;
+        }
+        PQclear(pResult);
+    }
+    if (isDone && ! isStopped && ! accountList.isEmpty()) {
+        visitor(accountList);
+    }
+
+    return isDone;
+}
+
+/**
+ * Reads the whole database table. All data is returned as a list of
+ * Account objects (QVariantMap).
+ * @return accountList      A list of accounts stored in database.
+ */
+QList<QVariantMap> PostgreSQLNative::allPersistedAccounts()
+{
+    if (! open()) {
+        return QList<QVariantMap>();
+    }
+    PGresult* pResult = execute(sqlSelect(m_tableName, ColumnList(), ColumnList()), Parameters());
+    if (pResult == nullptr) {
+        return QList<QVariantMap>();
+    }
+    QList<QVariantMap> accountList;
+    int rowCount = PQntuples(pResult);
+    accountList.reserve(rowCount);
+    for (int row=0; row<rowCount; ++row) {
+        accountList << accountObject(pResult, row);
+    }
+    PQclear(pResult);
+
+    return accountList;
+}
+
+/**
+ * @brief Find a user in database 'user' table.
+ * @param userInfo
+ * @return
+ */
+QVariantMap PostgreSQLNative::findUser(const OptionTable &userInfo)
+{
+    ColumnList conditions = columnsWithValues(userInfo);
+    Parameters parameters;
+    parameters.append(conditions);
+    PGresult* pResult = execute(sqlSelect(QString("public.user"), columnsFromOptionTable(userInfo), conditions),
+                                parameters);
+    if (pResult == nullptr) {
+        return QVariantMap();
+    }
+    QVariantMap user;
+    if (PQntuples(pResult) > 0) {
+        user = accountObject(pResult, 0);
+    }
+    PQclear(pResult);
+
+    return user;
+}
+
+/**
+ * Public
+ * Translates the option char into the column name. Both PostgreSQL
+ * backends use the same tables.
+ * @param option        The option character.
+ * @return              A database column name. Or an emty string.
+ */
+QString PostgreSQLNative::optionToRealName(const char option) const
+{
+    return PostgreSQL::columnName(option);
+}
+
+/**
+ * Private
+ * Columns of all options which have a column name. The values may be null.
+ * @param optionTable
+ * @return
+ */
+PostgreSQLNative::ColumnList PostgreSQLNative::columnsFromOptionTable(const OptionTable &optionTable) const
+{
+    ColumnList columnList;
+    for (auto iterator = optionTable.constBegin(); iterator != optionTable.constEnd(); ++iterator) {
+        QString columnName = optionToRealName(iterator.key());
+        if (! columnName.isEmpty()) {
+            columnList << qMakePair(columnName, iterator.value());
+        }
+    }
+
+    return columnList;
+}
+
+/**
+ * Private
+ * The identifier columns. The user id and either the primary key (id) or
+ * the unique values (provider, username).
+ * @param optionTable
+ * @return                  Empty if the Account object can not be identified.
+ */
+PostgreSQLNative::ColumnList PostgreSQLNative::columnsWithIdentifier(const OptionTable &optionTable) const
+{
+    ColumnList columnList;
+    columnList << qMakePair(optionToRealName('U'), optionTable.value('U'));
+    QVariant valueId = optionTable.value('i', QVariant(QVariant::Invalid));
+    if (valueId.isValid()) {
+        columnList << qMakePair(optionToRealName('i'), valueId);
+        return columnList;
+    }
+    QVariant valueProvider = optionTable.value('p', QVariant(QVariant::Invalid));
+    QVariant valueUsername = optionTable.value('u', QVariant(QVariant::Invalid));
+    if (! valueProvider.isValid() || ! valueUsername.isValid()) {
+        return ColumnList();
+    }
+    columnList << qMakePair(optionToRealName('p'), valueProvider);
+    columnList << qMakePair(optionToRealName('u'), valueUsername);
+
+    return columnList;
+}
+
+/**
+ * Private
+ * The columns which are not identifiers.
+ * @param optionTable
+ * @return
+ */
+PostgreSQLNative::ColumnList PostgreSQLNative::columnsWithoutIdentifier(OptionTable optionTable) const
+{
+    optionTable.take('U');
+    if (optionTable.value('i', QVariant(QVariant::Invalid)).isValid()) {
+        optionTable.take('i');
+        return columnsFromOptionTable(optionTable);
+    }
+    if (optionTable.value('p', QVariant(QVariant::Invalid)).isValid() &&
+        optionTable.value('u', QVariant(QVariant::Invalid)).isValid()   ) {
+        optionTable.take('p');
+        optionTable.take('u');
+    }
+
+    return columnsFromOptionTable(optionTable);
+}
+
+/**
+ * Private
+ * The columns of options which have a value.
+ * @param optionTable
+ * @return
+ */
+PostgreSQLNative::ColumnList PostgreSQLNative::columnsWithValues(const OptionTable &optionTable) const
+{
+    ColumnList columnList;
+    for (auto iterator = optionTable.constBegin(); iterator != optionTable.constEnd(); ++iterator) {
+        QString columnName = optionToRealName(iterator.key());
+        if (! columnName.isEmpty() && iterator.value().isValid()) {
+            columnList << qMakePair(columnName, iterator.value());
+        }
+    }
+
+    return columnList;
+}
+
+/**
+ * Private
+ * Select statement. Without columns all columns are selected.
+ * @param tableName
+ * @param columns           Selected columns.
+ * @param conditions        Columns which must be equal to the parameters $1...
+ * @return
+ */
+QByteArray PostgreSQLNative::sqlSelect(const QString &tableName, const ColumnList &columns, const ColumnList &conditions) const
+{
+    QByteArray sqlStatement("SELECT ");
+    sqlStatement.append(sqlSelectList(tableName, columns));
+    sqlStatement.append(" FROM ").append(tableName.toUtf8());
+    if (! conditions.isEmpty()) {
+        int parameter = 1;
+        sqlStatement.append(" WHERE ").append(sqlConditionList(conditions, " AND ", parameter));
+    }
+
+    return sqlStatement;
+}
+
+/**
+ * Private
+ * The select list of the columns. Without columns all columns of the
+ * table are selected. A column of a type which binaryValue() does not
+ * decode is cast to text, so its value is read as text. Without the
+ * types of the table the columns are selected as they are.
+ * @param tableName
+ * @param columns
+ * @return
+ */
+QByteArray PostgreSQLNative::sqlSelectList(const QString &tableName, const ColumnList &columns) const
+{
+    ColumnList typeList = m_columnTypeTable.value(tableName);
+    if (typeList.isEmpty()) {
+        return columns.isEmpty() ? QByteArray("*") : sqlNameList(columns);
+    }
+    QHash<QString, uint> typeTable;
+    for (const QPair<QString, QVariant>& column : typeList) {
+        typeTable.insert(column.first, column.second.toUInt());
+    }
+    const ColumnList& selectedList = columns.isEmpty() ? typeList : columns;
+    QByteArray list;
+    for (int index=0; index<selectedList.size(); ++index) {
+        if (index > 0) {
+            list.append(", ");
+        }
+        QByteArray name = sqlNameList(ColumnList() << selectedList[index]);
+        list.append(name);
+        if (typeTable.contains(selectedList[index].first) && ! isDecoded(typeTable.value(selectedList[index].first))) {
+            list.append("::text AS ").append(name);
+        }
+    }
+
+    return list;
+}
+
+/**
+ * Private
+ * Comma separated list of quoted column names.
+ * @param columns
+ * @return
+ */
+QByteArray PostgreSQLNative::sqlNameList(const ColumnList &columns) const
+{
+    QByteArray list;
+    for (int index=0; index<columns.size(); ++index) {
+        if (index > 0) {
+            list.append(", ");
+        }
+        list.append('"').append(columns[index].first.toUtf8().replace('"', "\"\"")).append('"');
+    }
+
+    return list;
+}
+
+/**
+ * Private
+ * List of 'column = $n'. Used for conditions and for assignments.
+ * @param columns
+ * @param separator         ' AND ' or ', '.
+ * @param parameter         Number of the first parameter. Is set behind the last one.
+ * @return
+ */
+QByteArray PostgreSQLNative::sqlConditionList(const ColumnList &columns, const char *separator, int &parameter) const
+{
+    QByteArray list;
+    for (int index=0; index<columns.size(); ++index) {
+        if (index > 0) {
+            list.append(separator);
+        }
+        list.append(sqlNameList(ColumnList() << columns[index]));
+        list.append(" = $").append(QByteArray::number(parameter++));
+    }
+
+    return list;
+}
+
+/**
+ * Private
+ * Executes a statement and waits for the result.
+ * @param sqlStatement
+ * @param parameters
+ * @return                  The result. Must be cleared with PQclear(). nullptr on error.
+ */
+PGresult* PostgreSQLNative::execute(const QByteArray &sqlStatement, const Parameters &parameters)
+{
+    PGresult* pResult = PQexecParams(m_pConnection, sqlStatement.constData(), parameters.count(), nullptr,
+                                     parameters.values(), nullptr, nullptr, s_binaryFormat);
+    ExecStatusType status = PQresultStatus(pResult);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        setErrorExecutionFailed(pResult);
+        PQclear(pResult);
+        return nullptr;
+    }
+
+    return pResult;
+}
+
+/**
+ * Private
+ * Reads the names and types of the columns of a table in their order.
+ * A table which does not exist has no columns.
+ * @param tableName
+ * @return                  False on error.
+ */
+bool PostgreSQLNative::loadColumnTypes(const QString &tableName)
+{
+    Parameters parameters;
+    parameters.append(QVariant(tableName));
+    PGresult* pResult = execute(QByteArray("SELECT attname, atttypid::int8 FROM pg_attribute "
+                                           "WHERE attrelid = to_regclass($1) AND attnum > 0 AND NOT attisdropped "
+                                           "ORDER BY attnum"), parameters);
+    if (pResult == nullptr) {
+        return false;
+    }
+    ColumnList typeList;
+    for (int row=0; row<PQntuples(pResult); ++row) {
+        typeList << qMakePair(binaryValue(pResult, row, 0).toString(), binaryValue(pResult, row, 1));
+    }
+    PQclear(pResult);
+    m_columnTypeTable.insert(tableName, typeList);
+
+    return true;
+}
+
+/**
+ * Private
+ * Executes a statement without parameters and result rows.
+ * @param sqlStatement
+ * @return                  False on error.
+ */
+bool PostgreSQLNative::executeCommand(const QByteArray &sqlStatement)
+{
+    PGresult* pResult = execute(sqlStatement, Parameters());
+    if (pResult == nullptr) {
+        return false;
+    }
+    PQclear(pResult);
+
+    return true;
+}
+
+/**
+ * Protected
+ * Begins a transaction.
+ * @return
+ */
+bool PostgreSQLNative::executeBegin()
+{
+    return executeCommand(QByteArray("BEGIN"));
+}
+
+/**
+ * Protected
+ * Commits the transaction.
+ * @return
+ */
+bool PostgreSQLNative::executeCommit()
+{
+    return executeCommand(QByteArray("COMMIT"));
+}
+
+/**
+ * Protected
+ * Rolls back the transaction.
+ * @return
+ */
+bool PostgreSQLNative::executeRollback()
+{
+    return executeCommand(QByteArray("ROLLBACK"));
+}
+
+/**
+ * Private
+ * Sends the updates of a batch in pipeline mode and reads the results
+ * after the sync. The statements up to a sync run in one implicit
+ * transaction. A failed update aborts the rest of the batch and rolls it
+ * back. If an update can not be sent, the updates sent before are synced
+ * and counted and processing stops. Batches are small, so the replies fit into the socket buffers
+ * while the batch is sent. Without pipeline mode in libpq the updates
+ * are executed by modifyInTransaction().
+ * @param modificationList
+ * @param sqlUpdate         Update statement with parameters.
+ * @param templateColumns   The columns in order of the parameters.
+ * @return                  Number of modifications committed.
+ */
+int PostgreSQLNative::modifyInPipeline(const QList<OptionTable> &modificationList, const QByteArray &sqlUpdate,
+                                       const ColumnList &templateColumns)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+    // The unnamed statement is used by every update of the pipeline.
+    PGresult* pPrepared = PQprepare(m_pConnection, "", sqlUpdate.constData(), templateColumns.size(), nullptr);
+    if (PQresultStatus(pPrepared) != PGRES_COMMAND_OK) {
+        setErrorExecutionFailed(pPrepared);
+        PQclear(pPrepared);
+        return 0;
+    }
+    PQclear(pPrepared);
+    if (PQenterPipelineMode(m_pConnection) != 1) {
+        setErrorExecutionFailed(nullptr);
+        return 0;
+    }
+    int modified = 0;
+    bool isCommitted = true;
+    for (int begin=0; begin<modificationList.size() && isCommitted; begin+=m_batchSize) {
+        int end = qMin(begin + static_cast<int>(m_batchSize), modificationList.size());
+        int sent = 0;
+        for (int index=begin; index<end; ++index) {
+            Parameters parameters = modificationParameters(modificationList[index], templateColumns);
+            if (PQsendQueryPrepared(m_pConnection, "", parameters.count(), parameters.values(),
+                                    nullptr, nullptr, s_binaryFormat) != 1) {
+                setErrorExecutionFailed(nullptr);
+                isCommitted = false;
+                break;
+            }
+            ++sent;
+        }
+        if (sent == 0) {
+            break;
+        }
+        // The updates already queued are committed by the sync even if a
+        // later one could not be sent. So every result up to the result of
+        // the sync is read and the updates are counted. A nullptr ends the
+        // results of an update; two in a row mean there are no more.
+        if (PQpipelineSync(m_pConnection) != 1) {
+            setErrorExecutionFailed(nullptr);
+            isCommitted = false;
+            break;
+        }
+        int succeeded = 0;
+        bool isSynced = false;
+        int nullCount = 0;
+        while (! isSynced && nullCount < 2) {
+            PGresult* pResult = PQgetResult(m_pConnection);
+            if (pResult == nullptr) {
+                ++nullCount;
+                continue;
+            }
+            nullCount = 0;
+            ExecStatusType status = PQresultStatus(pResult);
+            if (status == PGRES_PIPELINE_SYNC) {
+                isSynced = true;
+            } else if (status == PGRES_COMMAND_OK) {
+                ++succeeded;
+            } else if (status == PGRES_FATAL_ERROR) {
+                setErrorExecutionFailed(pResult);
+            }
+            PQclear(pResult);
+        }
+        // A failed update rolls back all updates of the batch.
+        if (isSynced && succeeded == sent) {
+            modified += sent;
+        } else {
+            isCommitted = false;
+            if (! isSynced) {
+                setErrorExecutionFailed(nullptr);
+            }
+        }
+    }
+    PQexitPipelineMode(m_pConnection);
+
+    return modified;
+#else
+    return modifyInTransaction(modificationList, sqlUpdate, templateColumns);
+#endif
+}
+
+/**
+ * Private
+ * Executes the updates one by one. Each batch is an explicit transaction.
+ * @param modificationList
+ * @param sqlUpdate         Update statement with parameters.
+ * @param templateColumns   The columns in order of the parameters.
+ * @return                  Number of modifications committed.
+ */
+int PostgreSQLNative::modifyInTransaction(const QList<OptionTable> &modificationList, const QByteArray &sqlUpdate,
+                                          const ColumnList &templateColumns)
+{
+    PGresult* pPrepared = PQprepare(m_pConnection, "", sqlUpdate.constData(), templateColumns.size(), nullptr);
+    if (PQresultStatus(pPrepared) != PGRES_COMMAND_OK) {
+        setErrorExecutionFailed(pPrepared);
+        PQclear(pPrepared);
+        return 0;
+    }
+    PQclear(pPrepared);
+    int modified = 0;
+    for (int begin=0; begin<modificationList.size(); begin+=m_batchSize) {
+        int end = qMin(begin + static_cast<int>(m_batchSize), modificationList.size());
+        // Inside a transaction of the caller the batches join it.
+        TransactionGuard transaction(this);
+        if (! transaction.isActive()) {
+            return modified;
+        }
+        for (int index=begin; index<end; ++index) {
+            Parameters parameters = modificationParameters(modificationList[index], templateColumns);
+            PGresult* pResult = PQexecPrepared(m_pConnection, "", parameters.count(), parameters.values(),
+                                               nullptr, nullptr, s_binaryFormat);
+            if (PQresultStatus(pResult) != PGRES_COMMAND_OK) {
+                setErrorExecutionFailed(pResult);
+                PQclear(pResult);
+                return modified;
+            }
+            PQclear(pResult);
+        }
+        if (! transaction.commit()) {
+            return modified;
+        }
+        modified += end - begin;
+    }
+
+    return modified;
+}
+
+/**
+ * Private
+ * The parameters of a modification in the order of the template columns.
+ * @param modifications
+ * @param templateColumns
+ * @return
+ */
+PostgreSQLNative::Parameters PostgreSQLNative::modificationParameters(const OptionTable &modifications,
+                                                                      const ColumnList &templateColumns) const
+{
+    QVariantMap valueMap;
+    ColumnList columnList = columnsWithoutIdentifier(modifications) + columnsWithIdentifier(modifications);
+    for (const QPair<QString, QVariant>& column : columnList) {
+        valueMap.insert(column.first, column.second);
+    }
+    Parameters parameters;
+    for (const QPair<QString, QVariant>& column : templateColumns) {
+        parameters.append(valueMap.value(column.first));
+    }
+
+    return parameters;
+}
+
+/**
+ * Private
+ * Creates an Account object from a row of a result. Uses the column names
+ * as keys.
+ * @param pResult
+ * @param row
+ * @return
+ */
+QVariantMap PostgreSQLNative::accountObject(const PGresult *pResult, const int row) const
+{
+    QVariantMap account;
+    int columnCount = PQnfields(pResult);
+    for (int column=0; column<columnCount; ++column) {
+        account.insert(QString::fromUtf8(PQfname(pResult, column)), binaryValue(pResult, row, column));
+    }
+
+    return account;
+}
+
+/**
+ * Private
+ * Decodes a value in binary format. Numbers are in network byte order.
+ * Dates are days and timestamps are microseconds since 1.1.2000.
+ * Columns of other types are selected as text (see sqlSelectList()). A
+ * value of another type from a statement of unknown columns is returned
+ * as a QByteArray.
+ * @param pResult
+ * @param row
+ * @param column
+ * @return                  The value. Or an invalid value for NULL.
+ */
+QVariant PostgreSQLNative::binaryValue(const PGresult *pResult, const int row, const int column) const
+{
+    if (PQgetisnull(pResult, row, column)) {
+        return QVariant();
+    }
+    const char* pData = PQgetvalue(pResult, row, column);
+    int length = PQgetlength(pResult, row, column);
+    switch (PQftype(pResult, column)) {
+    case BoolOid:
+        return QVariant(pData[0] != 0);
+    case Int2Oid:
+        return QVariant(static_cast<int>(qFromBigEndian<qint16>(pData)));
+    case Int4Oid:
+        return QVariant(qFromBigEndian<qint32>(pData));
+    case Int8Oid:
+        return QVariant(static_cast<qlonglong>(qFromBigEndian<qint64>(pData)));
+    case Float4Oid: {
+        quint32 bits = qFromBigEndian<quint32>(pData);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return QVariant(value);
+    }
+    case Float8Oid: {
+        quint64 bits = qFromBigEndian<quint64>(pData);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return QVariant(value);
+    }
+    case DateOid:
+        return QVariant(QDate(2000, 1, 1).addDays(qFromBigEndian<qint32>(pData)));
+    case TimestampOid: {
+        // Without time zone. Taken as local time like the QtSql driver does.
+        QDateTime dateTime = QDateTime(QDate(2000, 1, 1), QTime(0, 0), Qt::UTC)
+                             .addMSecs(qFromBigEndian<qint64>(pData) / 1000);
+        return QVariant(QDateTime(dateTime.date(), dateTime.time(), Qt::LocalTime));
+    }
+    case TimestampTzOid:
+        return QVariant(QDateTime(QDate(2000, 1, 1), QTime(0, 0), Qt::UTC)
+                        .addMSecs(qFromBigEndian<qint64>(pData) / 1000).toLocalTime());
+    case NameOid:
+    case TextOid:
+    case BpcharOid:
+    case VarcharOid:
+        return QVariant(QString::fromUtf8(pData, length));
+    default:
+        return QVariant(QByteArray(pData, length));
+    }
+}
+
+/**
+ * Private
+ * True if binaryValue() decodes values of the type.
+ * @param typeOid
+ * @return
+ */
+bool PostgreSQLNative::isDecoded(const uint typeOid)
+{
+    switch (typeOid) {
+    case BoolOid:
+    case NameOid:
+    case Int8Oid:
+    case Int2Oid:
+    case Int4Oid:
+    case TextOid:
+    case Float4Oid:
+    case Float8Oid:
+    case BpcharOid:
+    case VarcharOid:
+    case DateOid:
+    case TimestampOid:
+    case TimestampTzOid:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Private
+ * Set an error message if database connection fails.
+ */
+void PostgreSQLNative::setErrorDatabaseConectionFailed()
+{
+    m_errorMsg.append(QString("Could not open Database !\n"));
+    m_errorMsg.append(QString::fromUtf8(PQerrorMessage(m_pConnection))).append('\n');
+}
+
+/**
+ * Private
+ * Set an error message when a statement fails.
+ * @param pResult       The result of the statement or nullptr if it could not be sent.
+ */
+void PostgreSQLNative::setErrorExecutionFailed(const PGresult *pResult)
+{
+    m_errorMsg.append(QString("Could not execute SQL statement !\n"));
+    if (pResult != nullptr) {
+        m_errorMsg.append(QString::fromUtf8(PQresultErrorMessage(pResult))).append('\n');
+    } else {
+        m_errorMsg.append(QString::fromUtf8(PQerrorMessage(m_pConnection))).append('\n');
+    }
+}
+
+/**
+ * Appends the text of a value. NULL values have no text.
+ * @param value
+ */
+void PostgreSQLNative::Parameters::append(const QVariant &value)
+{
+    if (value.isNull()) {
+        m_valueList.append(QByteArray());
+        m_pointerList.append(nullptr);
+        return;
+    }
+    QByteArray text;
+    switch (value.type()) {
+    case QVariant::Bool:
+        text = value.toBool() ? QByteArray("t") : QByteArray("f");
+        break;
+    case QVariant::Date:
+        text = value.toDate().toString(Qt::ISODate).toLatin1();
+        break;
+    case QVariant::DateTime:
+        text = value.toDateTime().toString(Qt::ISODateWithMs).toLatin1();
+        break;
+    case QVariant::Time:
+        text = value.toTime().toString(Qt::ISODateWithMs).toLatin1();
+        break;
+    default:
+        text = value.toString().toUtf8();
+        break;
+    }
+    m_valueList.append(text);
+    m_pointerList.append(m_valueList.last().constData());
+}
+
+/**
+ * Appends the values of columns.
+ * @param columnList
+ */
+void PostgreSQLNative::Parameters::append(const ColumnList &columnList)
+{
+    for (const QPair<QString, QVariant>& column : columnList) {
+        append(column.second);
+    }
+}
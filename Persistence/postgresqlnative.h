@@ -0,0 +1,118 @@
+#ifndef POSTGRESQLNATIVE_H
+#define POSTGRESQLNATIVE_H
+
+/* ------------------------------------------------------------------------------
+ * Class PostgreSQLNative
+ *
+ * A PostgreSQL persistence which uses libpq directly instead of QtSql.
+ * It uses the same credentials file (~/.pwmanager) and the same tables as
+ * class PostgreSQL.
+ * - Results are requested in binary format. Values are decoded by the type
+ *   of their column. Columns of types which are not decoded (e.g. NUMERIC)
+ *   are cast to text in the select list. Parameters are sent as text.
+ * - Rows of streamAccountsLike() are read in single row mode.
+ * - modifyAccountObjects() sends a batch of updates in pipeline mode without
+ *   waiting for each reply. A batch ends with a sync and is one implicit
+ *   transaction. Pipeline mode needs libpq 14. Older versions send the
+ *   updates one by one in an explicit transaction.
+ * The backend is chosen with environment variable PWMANAGER_BACKEND=libpq.
+ * ------------------------------------------------------------------------------
+ */
+
+#include "persistence.h"
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+typedef struct pg_conn PGconn;
+typedef struct pg_result PGresult;
+
+class PostgreSQLNative : public Persistence
+{
+public:
+    PostgreSQLNative();
+    ~PostgreSQLNative() override;
+
+    // Persistence interface
+public:
+    bool open(const QString& parameter = QString()) override;
+    void close() override;
+    // Call following function with open database connection.
+    bool persistAccountObject(const OptionTable &account) override;
+    int deleteAccountObject(const OptionTable &account) override;
+    bool modifyAccountObject(const OptionTable &modifications) override;
+    int modifyAccountObjects(const QList<OptionTable> &modificationList) override;
+    QVariantMap findAccount(const OptionTable &searchObj) override;
+    QList<QVariantMap> findAccountsLike(const OptionTable &searchObj) override;
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                            const int batchSize = 4096) override;
+    // Can be called without open database connection. (Reads the whole table)
+    QList<QVariantMap> allPersistedAccounts() override;
+    // User management
+    QVariantMap findUser(const OptionTable &userInfo) override;
+    // Error messages
+    QString error() const override             { return m_errorMsg; }
+    bool hasError() const override             { return !m_errorMsg.isEmpty(); }
+    // Translation
+    QString optionToRealName(const char option) const override;
+
+protected:
+    // Transactions
+    bool executeBegin() override;
+    bool executeCommit() override;
+    bool executeRollback() override;
+
+private:
+    // Column names with values.
+    typedef QList<QPair<QString, QVariant>> ColumnList;
+
+    // Text values of statement parameters. A QByteArray keeps its data when
+    // the vector grows, so the pointers stay valid.
+    class Parameters
+    {
+    public:
+        void append(const QVariant& value);
+        void append(const ColumnList& columnList);
+        int count() const                           { return m_pointerList.size(); }
+        const char* const* values() const           { return m_pointerList.constData(); }
+
+    private:
+        QVector<QByteArray> m_valueList;
+        QVector<const char*> m_pointerList;
+    };
+
+    PGconn* m_pConnection;
+    QString m_tableName;
+    QString m_errorMsg;
+    // Names and type oids of the columns of each table.
+    QHash<QString, ColumnList> m_columnTypeTable;
+    static const int m_batchSize = 256;
+
+    // Columns
+    ColumnList columnsFromOptionTable(const OptionTable& optionTable) const;
+    ColumnList columnsWithIdentifier(const OptionTable& optionTable) const;
+    ColumnList columnsWithoutIdentifier(OptionTable optionTable) const;
+    ColumnList columnsWithValues(const OptionTable& optionTable) const;
+    // Statements
+    QByteArray sqlSelect(const QString& tableName, const ColumnList& columns, const ColumnList& conditions) const;
+    QByteArray sqlSelectList(const QString& tableName, const ColumnList& columns) const;
+    QByteArray sqlNameList(const ColumnList& columns) const;
+    QByteArray sqlConditionList(const ColumnList& columns, const char* separator, int& parameter) const;
+    PGresult* execute(const QByteArray& sqlStatement, const Parameters& parameters);
+    bool executeCommand(const QByteArray& sqlStatement);
+    bool loadColumnTypes(const QString& tableName);
+    int modifyInPipeline(const QList<OptionTable>& modificationList, const QByteArray& sqlUpdate,
+                         const ColumnList& templateColumns);
+    int modifyInTransaction(const QList<OptionTable>& modificationList, const QByteArray& sqlUpdate,
+                            const ColumnList& templateColumns);
+    Parameters modificationParameters(const OptionTable& modifications, const ColumnList& templateColumns) const;
+    // Results
+    QVariantMap accountObject(const PGresult* pResult, const int row) const;
+    QVariant binaryValue(const PGresult* pResult, const int row, const int column) const;
+    static bool isDecoded(const uint typeOid);
+    // Error messages
+    void setErrorDatabaseConectionFailed();
+    void setErrorExecutionFailed(const PGresult* pResult);
+};
+
+#endif // POSTGRESQLNATIVE_H
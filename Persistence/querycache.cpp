@@ -0,0 +1,337 @@
+#include "querycache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+
+/**
+ * Constructor
+ * Takes the ownership of the server persistence.
+ * @param pServer           Persistence which gets all writes.
+ * @param directory         Directory of the cache files. It is created if needed.
+ */
+QueryCache::QueryCache(Persistence *pServer, const QString &directory) :
+    PersistenceProxy(pServer),
+    m_directory(directory),
+    m_isProbed(false)
+{
+
+}
+
+// Override
+bool QueryCache::persistAccountObject(const OptionTable &account)
+{
+    m_isProbed = false;
+    return PersistenceProxy::persistAccountObject(account);
+}
+
+// Override
+int QueryCache::deleteAccountObject(const OptionTable &account)
+{
+    m_isProbed = false;
+    return PersistenceProxy::deleteAccountObject(account);
+}
+
+// Override
+bool QueryCache::modifyAccountObject(const OptionTable &modifications)
+{
+    m_isProbed = false;
+    return PersistenceProxy::modifyAccountObject(modifications);
+}
+
+// Override
+int QueryCache::modifyAccountObjects(const QList<OptionTable> &modificationList)
+{
+    m_isProbed = false;
+    return PersistenceProxy::modifyAccountObjects(modificationList);
+}
+
+// Override
+int QueryCache::deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                    const int maxRows, const bool isDryRun)
+{
+    m_isProbed = m_isProbed && isDryRun;
+    return PersistenceProxy::deleteAccountsWhere(searchObj, filter, maxRows, isDryRun);
+}
+
+// Override
+int QueryCache::modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                                    const int maxRows, const bool isDryRun)
+{
+    m_isProbed = m_isProbed && isDryRun;
+    return PersistenceProxy::modifyAccountsWhere(modifications, filter, maxRows, isDryRun);
+}
+
+// Override
+Persistence::UpsertResult QueryCache::upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList)
+{
+    m_isProbed = false;
+    return PersistenceProxy::upsertAccountObject(account, insertOnlyList);
+}
+
+/**
+ * The result is keyed by the options and their values. (E.g. the
+ * provider list of 'find')
+ * @param searchObj
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool QueryCache::streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                                    const int batchSize)
+{
+    QString queryKey = QString("like\n").append(optionKey(searchObj));
+
+    return cachedStream(queryKey, searchObj, FilterExpression(), [&](const AccountBatchVisitor& fetchVisitor) {
+        return PersistenceProxy::streamAccountsLike(searchObj, fetchVisitor, batchSize);
+    }, visitor, batchSize);
+}
+
+/**
+ * The result is keyed by the options, the text of the filter and the
+ * page. (E.g. 'show -a')
+ * @param searchObj
+ * @param filter
+ * @param page
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool QueryCache::streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                                     const AccountPage &page, const AccountBatchVisitor &visitor,
+                                     const int batchSize)
+{
+    QStringList keyList;
+    keyList << QString("where") << optionKey(searchObj) << filter.text() << page.orderBy
+            << QString::number(page.limit) << page.afterValue.toString() << page.afterId.toString();
+
+    return cachedStream(keyList.join('\n'), searchObj, filter, [&](const AccountBatchVisitor& fetchVisitor) {
+        return PersistenceProxy::streamAccountsWhere(searchObj, filter, page, fetchVisitor, batchSize);
+    }, visitor, batchSize);
+}
+
+/**
+ * Private
+ * Serves a read from its cache file if the stamp of the file is the stamp
+ * of the server. Otherwise the rows are fetched, handed to the visitor
+ * and written into the cache file.
+ * @param queryKey          Tells the reads of a user apart. The key of the
+ *                          file adds the store and the user.
+ * @param searchObj
+ * @param filter
+ * @param fetch             Reads the rows from the server.
+ * @param visitor           Takes each batch. Returns false to stop.
+ * @param batchSize         Maximum number of Account objects in a batch.
+ * @return                  True if all rows were read or the visitor stopped.
+ */
+bool QueryCache::cachedStream(const QString &queryKey, const OptionTable &searchObj, const FilterExpression &filter,
+                              const AccountFetch &fetch, const AccountBatchVisitor &visitor, const int batchSize)
+{
+    if (! isCacheable(searchObj, filter)) {
+        return fetch(visitor);
+    }
+    QString stamp = currentStamp(searchObj);
+    if (stamp.isEmpty()) {
+        return fetch(visitor);
+    }
+    QString key = QStringList({ storeKey(), userKey(searchObj), queryKey }).join('\n');
+    QList<QVariantMap> accountList;
+    if (readEntry(key, stamp, accountList)) {
+        for (int first=0; first<accountList.size(); first+=batchSize) {
+            if (! visitor(accountList.mid(first, batchSize))) {
+                break;
+            }
+        }
+        return true;
+    }
+    // The stamp is probed before the fetch. A change during the fetch
+    // makes the file outdated, never the other way round.
+    bool isComplete = true;
+    bool isDone = fetch([&](const QList<QVariantMap>& batch) {
+        if (isComplete) {
+            accountList << batch;
+            if (accountList.size() > m_maxRows) {
+                isComplete = false;
+                accountList.clear();
+            }
+        }
+        if (! visitor(batch)) {
+            isComplete = false;
+            return false;
+        }
+        return true;
+    });
+    if (isDone && isComplete && ! hasError()) {
+        writeEntry(key, stamp, accountList);
+    }
+
+    return isDone;
+}
+
+/**
+ * Private
+ * A read is cacheable outside of a transaction if neither its options
+ * nor its filter use a password or an answer.
+ * @param searchObj
+ * @param filter
+ * @return
+ */
+bool QueryCache::isCacheable(const OptionTable &searchObj, const FilterExpression &filter) const
+{
+    if (isInTransaction()) {
+        return false;
+    }
+    QStringList filterColumnList = filter.columnNames();
+    const char secretOptionList[] = { 'k', 'r' };
+    for (const char option : secretOptionList) {
+        if (searchObj.contains(option) || filterColumnList.contains(optionToRealName(option))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * The change stamp of the user. It is probed once per run and again
+ * after a write or for another user.
+ * @param searchObj         Option table with the user ('U').
+ * @return                  The stamp. Or an empty string without change tracking.
+ */
+QString QueryCache::currentStamp(const OptionTable &searchObj)
+{
+    QString currentUserKey = userKey(searchObj);
+    if (! m_isProbed || m_stampUserKey != currentUserKey) {
+        OptionTable userObj;
+        userObj.insert('U', searchObj.value('U'));
+        m_stamp = server()->changeStamp(userObj);
+        m_stampUserKey = currentUserKey;
+        m_isProbed = true;
+    }
+
+    return m_stamp;
+}
+
+/**
+ * Private
+ * The options of a read and their values in the order of the options.
+ * A selected option without value is marked with '*'.
+ * @param searchObj
+ * @return
+ */
+QString QueryCache::optionKey(const OptionTable &searchObj) const
+{
+    QList<char> optionList = searchObj.keys();
+    std::sort(optionList.begin(), optionList.end());
+    QStringList keyList;
+    for (const char option : optionList) {
+        QVariant value = searchObj.value(option);
+        keyList << QString(QChar(option)).append('=').append(value.isValid() ? value.toString() : QString("*"));
+    }
+
+    return keyList.join(';');
+}
+
+/**
+ * Private
+ * The path of the cache file of a key. The file name is the hash of the
+ * key. The key is stored in the file as well.
+ * @param key
+ * @return
+ */
+QString QueryCache::entryPath(const QString &key) const
+{
+    QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256).toHex();
+
+    return QDir(m_directory).filePath(QString::fromLatin1(hash).append(".cache"));
+}
+
+/**
+ * Private
+ * Reads the rows of a cache file. The file must have the key and the
+ * stamp.
+ * @param key
+ * @param stamp
+ * @param accountList       Takes the rows.
+ * @return                  False if there is no valid file.
+ */
+bool QueryCache::readEntry(const QString &key, const QString &stamp, QList<QVariantMap> &accountList) const
+{
+    QFile file(entryPath(key));
+    if (! file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream inStream(&file);
+    QVariantMap header;
+    inStream >> header;
+    if (header.value("cache").toInt() != m_version || header.value("key").toString() != key
+            || header.value("stamp").toString() != stamp) {
+        return false;
+    }
+    int count = header.value("count").toInt();
+    accountList.reserve(count);
+    for (int index=0; index<count && inStream.status()==QDataStream::Ok; ++index) {
+        QVariantMap account;
+        inStream >> account;
+        accountList << account;
+    }
+    if (inStream.status() != QDataStream::Ok) {
+        accountList.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Writes the rows into a cache file. The file is replaced at once, so a
+ * concurrent run reads the old or the new file. A cache which can not be
+ * written is no error; the rows are fetched again.
+ * @param key
+ * @param stamp
+ * @param accountList
+ */
+void QueryCache::writeEntry(const QString &key, const QString &stamp, const QList<QVariantMap> &accountList)
+{
+    QDir directory(m_directory);
+    if (! directory.exists()) {
+        if (! directory.mkpath(QString("."))) {
+            return;
+        }
+        QFile::setPermissions(m_directory, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+    }
+    QSaveFile file(entryPath(key));
+    if (! file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    QVariantMap header;
+    header.insert("cache", m_version);
+    header.insert("key", key);
+    header.insert("stamp", stamp);
+    header.insert("count", accountList.size());
+    QDataStream outStream(&file);
+    outStream << header;
+    for (const QVariantMap& account : accountList) {
+        outStream << account;
+    }
+    if (outStream.status() == QDataStream::Ok && file.commit()) {
+        pruneEntries();
+    }
+}
+
+/**
+ * Private
+ * Removes all but the newest cache files.
+ */
+void QueryCache::pruneEntries() const
+{
+    QFileInfoList fileList = QDir(m_directory).entryInfoList(QStringList() << QString("*.cache"), QDir::Files, QDir::Time);
+    for (int index=m_maxEntries; index<fileList.size(); ++index) {
+        QFile::remove(fileList[index].filePath());
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+/* ------------------------------------------------------------------------------
+ * Class QueryCache
+ *
+ * Keeps the results of recent reads of Account objects in files, so a run
+ * which repeats the read of a former run does not fetch the rows again.
+ * Each result is keyed by the store (see Persistence::storeKey()), the user
+ * and the read. It is stored with the change stamp of the user (see
+ * Persistence::changeStamp()) and served as long as the server has the same
+ * stamp. The stamp is probed once per run and again after a write.
+ * - Results with passwords or answers are not cached, neither are reads
+ *   which search or filter by them. So the files hold no secrets. Only the
+ *   owner may read them.
+ * - Reads within a transaction, results with more than a maximum number of
+ *   rows and reads stopped by the visitor are not cached.
+ * - The newest files are kept, the others are removed.
+ * The cache is chosen with environment variable PWMANAGER_CACHE=<directory>.
+ * ------------------------------------------------------------------------------
+ */
+
+#include "persistenceproxy.h"
+#include <functional>
+
+class QueryCache : public PersistenceProxy
+{
+public:
+    QueryCache(Persistence* pServer, const QString& directory);
+
+    // Persistence interface
+public:
+    // Writes go to the server. The stamp is probed again.
+    bool persistAccountObject(const OptionTable &account) override;
+    int deleteAccountObject(const OptionTable &account) override;
+    bool modifyAccountObject(const OptionTable &modifications) override;
+    int modifyAccountObjects(const QList<OptionTable> &modificationList) override;
+    int deleteAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    int modifyAccountsWhere(const OptionTable &modifications, const FilterExpression &filter,
+                            const int maxRows, const bool isDryRun) override;
+    UpsertResult upsertAccountObject(const OptionTable &account, const QList<char> &insertOnlyList) override;
+    // Reads are served by the cache.
+    bool streamAccountsLike(const OptionTable &searchObj, const AccountBatchVisitor &visitor,
+                            const int batchSize = 4096) override;
+    bool streamAccountsWhere(const OptionTable &searchObj, const FilterExpression &filter,
+                             const AccountPage &page, const AccountBatchVisitor &visitor,
+                             const int batchSize = 4096) override;
+
+private:
+    // Reads the rows from the server and hands them to a visitor.
+    typedef std::function<bool(const AccountBatchVisitor& visitor)> AccountFetch;
+
+    QString m_directory;
+    QString m_stamp;
+    QString m_stampUserKey;
+    bool m_isProbed;
+    static const int m_version = 1;
+    static const int m_maxRows = 10000;
+    static const int m_maxEntries = 64;
+
+    bool cachedStream(const QString& queryKey, const OptionTable& searchObj, const FilterExpression& filter,
+                      const AccountFetch& fetch, const AccountBatchVisitor& visitor, const int batchSize);
+    bool isCacheable(const OptionTable& searchObj, const FilterExpression& filter) const;
+    QString currentStamp(const OptionTable& searchObj);
+    QString optionKey(const OptionTable& searchObj) const;
+    // Files
+    QString entryPath(const QString& key) const;
+    bool readEntry(const QString& key, const QString& stamp, QList<QVariantMap>& accountList) const;
+    void writeEntry(const QString& key, const QString& stamp, const QList<QVariantMap>& accountList);
+    void pruneEntries() const;
+};
+
+#endif // QUERYCACHE_H
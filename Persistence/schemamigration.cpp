@@ -0,0 +1,273 @@
+#include "schemamigration.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+// The migrations in order of version. An optional migration is applied
+// only with a number of partitions.
+const SchemaMigration::Migration SchemaMigration::m_migrationList[] = {
+    { 1, "create_user", false },
+    { 2, "account_userid", false },
+    { 3, "access_indexes", false },
+    { 4, "partition_account", true },
+    { 5, "account_tombstone", false },
+    { 6, "account_counter", false }
+};
+
+// The statements of the application. Values do not matter for EXPLAIN.
+const SchemaMigration::AccessPattern SchemaMigration::m_accessPatternList[] = {
+    { "account by id", "SELECT * FROM ${account} WHERE userid = 1 AND id = 1" },
+    { "account by provider and username",
+      "SELECT * FROM ${account} WHERE userid = 1 AND provider = 'provider' AND username = 'username'" },
+    { "page of accounts", "SELECT * FROM ${account} WHERE userid = 1 AND id > 1 ORDER BY id LIMIT 100" },
+    { "stale accounts", "SELECT * FROM ${account} WHERE userid = 1 AND lastmodify < now() - interval '365 days'" },
+    { "accounts modified since", "SELECT id FROM ${account} WHERE lastmodify > now() - interval '1 day'" },
+    { "accounts changed since", "SELECT * FROM ${account} WHERE userid = 1 AND changexid >= '1'::xid8" },
+    { "tombstones since", "SELECT id FROM ${account}_tombstone WHERE userid = 1 AND deletexid >= '1'::xid8" },
+    { "user by name", "SELECT id FROM public.user WHERE name = 'name'" }
+};
+
+/**
+ * Constructor
+ * @param connectionName    Name of an open QSqlDatabase connection.
+ * @param tableName         Name of the account table.
+ */
+SchemaMigration::SchemaMigration(const QString &connectionName, const QString &tableName) :
+    m_connectionName(connectionName),
+    m_tableName(tableName)
+{
+
+}
+
+/**
+ * Applies all migrations which are not applied yet. Each migration is
+ * applied in its own transaction. It stops at the first failing one.
+ * @param isDryRun          Only report the pending migrations.
+ * @param partitionCount    Number of hash partitions of the account table.
+ *                          0 skips the partitioning.
+ * @param reportList        Takes a line for each pending migration.
+ * @return                  False on error.
+ */
+bool SchemaMigration::migrate(const bool isDryRun, const int partitionCount, QStringList &reportList)
+{
+    if (! createVersionTable()) {
+        return false;
+    }
+    QList<int> versionList;
+    if (! appliedVersions(versionList)) {
+        return false;
+    }
+    for (const Migration& migration : m_migrationList) {
+        if (versionList.contains(migration.version)) {
+            continue;
+        }
+        QString line = QString("%1 %2").arg(migration.version, 3, 10, QChar('0')).arg(migration.name);
+        if (migration.isOptional && partitionCount <= 0) {
+            if (isDryRun) {
+                reportList << line.append(" skipped (optional)\n");
+            }
+            continue;
+        }
+        if (isDryRun) {
+            reportList << line.append(" pending\n");
+            continue;
+        }
+        if (! apply(migration, partitionCount)) {
+            reportList << line.append(" failed\n");
+            return false;
+        }
+        reportList << line.append(" applied\n");
+    }
+
+    return true;
+}
+
+/**
+ * Runs EXPLAIN for each access pattern of the application. A pattern is
+ * served if its plan uses an index and has no sequential scan.
+ * @param reportList        Takes a line for each access pattern.
+ * @return                  False on error or if a pattern is not served.
+ */
+bool SchemaMigration::verify(QStringList &reportList)
+{
+    static const QRegularExpression indexScan("(?:Index Scan|Index Only Scan) using (\\S+)|Bitmap Index Scan on (\\S+)");
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName);
+    if (! db.transaction()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+    QSqlQuery query(db);
+    if (! query.exec(QString("SET LOCAL enable_seqscan = off"))) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        db.rollback();
+        return false;
+    }
+    bool isAllServed = true;
+    for (const AccessPattern& pattern : m_accessPatternList) {
+        if (! query.exec(QString("EXPLAIN ").append(substitute(pattern.sqlSelect, 0)))) {
+            setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+            db.rollback();
+            return false;
+        }
+        QStringList indexList;
+        bool hasSeqScan = false;
+        while (query.next()) {
+            QString planLine = query.value(0).toString();
+            hasSeqScan = hasSeqScan || planLine.contains(QString("Seq Scan"));
+            QRegularExpressionMatch match = indexScan.match(planLine);
+            if (match.hasMatch()) {
+                QString name = match.captured(1).isEmpty() ? match.captured(2) : match.captured(1);
+                if (! indexList.contains(name)) {
+                    indexList << name;
+                }
+            }
+        }
+        bool isServed = ! hasSeqScan && ! indexList.isEmpty();
+        isAllServed = isAllServed && isServed;
+        reportList << QString("%1 %2: %3\n").arg(isServed ? QString("ok  ") : QString("FAIL"), pattern.description,
+                                                 isServed ? indexList.join(", ") : QString("sequential scan"));
+    }
+    db.rollback();
+
+    return isAllServed;
+}
+
+/**
+ * Private
+ * Creates the table of applied versions if it does not exist.
+ * @return
+ */
+bool SchemaMigration::createVersionTable()
+{
+    QSqlQuery query(QSqlDatabase::database(m_connectionName));
+    if (! query.exec(QString("CREATE TABLE IF NOT EXISTS schema_migration ("
+                             "version INTEGER PRIMARY KEY, "
+                             "name TEXT NOT NULL, "
+                             "appliedat TIMESTAMP NOT NULL DEFAULT now())"))) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Reads the applied versions.
+ * @param versionList       Takes the versions.
+ * @return
+ */
+bool SchemaMigration::appliedVersions(QList<int> &versionList)
+{
+    QSqlQuery query(QSqlDatabase::database(m_connectionName));
+    if (! query.exec(QString("SELECT version FROM schema_migration"))) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        return false;
+    }
+    while (query.next()) {
+        versionList << query.value(0).toInt();
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Applies a migration and records its version in one transaction. Another
+ * runner may have applied it while this one waited for the lock. Then it
+ * is not applied again.
+ * @param migration
+ * @param partitionCount
+ * @return
+ */
+bool SchemaMigration::apply(const Migration &migration, const int partitionCount)
+{
+    QString sqlScript = script(migration, partitionCount);
+    if (sqlScript.isEmpty()) {
+        return false;
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName);
+    if (! db.transaction()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+    QSqlQuery query(db);
+    bool isDone = query.exec(QString("SELECT pg_advisory_xact_lock(%1)").arg(m_lockKey));
+    if (isDone) {
+        isDone = query.prepare(QString("SELECT 1 FROM schema_migration WHERE version = ?"));
+        query.addBindValue(migration.version);
+        isDone = isDone && query.exec();
+    }
+    if (isDone && query.next()) {
+        return db.commit();
+    }
+    if (isDone) {
+        isDone = query.exec(sqlScript);
+    }
+    if (isDone) {
+        isDone = query.prepare(QString("INSERT INTO schema_migration (version, name) VALUES (?, ?)"));
+        query.addBindValue(migration.version);
+        query.addBindValue(QString(migration.name));
+        isDone = isDone && query.exec();
+    }
+    if (! isDone) {
+        setErrorExecutionFailed(query.lastError().databaseText(), query.lastError().driverText());
+        db.rollback();
+        return false;
+    }
+    if (! db.commit()) {
+        setErrorExecutionFailed(db.lastError().databaseText(), db.lastError().driverText());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Reads the script of a migration from the resources.
+ * @param migration
+ * @param partitionCount
+ * @return                  The script. Or an empty string on error.
+ */
+QString SchemaMigration::script(const Migration &migration, const int partitionCount)
+{
+    QString path = QString(":/migrations/%1_%2.sql").arg(migration.version, 3, 10, QChar('0')).arg(migration.name);
+    QFile file(path);
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_error.append(QString("Could not read migration '%1' !\n").arg(path));
+        return QString();
+    }
+
+    return substitute(QString::fromUtf8(file.readAll()), partitionCount);
+}
+
+/**
+ * Private
+ * Replaces the placeholders of a script.
+ * @param sql
+ * @param partitionCount
+ * @return
+ */
+QString SchemaMigration::substitute(QString sql, const int partitionCount) const
+{
+    sql.replace(QString("${account}"), m_tableName);
+    sql.replace(QString("${partitions}"), QString::number(partitionCount));
+
+    return sql;
+}
+
+/**
+ * Private
+ * Set an error message when a statement fails.
+ * @param database      The error message of the database object.
+ * @param driver        The error message of the QSqlDriver object.
+ */
+void SchemaMigration::setErrorExecutionFailed(const QString &database, const QString &driver)
+{
+    m_error.append(QString("Migration of database schema failed !\n"));
+    m_error.append(database).append('\n');
+    m_error.append(driver).append('\n');
+}
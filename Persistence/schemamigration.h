@@ -0,0 +1,68 @@
+#ifndef SCHEMAMIGRATION_H
+#define SCHEMAMIGRATION_H
+
+/* -----------------------------------------------------------------------
+ * Class SchemaMigration
+ * -----------------------------------------------------------------------
+ * Brings the PostgreSQL schema of the password manager up to date. The
+ * migrations are SQL scripts compiled into the application (resource
+ * prefix ':/migrations', see PostgreSql/migrations.qrc). Each of them has
+ * a version. Applied versions are recorded in table 'schema_migration'.
+ *
+ * A migration runs in its own transaction together with its record. A
+ * transaction level advisory lock keeps two runners from applying the
+ * same migration. Optional migrations are applied only on request. So
+ * the applied versions may have gaps.
+ *
+ * In the scripts '${account}' is replaced by the account table name of
+ * the credentials file and '${partitions}' by the number of partitions.
+ *
+ * verify() runs EXPLAIN for the statements of the application and reports
+ * if an index can serve them. Sequential scans are disabled for EXPLAIN,
+ * so the result does not depend on the size of the tables.
+ */
+
+#include <QStringList>
+
+class SchemaMigration
+{
+public:
+    SchemaMigration(const QString& connectionName, const QString& tableName);
+
+    bool migrate(const bool isDryRun, const int partitionCount, QStringList& reportList);
+    bool verify(QStringList& reportList);
+
+    // Error messages
+    QString error() const                               { return m_error; }
+    bool hasError() const                               { return ! m_error.isEmpty(); }
+
+private:
+    struct Migration
+    {
+        int version;
+        const char* name;
+        bool isOptional;
+    };
+
+    struct AccessPattern
+    {
+        const char* description;
+        const char* sqlSelect;
+    };
+
+    QString m_connectionName;
+    QString m_tableName;
+    QString m_error;
+    static const Migration m_migrationList[];
+    static const AccessPattern m_accessPatternList[];
+    static const qint64 m_lockKey = 0x70776d616e61; // "pwmana"
+
+    bool createVersionTable();
+    bool appliedVersions(QList<int>& versionList);
+    bool apply(const Migration& migration, const int partitionCount);
+    QString script(const Migration& migration, const int partitionCount);
+    QString substitute(QString sql, const int partitionCount) const;
+    void setErrorExecutionFailed(const QString& database, const QString& driver);
+};
+
+#endif // SCHEMAMIGRATION_H
@@ -0,0 +1,53 @@
+#include "transactionguard.h"
+#include "persistence.h"
+
+/**
+ * Constructor
+ * Begins a transaction.
+ * @param pPersistence
+ */
+TransactionGuard::TransactionGuard(Persistence *pPersistence) :
+    m_pPersistence(pPersistence),
+    m_isActive(pPersistence->beginTransaction())
+{
+
+}
+
+/**
+ * Destructor
+ * Rolls back the transaction if it was not ended.
+ */
+TransactionGuard::~TransactionGuard()
+{
+    if (m_isActive) {
+        m_pPersistence->rollbackTransaction();
+    }
+}
+
+/**
+ * Commits the transaction.
+ * @return              True if committed or if the persistence has no transactions.
+ */
+bool TransactionGuard::commit()
+{
+    if (! m_isActive) {
+        return true;
+    }
+    m_isActive = false;
+
+    return m_pPersistence->commitTransaction();
+}
+
+/**
+ * Rolls back the transaction.
+ * @return              False if there was no transaction.
+ */
+bool TransactionGuard::rollback()
+{
+    if (! m_isActive) {
+        return false;
+    }
+    m_isActive = false;
+
+    return m_pPersistence->rollbackTransaction();
+}
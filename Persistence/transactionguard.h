@@ -0,0 +1,37 @@
+#ifndef TRANSACTIONGUARD_H
+#define TRANSACTIONGUARD_H
+
+/* -----------------------------------------------------------------------
+ * Class TransactionGuard
+ * -----------------------------------------------------------------------
+ * Scoped transaction of a persistence. The constructor begins it and the
+ * destructor rolls it back unless it was committed. So every return path
+ * of a function ends the transaction. Guards can be nested like the
+ * transactions of Persistence.
+ *
+ * A persistence without transactions writes at once. Then the guard is
+ * not active and commit() just returns true.
+ */
+
+#include <QtGlobal>
+
+class Persistence;
+
+class TransactionGuard
+{
+public:
+    explicit TransactionGuard(Persistence* pPersistence);
+    ~TransactionGuard();
+
+    bool isActive() const                           { return m_isActive; }
+    bool commit();
+    bool rollback();
+
+private:
+    Persistence* m_pPersistence;
+    bool m_isActive;
+
+    Q_DISABLE_COPY(TransactionGuard)
+};
+
+#endif // TRANSACTIONGUARD_H
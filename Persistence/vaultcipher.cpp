@@ -0,0 +1,430 @@
+#include "vaultcipher.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtConcurrent>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+static const char VaultMagic[] = "PWMV";
+static const quint16 VaultVersion = 1;
+static const int HeaderLength = 4 + 2 + 4 + 4 + VaultCipher::SaltLength + VaultCipher::NoncePrefixLength + 4;
+static const int ChunkEntryLength = 3 * 4;
+
+/**
+ * Constructor
+ * @param passphrase        The passphrase to derive the key from.
+ * @param chunkSize         Maximum size of plain text in one chunk.
+ */
+VaultCipher::VaultCipher(const QString &passphrase, const int chunkSize) :
+    m_passphrase(passphrase),
+    m_chunkSize(chunkSize)
+{
+
+}
+
+/**
+ * Writes all Account objects encrypted into a file. An existing file is
+ * replaced only if the whole vault was written. The chunks are sealed in
+ * parallel on the global thread pool.
+ * @param filePath          Path of the vault file.
+ * @param accountList       The Account objects to store.
+ * @return                  True if the vault was written.
+ */
+bool VaultCipher::writeVault(const QString &filePath, const QList<QVariantMap> &accountList)
+{
+    QByteArray salt(SaltLength, 0);
+    QByteArray noncePrefix(NoncePrefixLength, 0);
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(salt.data()), SaltLength) != 1 ||
+        RAND_bytes(reinterpret_cast<unsigned char*>(noncePrefix.data()), NoncePrefixLength) != 1) {
+        m_error.append(QString("Could not get random bytes for the vault !\n"));
+        return false;
+    }
+    if (! deriveKey(salt, Iterations)) {
+        return false;
+    }
+    struct SealJob {
+        int chunk;
+        QByteArray data;
+    };
+    QVector<QByteArray> plainChunks = packRecords(accountList);
+    QVector<SealJob> jobList(plainChunks.size());
+    for (int index=0; index<plainChunks.size(); ++index) {
+        jobList[index].chunk = index;
+        jobList[index].data = plainChunks[index];
+    }
+    plainChunks.clear();
+
+    m_header.clear();
+    QDataStream headerStream(&m_header, QIODevice::WriteOnly);
+    headerStream.writeRawData(VaultMagic, 4);
+    headerStream << VaultVersion << static_cast<quint32>(m_chunkSize) << static_cast<quint32>(Iterations);
+    headerStream.writeRawData(salt.constData(), SaltLength);
+    headerStream.writeRawData(noncePrefix.constData(), NoncePrefixLength);
+    headerStream << static_cast<quint32>(m_chunkTable.size());
+
+    QtConcurrent::blockingMap(jobList, [this](SealJob& job) {
+        job.data = seal(job.chunk, job.data);
+    });
+
+    QSaveFile file(filePath);
+    if (! file.open(QIODevice::WriteOnly)) {
+        m_error.append(QString("Could not open file !\n"));
+        m_error.append(file.errorString()).append('\n');
+        return false;
+    }
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    QDataStream outStream(&file);
+    outStream.writeRawData(m_header.constData(), m_header.size());
+    for (const ChunkEntry& entry : m_chunkTable) {
+        outStream << entry.firstRecord << entry.recordCount << entry.sealedLength;
+    }
+    for (const SealJob& job : jobList) {
+        if (job.data.isEmpty()) {
+            m_error.append(QString("Could not encrypt vault chunk %1 !\n").arg(job.chunk));
+            file.cancelWriting();
+            return false;
+        }
+        outStream.writeRawData(job.data.constData(), job.data.size());
+    }
+    if (outStream.status() != QDataStream::Ok || ! file.commit()) {
+        m_error.append(QString("Could not write vault file !\n"));
+        m_error.append(file.errorString()).append('\n');
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Reads all Account objects from a vault file. The chunks are decrypted in
+ * parallel on the global thread pool.
+ * @param filePath          Path of the vault file.
+ * @return accountList      All Account objects or an empty list on error.
+ */
+QList<QVariantMap> VaultCipher::readVault(const QString &filePath)
+{
+    QFile file(filePath);
+    if (! file.open(QIODevice::ReadOnly)) {
+        m_error.append(QString("Could not open file !\n"));
+        m_error.append(file.errorString()).append('\n');
+        return QList<QVariantMap>();
+    }
+    if (! readHeader(file)) {
+        return QList<QVariantMap>();
+    }
+    struct OpenJob {
+        int chunk;
+        QByteArray sealed;
+        QList<QVariantMap> accountList;
+        bool isOpen;
+    };
+    QVector<OpenJob> jobList(m_chunkTable.size());
+    for (int index=0; index<m_chunkTable.size(); ++index) {
+        jobList[index].chunk = index;
+        jobList[index].sealed = file.read(m_chunkTable[index].sealedLength);
+        jobList[index].isOpen = false;
+    }
+    file.close();
+
+    QtConcurrent::blockingMap(jobList, [this](OpenJob& job) {
+        QByteArray plain = open(job.chunk, job.sealed);
+        job.sealed.clear();
+        if (! plain.isEmpty()) {
+            job.accountList = unpackRecords(plain);
+            job.isOpen = true;
+        }
+    });
+
+    QList<QVariantMap> accountList;
+    for (const OpenJob& job : jobList) {
+        if (! job.isOpen) {
+            m_error.append(QString("Vault chunk %1 could not be decrypted !\n").arg(job.chunk));
+            m_error.append(QString("Wrong passphrase or the file is corrupt.\n"));
+            return QList<QVariantMap>();
+        }
+        accountList << job.accountList;
+    }
+
+    return accountList;
+}
+
+/**
+ * Reads a single Account object from a vault file. Only the chunk which
+ * holds the record is read and decrypted.
+ * @param filePath          Path of the vault file.
+ * @param recordIndex       Position of the record in the vault. Starts with 0.
+ * @return account          The Account object or an empty map on error.
+ */
+QVariantMap VaultCipher::readRecord(const QString &filePath, const int recordIndex)
+{
+    QFile file(filePath);
+    if (! file.open(QIODevice::ReadOnly)) {
+        m_error.append(QString("Could not open file !\n"));
+        m_error.append(file.errorString()).append('\n');
+        return QVariantMap();
+    }
+    if (! readHeader(file)) {
+        return QVariantMap();
+    }
+    qint64 offset = file.pos();
+    for (int chunk=0; chunk<m_chunkTable.size(); ++chunk) {
+        const ChunkEntry& entry = m_chunkTable[chunk];
+        if (recordIndex < 0 || static_cast<quint32>(recordIndex) >= entry.firstRecord + entry.recordCount) {
+            offset += entry.sealedLength;
+            continue;
+        }
+        file.seek(offset);
+        QByteArray plain = open(chunk, file.read(entry.sealedLength));
+        if (plain.isEmpty()) {
+            m_error.append(QString("Vault chunk %1 could not be decrypted !\n").arg(chunk));
+            m_error.append(QString("Wrong passphrase or the file is corrupt.\n"));
+            return QVariantMap();
+        }
+        QList<QVariantMap> accountList = unpackRecords(plain);
+
+        return accountList.value(recordIndex - static_cast<int>(entry.firstRecord));
+    }
+    m_error.append(QString("There is no record %1 in the vault !\n").arg(recordIndex));
+
+    return QVariantMap();
+}
+
+/**
+ * Private
+ * Serializes the Account objects and packs them into chunks. A chunk is
+ * filled up to the chunk size. Only a single record which is greater than
+ * the chunk size makes a greater chunk. Builds the chunk table as well.
+ * @param accountList
+ * @return chunkList        The plain text of each chunk.
+ */
+QVector<QByteArray> VaultCipher::packRecords(const QList<QVariantMap> &accountList)
+{
+    QVector<QByteArray> chunkList;
+    m_chunkTable.clear();
+    QByteArray chunk;
+    ChunkEntry entry = { 0, 0, 0 };
+    for (int index=0; index<accountList.size(); ++index) {
+        QByteArray record;
+        QDataStream recordStream(&record, QIODevice::WriteOnly);
+        recordStream.setVersion(QDataStream::Qt_5_12);
+        recordStream << accountList[index];
+        if (! chunk.isEmpty() && chunk.size() + record.size() > m_chunkSize) {
+            entry.sealedLength = static_cast<quint32>(chunk.size() + TagLength);
+            m_chunkTable << entry;
+            chunkList << chunk;
+            chunk.clear();
+            entry.firstRecord = static_cast<quint32>(index);
+            entry.recordCount = 0;
+        }
+        chunk.append(record);
+        ++entry.recordCount;
+    }
+    if (! chunk.isEmpty()) {
+        entry.sealedLength = static_cast<quint32>(chunk.size() + TagLength);
+        m_chunkTable << entry;
+        chunkList << chunk;
+    }
+
+    return chunkList;
+}
+
+/**
+ * Private
+ * Deserializes all Account objects of a decrypted chunk.
+ * @param plain
+ * @return accountList
+ */
+QList<QVariantMap> VaultCipher::unpackRecords(const QByteArray &plain) const
+{
+    QList<QVariantMap> accountList;
+    QDataStream inStream(plain);
+    inStream.setVersion(QDataStream::Qt_5_12);
+    while (! inStream.atEnd()) {
+        QVariantMap account;
+        inStream >> account;
+        accountList << account;
+    }
+
+    return accountList;
+}
+
+/**
+ * Private
+ * Reads and checks the header and the chunk table of a vault file. Derives
+ * the key from the passphrase and the salt of the file.
+ * @param device            The opened vault file.
+ * @return                  True if the header is valid.
+ */
+bool VaultCipher::readHeader(QIODevice &device)
+{
+    m_header = device.read(HeaderLength);
+    if (m_header.size() != HeaderLength || ! m_header.startsWith(VaultMagic)) {
+        m_error.append(QString("File is not a password vault !\n"));
+        return false;
+    }
+    QDataStream headerStream(m_header);
+    headerStream.skipRawData(4);
+    quint16 version;
+    quint32 chunkSize;
+    quint32 iterations;
+    quint32 chunkCount;
+    QByteArray salt(SaltLength, 0);
+    headerStream >> version >> chunkSize >> iterations;
+    headerStream.readRawData(salt.data(), SaltLength);
+    headerStream.skipRawData(NoncePrefixLength);
+    headerStream >> chunkCount;
+    if (version != VaultVersion) {
+        m_error.append(QString("Vault version %1 is not supported !\n").arg(version));
+        return false;
+    }
+    m_chunkSize = static_cast<int>(chunkSize);
+    // The chunk count is not authenticated yet. Each chunk takes a table
+    // entry and a tag at least, so the size of the file bounds it.
+    qint64 remainingLength = device.size() - device.pos();
+    if (static_cast<qint64>(chunkCount) * (ChunkEntryLength + TagLength) > remainingLength) {
+        m_error.append(QString("Chunk table of vault is corrupt !\n"));
+        return false;
+    }
+    QDataStream tableStream(device.read(static_cast<qint64>(chunkCount) * ChunkEntryLength));
+    m_chunkTable.resize(static_cast<int>(chunkCount));
+    qint64 sealedLength = 0;
+    for (ChunkEntry& entry : m_chunkTable) {
+        tableStream >> entry.firstRecord >> entry.recordCount >> entry.sealedLength;
+        sealedLength += entry.sealedLength;
+    }
+    if (tableStream.status() != QDataStream::Ok || sealedLength > device.size() - device.pos()) {
+        m_error.append(QString("Chunk table of vault is corrupt !\n"));
+        return false;
+    }
+
+    return deriveKey(salt, iterations);
+}
+
+/**
+ * Private
+ * Derives the AES key from the passphrase with PBKDF2-HMAC-SHA256.
+ * @param salt
+ * @param iterations
+ * @return                  True if done.
+ */
+bool VaultCipher::deriveKey(const QByteArray &salt, const quint32 iterations)
+{
+    QByteArray passphrase = m_passphrase.toUtf8();
+    m_key = QByteArray(KeyLength, 0);
+    int result = PKCS5_PBKDF2_HMAC(passphrase.constData(), passphrase.size(),
+                                   reinterpret_cast<const unsigned char*>(salt.constData()), salt.size(),
+                                   static_cast<int>(iterations), EVP_sha256(),
+                                   KeyLength, reinterpret_cast<unsigned char*>(m_key.data()));
+    if (result != 1) {
+        m_error.append(QString("Could not derive key from passphrase !\n"));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Encrypts one chunk with AES-256-GCM. Thread safe.
+ * @param chunk             Number of chunk.
+ * @param plain             Plain text of chunk.
+ * @return sealed           Cipher text and tag. Empty on error.
+ */
+QByteArray VaultCipher::seal(const int chunk, const QByteArray &plain) const
+{
+    QByteArray iv = nonce(chunk);
+    QByteArray aad = additionalData(chunk);
+    QByteArray sealed(plain.size() + TagLength, 0);
+    unsigned char* out = reinterpret_cast<unsigned char*>(sealed.data());
+    int length = 0;
+    bool isDone = false;
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    if (context != nullptr &&
+        EVP_EncryptInit_ex(context, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, iv.size(), nullptr) == 1 &&
+        EVP_EncryptInit_ex(context, nullptr, nullptr, reinterpret_cast<const unsigned char*>(m_key.constData()),
+                           reinterpret_cast<const unsigned char*>(iv.constData())) == 1 &&
+        EVP_EncryptUpdate(context, nullptr, &length, reinterpret_cast<const unsigned char*>(aad.constData()),
+                          aad.size()) == 1 &&
+        EVP_EncryptUpdate(context, out, &length, reinterpret_cast<const unsigned char*>(plain.constData()),
+                          plain.size()) == 1 &&
+        EVP_EncryptFinal_ex(context, out + length, &length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, TagLength, out + plain.size()) == 1) {
+        isDone = true;
+    }
+    EVP_CIPHER_CTX_free(context);
+
+    return isDone ? sealed : QByteArray();
+}
+
+/**
+ * Private
+ * Decrypts one chunk and verifies its tag. Thread safe.
+ * @param chunk             Number of chunk.
+ * @param sealed            Cipher text and tag.
+ * @return plain            Plain text of chunk. Empty if tag does not match.
+ */
+QByteArray VaultCipher::open(const int chunk, const QByteArray &sealed) const
+{
+    if (sealed.size() <= TagLength || static_cast<quint32>(sealed.size()) != m_chunkTable[chunk].sealedLength) {
+        return QByteArray();
+    }
+    QByteArray iv = nonce(chunk);
+    QByteArray aad = additionalData(chunk);
+    int plainLength = sealed.size() - TagLength;
+    QByteArray plain(plainLength, 0);
+    QByteArray tag = sealed.right(TagLength);
+    unsigned char* out = reinterpret_cast<unsigned char*>(plain.data());
+    int length = 0;
+    bool isDone = false;
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    if (context != nullptr &&
+        EVP_DecryptInit_ex(context, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, iv.size(), nullptr) == 1 &&
+        EVP_DecryptInit_ex(context, nullptr, nullptr, reinterpret_cast<const unsigned char*>(m_key.constData()),
+                           reinterpret_cast<const unsigned char*>(iv.constData())) == 1 &&
+        EVP_DecryptUpdate(context, nullptr, &length, reinterpret_cast<const unsigned char*>(aad.constData()),
+                          aad.size()) == 1 &&
+        EVP_DecryptUpdate(context, out, &length, reinterpret_cast<const unsigned char*>(sealed.constData()),
+                          plainLength) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, TagLength, tag.data()) == 1 &&
+        EVP_DecryptFinal_ex(context, out + length, &length) == 1) {
+        isDone = true;
+    }
+    EVP_CIPHER_CTX_free(context);
+
+    return isDone ? plain : QByteArray();
+}
+
+/**
+ * Private
+ * The 12 byte nonce of a chunk. Nonce prefix of file and chunk number.
+ * @param chunk
+ * @return
+ */
+QByteArray VaultCipher::nonce(const int chunk) const
+{
+    QByteArray counter;
+    QDataStream counterStream(&counter, QIODevice::WriteOnly);
+    counterStream << static_cast<quint64>(chunk);
+
+    return m_header.mid(HeaderLength - 4 - NoncePrefixLength, NoncePrefixLength) + counter;
+}
+
+/**
+ * Private
+ * Additional authenticated data of a chunk. The file header and the
+ * chunk table entry. Binds each chunk to its file and position.
+ * @param chunk
+ * @return
+ */
+QByteArray VaultCipher::additionalData(const int chunk) const
+{
+    QByteArray tableEntry;
+    QDataStream entryStream(&tableEntry, QIODevice::WriteOnly);
+    const ChunkEntry& entry = m_chunkTable[chunk];
+    entryStream << entry.firstRecord << entry.recordCount << entry.sealedLength;
+
+    return m_header + tableEntry;
+}
@@ -0,0 +1,70 @@
+#ifndef VAULTCIPHER_H
+#define VAULTCIPHER_H
+
+/* ------------------------------------------------------------------------------
+ * Class VaultCipher
+ *
+ * Reads and writes an encrypted container of Account objects (QVariantMap).
+ * The serialized records are packed into chunks of a fixed maximum size. A
+ * record never spans two chunks. Each chunk is sealed on its own with
+ * AES-256-GCM, so all chunks can be encrypted and decrypted in parallel and
+ * a single record can be read by decrypting just the chunk holding it.
+ *
+ * File layout (all integers big endian):
+ *  Header      magic "PWMV", version, chunk size, PBKDF2 iterations,
+ *              salt (16 bytes), nonce prefix (4 bytes), chunk count
+ *  Chunk table per chunk: index of first record, record count, sealed length
+ *  Chunks      ciphertext followed by the 16 byte GCM tag
+ *
+ * The key is derived from a passphrase with PBKDF2-HMAC-SHA256. The nonce of
+ * a chunk is the nonce prefix of the file followed by the chunk number. The
+ * header and the chunk table entry are authenticated as additional data.
+ * ------------------------------------------------------------------------------
+ */
+
+#include <QVariantMap>
+#include <QVector>
+
+class QIODevice;
+
+class VaultCipher
+{
+public:
+    VaultCipher(const QString& passphrase, const int chunkSize = DefaultChunkSize);
+
+    enum { DefaultChunkSize = 64 * 1024, KeyLength = 32, SaltLength = 16, NoncePrefixLength = 4, TagLength = 16,
+           Iterations = 200000 };
+
+    bool writeVault(const QString& filePath, const QList<QVariantMap>& accountList);
+    QList<QVariantMap> readVault(const QString& filePath);
+    QVariantMap readRecord(const QString& filePath, const int recordIndex);
+
+    // Error messages
+    QString error() const                           { return m_error; }
+    bool hasError() const                           { return ! m_error.isEmpty(); }
+
+private:
+    struct ChunkEntry {
+        quint32 firstRecord;
+        quint32 recordCount;
+        quint32 sealedLength;
+    };
+
+    QString m_passphrase;
+    int m_chunkSize;
+    QByteArray m_key;
+    QByteArray m_header;
+    QVector<ChunkEntry> m_chunkTable;
+    QString m_error;
+
+    QVector<QByteArray> packRecords(const QList<QVariantMap>& accountList);
+    QList<QVariantMap> unpackRecords(const QByteArray& plain) const;
+    bool readHeader(QIODevice& device);
+    bool deriveKey(const QByteArray& salt, const quint32 iterations);
+    QByteArray seal(const int chunk, const QByteArray& plain) const;
+    QByteArray open(const int chunk, const QByteArray& sealed) const;
+    QByteArray nonce(const int chunk) const;
+    QByteArray additionalData(const int chunk) const;
+};
+
+#endif // VAULTCIPHER_H
@@ -22,3 +22,4 @@ CONSTRAINT uq_provider_username UNIQUE (provider,username)
 );
 
 \! ECHO "Database and table created.";
+\! ECHO "Run 'PWManager migrate' to create the users and indexes.";
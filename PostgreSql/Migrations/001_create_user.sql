@@ -0,0 +1,12 @@
+-- ---------------------------------------
+-- Users of the password manager
+-- ---------------------------------------
+-- The name is the login name of the computer user (USER or USERNAME).
+
+CREATE TABLE IF NOT EXISTS public.user (
+id			SERIAL PRIMARY KEY,
+name			TEXT NOT NULL,
+email			TEXT NULL,
+active			BOOLEAN NOT NULL DEFAULT TRUE,
+CONSTRAINT uq_user_name UNIQUE (name)
+);
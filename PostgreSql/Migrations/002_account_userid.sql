@@ -0,0 +1,10 @@
+-- ---------------------------------------
+-- Accounts belong to a user
+-- ---------------------------------------
+-- Each statement of the application filters the accounts by 'userid'.
+-- Provider and username are unique per user. The unique index is led by
+-- 'userid', so it also serves the lookup of an account by its name.
+
+ALTER TABLE ${account} ADD COLUMN IF NOT EXISTS userid INTEGER NULL REFERENCES public.user (id);
+ALTER TABLE ${account} DROP CONSTRAINT IF EXISTS uq_provider_username;
+ALTER TABLE ${account} ADD CONSTRAINT uq_userid_provider_username UNIQUE (userid, provider, username);
@@ -0,0 +1,15 @@
+-- ---------------------------------------
+-- Indexes for the access patterns
+-- ---------------------------------------
+
+-- Accounts of a user in order of id (show, pages of show).
+CREATE INDEX IF NOT EXISTS ix_account_userid_id ON ${account} (userid, id);
+
+-- Stale accounts of a user (rotate, audit).
+CREATE INDEX IF NOT EXISTS ix_account_userid_lastmodify ON ${account} (userid, lastmodify);
+
+-- Accounts modified in a time range over all users. New and modified rows
+-- are mostly written at the end of the table, so a small BRIN index fits.
+CREATE INDEX IF NOT EXISTS ix_account_lastmodify ON ${account} USING BRIN (lastmodify);
+
+ANALYZE ${account};
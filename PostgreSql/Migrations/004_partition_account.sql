@@ -0,0 +1,62 @@
+-- ---------------------------------------
+-- Hash partitions of the accounts by user
+-- ---------------------------------------
+-- Optional. Only applied with 'migrate --partitions <n>'. It is meant for
+-- deployments with many users. Each user's accounts stay in one partition.
+-- Every account needs a user then. The primary key has to contain the
+-- partition key, so it becomes (userid, id).
+
+ALTER TABLE ${account} ALTER COLUMN userid SET NOT NULL;
+ALTER TABLE ${account} RENAME TO ${account}_unpartitioned;
+
+CREATE TABLE ${account} (LIKE ${account}_unpartitioned INCLUDING DEFAULTS) PARTITION BY HASH (userid);
+ALTER SEQUENCE ${account}_id_seq OWNED BY ${account}.id;
+
+DO $$
+BEGIN
+    FOR remainder IN 0 .. ${partitions} - 1 LOOP
+        EXECUTE format('CREATE TABLE %I PARTITION OF %I FOR VALUES WITH (MODULUS %s, REMAINDER %s)',
+                       '${account}_p' || remainder, '${account}', ${partitions}, remainder);
+    END LOOP;
+END
+$$;
+
+INSERT INTO ${account} SELECT * FROM ${account}_unpartitioned;
+DROP TABLE ${account}_unpartitioned;
+
+ALTER TABLE ${account} ADD CONSTRAINT pk_account PRIMARY KEY (userid, id);
+ALTER TABLE ${account} ADD CONSTRAINT uq_userid_provider_username UNIQUE (userid, provider, username);
+ALTER TABLE ${account} ADD CONSTRAINT fk_account_userid FOREIGN KEY (userid) REFERENCES public.user (id);
+CREATE INDEX ix_account_userid_lastmodify ON ${account} (userid, lastmodify);
+CREATE INDEX ix_account_lastmodify ON ${account} USING BRIN (lastmodify);
+
+-- The index and the triggers of migrations 005 and 006 were dropped with
+-- the old table. They are created again if they are applied already.
+DO $$
+BEGIN
+    IF to_regproc('${account}_touch') IS NOT NULL THEN
+        CREATE INDEX ix_account_userid_changexid ON ${account} (userid, changexid);
+        CREATE TRIGGER tr_account_touch BEFORE INSERT OR UPDATE ON ${account}
+            FOR EACH ROW EXECUTE FUNCTION ${account}_touch();
+        CREATE TRIGGER tr_account_bury AFTER DELETE ON ${account}
+            FOR EACH ROW EXECUTE FUNCTION ${account}_bury();
+        CREATE TRIGGER tr_account_prune AFTER DELETE ON ${account}
+            FOR EACH STATEMENT EXECUTE FUNCTION ${account}_prune();
+    END IF;
+    IF to_regproc('${account}_count') IS NOT NULL THEN
+        CREATE TRIGGER tr_account_count_insert AFTER INSERT ON ${account}
+            REFERENCING NEW TABLE AS new_rows
+            FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+        CREATE TRIGGER tr_account_count_update AFTER UPDATE ON ${account}
+            REFERENCING OLD TABLE AS old_rows NEW TABLE AS new_rows
+            FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+        CREATE TRIGGER tr_account_count_delete AFTER DELETE ON ${account}
+            REFERENCING OLD TABLE AS old_rows
+            FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+        CREATE TRIGGER tr_account_count_truncate AFTER TRUNCATE ON ${account}
+            FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+    END IF;
+END
+$$;
+
+ANALYZE ${account};
@@ -0,0 +1,65 @@
+-- ---------------------------------------
+-- Change tracking for the local replica
+-- ---------------------------------------
+-- A local replica pulls the accounts changed since its watermark. A time of
+-- change does not do: a transaction which commits late has an earlier time
+-- than changes seen before. So each insert and update stamps the row with
+-- the id of its transaction ('changexid'). The watermark is the xmin of the
+-- snapshot of a sync. Every transaction below it has ended, so a change not
+-- seen by the sync has an id at or above the watermark.
+-- A deleted account leaves a tombstone with the id of its transaction, so
+-- the replica can drop it. Tombstones older than 30 days are pruned on each
+-- delete. A replica which is older is loaded again (see LocalReplica).
+-- Needs PostgreSQL 13 (xid8).
+
+ALTER TABLE ${account} ADD COLUMN IF NOT EXISTS changexid xid8 NOT NULL DEFAULT pg_current_xact_id();
+
+-- Accounts of a user changed since the watermark of the replica.
+CREATE INDEX IF NOT EXISTS ix_account_userid_changexid ON ${account} (userid, changexid);
+
+CREATE TABLE IF NOT EXISTS ${account}_tombstone (
+    id          INTEGER NOT NULL,
+    userid      INTEGER NULL,
+    deletexid   xid8 NOT NULL DEFAULT pg_current_xact_id(),
+    deletedat   TIMESTAMPTZ NOT NULL DEFAULT now()
+);
+
+-- Tombstones of a user since the watermark of the replica.
+CREATE INDEX IF NOT EXISTS ix_account_tombstone_userid_deletexid ON ${account}_tombstone (userid, deletexid);
+-- Tombstones to prune.
+CREATE INDEX IF NOT EXISTS ix_account_tombstone_deletedat ON ${account}_tombstone (deletedat);
+
+CREATE OR REPLACE FUNCTION ${account}_touch() RETURNS trigger AS $$
+BEGIN
+    NEW.changexid := pg_current_xact_id();
+    RETURN NEW;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION ${account}_bury() RETURNS trigger AS $$
+BEGIN
+    INSERT INTO ${account}_tombstone (id, userid) VALUES (OLD.id, OLD.userid);
+    RETURN OLD;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION ${account}_prune() RETURNS trigger AS $$
+BEGIN
+    DELETE FROM ${account}_tombstone WHERE deletedat < now() - interval '30 days';
+    RETURN NULL;
+END
+$$ LANGUAGE plpgsql;
+
+DROP TRIGGER IF EXISTS tr_account_touch ON ${account};
+CREATE TRIGGER tr_account_touch BEFORE INSERT OR UPDATE ON ${account}
+    FOR EACH ROW EXECUTE FUNCTION ${account}_touch();
+
+DROP TRIGGER IF EXISTS tr_account_bury ON ${account};
+CREATE TRIGGER tr_account_bury AFTER DELETE ON ${account}
+    FOR EACH ROW EXECUTE FUNCTION ${account}_bury();
+
+DROP TRIGGER IF EXISTS tr_account_prune ON ${account};
+CREATE TRIGGER tr_account_prune AFTER DELETE ON ${account}
+    FOR EACH STATEMENT EXECUTE FUNCTION ${account}_prune();
+
+ANALYZE ${account};
@@ -0,0 +1,59 @@
+-- ---------------------------------------
+-- Change counter of each user
+-- ---------------------------------------
+-- The query cache checks with a single row if the accounts of a user have
+-- changed. A time of change does not do: a transaction which commits late
+-- can have an earlier time than a change seen before. The counter is raised
+-- within the transaction of each insert, update and delete, so a change is
+-- counted when it commits. Accounts without a user count for userid 0.
+-- The counters are raised once per statement from its transition tables,
+-- so a bulk change or an import locks each counter row only once. The
+-- rows are locked in the order of the users. A truncate raises all.
+
+CREATE TABLE IF NOT EXISTS ${account}_counter (
+    userid      INTEGER PRIMARY KEY,
+    changes     BIGINT NOT NULL DEFAULT 0
+);
+
+CREATE OR REPLACE FUNCTION ${account}_count() RETURNS trigger AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        INSERT INTO ${account}_counter AS counter (userid, changes)
+            SELECT DISTINCT COALESCE(userid, 0), 1 FROM new_rows ORDER BY 1
+            ON CONFLICT (userid) DO UPDATE SET changes = counter.changes + 1;
+    ELSIF TG_OP = 'UPDATE' THEN
+        INSERT INTO ${account}_counter AS counter (userid, changes)
+            SELECT COALESCE(userid, 0), 1 FROM old_rows
+            UNION SELECT COALESCE(userid, 0), 1 FROM new_rows ORDER BY 1
+            ON CONFLICT (userid) DO UPDATE SET changes = counter.changes + 1;
+    ELSIF TG_OP = 'DELETE' THEN
+        INSERT INTO ${account}_counter AS counter (userid, changes)
+            SELECT DISTINCT COALESCE(userid, 0), 1 FROM old_rows ORDER BY 1
+            ON CONFLICT (userid) DO UPDATE SET changes = counter.changes + 1;
+    ELSIF TG_OP = 'TRUNCATE' THEN
+        UPDATE ${account}_counter SET changes = changes + 1;
+    END IF;
+    RETURN NULL;
+END
+$$ LANGUAGE plpgsql;
+
+-- A trigger with transition tables takes a single event.
+DROP TRIGGER IF EXISTS tr_account_count ON ${account};
+DROP TRIGGER IF EXISTS tr_account_count_insert ON ${account};
+CREATE TRIGGER tr_account_count_insert AFTER INSERT ON ${account}
+    REFERENCING NEW TABLE AS new_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+
+DROP TRIGGER IF EXISTS tr_account_count_update ON ${account};
+CREATE TRIGGER tr_account_count_update AFTER UPDATE ON ${account}
+    REFERENCING OLD TABLE AS old_rows NEW TABLE AS new_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+
+DROP TRIGGER IF EXISTS tr_account_count_delete ON ${account};
+CREATE TRIGGER tr_account_count_delete AFTER DELETE ON ${account}
+    REFERENCING OLD TABLE AS old_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
+
+DROP TRIGGER IF EXISTS tr_account_count_truncate ON ${account};
+CREATE TRIGGER tr_account_count_truncate AFTER TRUNCATE ON ${account}
+    FOR EACH STATEMENT EXECUTE FUNCTION ${account}_count();
@@ -0,0 +1,522 @@
+#include "filterexpression.h"
+
+/**
+ * Constructor
+ * Creates an empty filter. It matches every Account object.
+ */
+FilterExpression::FilterExpression() :
+    m_root(-1),
+    m_position(0),
+    m_depth(0)
+{
+
+}
+
+/**
+ * Parses a filter text into a tree of nodes. An empty text is an
+ * empty filter.
+ * @param text
+ * @return              False on a syntax error. See error().
+ */
+bool FilterExpression::parse(const QString &text)
+{
+    m_nodeList.clear();
+    m_root = -1;
+    m_error.clear();
+    m_text = text;
+    m_position = 0;
+    m_depth = 0;
+    skipSpaces();
+    if (m_position >= m_text.length()) {
+        return true;
+    }
+    int root = parseExpression();
+    if (root >= 0) {
+        skipSpaces();
+        if (m_position < m_text.length()) {
+            m_error = QString("Unexpected '%1' at position %2 of filter !").arg(m_text.mid(m_position)).arg(m_position + 1);
+        }
+    }
+    if (! m_error.isEmpty()) {
+        m_nodeList.clear();
+        return false;
+    }
+    m_root = root;
+
+    return true;
+}
+
+/**
+ * The column names used by the filter. Each name once.
+ * @return
+ */
+QStringList FilterExpression::columnNames() const
+{
+    QStringList nameList;
+    for (const Node& node : m_nodeList) {
+        if (node.kind == Compare && ! nameList.contains(node.column)) {
+            nameList << node.column;
+        }
+    }
+
+    return nameList;
+}
+
+/**
+ * Evaluates the filter for an Account object.
+ * @param account
+ * @return              True if the filter is empty or its result is true.
+ */
+bool FilterExpression::matches(const QVariantMap &account) const
+{
+    if (m_root < 0) {
+        return true;
+    }
+
+    return evaluate(m_root, account) == IsTrue;
+}
+
+/**
+ * Compiles the filter into a SQL condition. Values are not part of the
+ * condition. Each value is a parameter '?' and appended to the value list.
+ * @param quoteName     Returns the quoted column name for a name.
+ * @param valueList     Takes the values of the parameters in order.
+ * @return              The condition. Empty if the filter is empty.
+ */
+QString FilterExpression::sqlCondition(const std::function<QString (const QString &)> &quoteName, QVariantList &valueList) const
+{
+    if (m_root < 0) {
+        return QString();
+    }
+
+    return sqlOf(m_root, quoteName, valueList);
+}
+
+/**
+ * Private
+ * expression := term { OR term }
+ * @return              Index of the node. Or -1 on error.
+ */
+int FilterExpression::parseExpression()
+{
+    int left = parseTerm();
+    while (left >= 0 && takeKeyword("OR")) {
+        int right = parseTerm();
+        if (right < 0) {
+            return -1;
+        }
+        left = appendNode(Or, left, right);
+    }
+
+    return left;
+}
+
+/**
+ * Private
+ * term := factor { AND factor }
+ * @return              Index of the node. Or -1 on error.
+ */
+int FilterExpression::parseTerm()
+{
+    int left = parseFactor();
+    while (left >= 0 && takeKeyword("AND")) {
+        int right = parseFactor();
+        if (right < 0) {
+            return -1;
+        }
+        left = appendNode(And, left, right);
+    }
+
+    return left;
+}
+
+/**
+ * Private
+ * factor := NOT factor | '(' expression ')' | comparison
+ * The levels of NOT and parentheses are counted, so a deep nesting is
+ * an error and not a stack overflow.
+ * @return              Index of the node. Or -1 on error.
+ */
+int FilterExpression::parseFactor()
+{
+    if (takeKeyword("NOT")) {
+        if (! enterLevel()) {
+            return -1;
+        }
+        int operand = parseFactor();
+        if (operand < 0) {
+            return -1;
+        }
+        --m_depth;
+        return appendNode(Not, operand, -1);
+    }
+    skipSpaces();
+    if (m_position < m_text.length() && m_text[m_position] == QChar('(')) {
+        if (! enterLevel()) {
+            return -1;
+        }
+        ++m_position;
+        int node = parseExpression();
+        if (node < 0) {
+            return -1;
+        }
+        --m_depth;
+        skipSpaces();
+        if (m_position >= m_text.length() || m_text[m_position] != QChar(')')) {
+            m_error = QString("Missing ')' at position %1 of filter !").arg(m_position + 1);
+            return -1;
+        }
+        ++m_position;
+        return node;
+    }
+
+    return parseComparison();
+}
+
+/**
+ * Private
+ * comparison := column operator value
+ * @return              Index of the node. Or -1 on error.
+ */
+int FilterExpression::parseComparison()
+{
+    skipSpaces();
+    QString column = takeWord();
+    if (column.isEmpty()) {
+        m_error = QString("A column name is expected at position %1 of filter !").arg(m_position + 1);
+        return -1;
+    }
+    skipSpaces();
+    static const struct { const char* text; Operator op; } operatorList[] = {
+        { "!=", NotEqual }, { "<=", LessEqual }, { ">=", GreaterEqual }, { "^=", Prefix },
+        { "=", Equal }, { "<", Less }, { ">", Greater }, { "~", Pattern }
+    };
+    int found = -1;
+    for (int index=0; index<8 && found<0; ++index) {
+        if (m_text.midRef(m_position).startsWith(QLatin1String(operatorList[index].text))) {
+            found = index;
+        }
+    }
+    if (found < 0) {
+        m_error = QString("An operator is expected after '%1' in filter !").arg(column);
+        return -1;
+    }
+    m_position += static_cast<int>(qstrlen(operatorList[found].text));
+    QString value = takeValue();
+    if (value.isNull()) {
+        return -1;
+    }
+    Node node { Compare, -1, -1, column, operatorList[found].op, value, QRegularExpression(), QDateTime(), 0.0, false, 1 };
+    if (node.op == Pattern) {
+        node.pattern = QRegularExpression(QRegularExpression::wildcardToRegularExpression(value),
+                                          QRegularExpression::CaseInsensitiveOption);
+    }
+    node.dateTime = QDateTime::fromString(value, Qt::ISODate);
+    if (! node.dateTime.isValid()) {
+        QDate date = QDate::fromString(value, Qt::ISODate);
+        if (date.isValid()) {
+            node.dateTime = QDateTime(date, QTime(0, 0));
+        }
+    }
+    node.number = value.toDouble(&node.isNumber);
+    m_nodeList.append(node);
+
+    return m_nodeList.size() - 1;
+}
+
+/**
+ * Private
+ * Takes a keyword if it is the next word. Case is ignored.
+ * @param keyword
+ * @return
+ */
+bool FilterExpression::takeKeyword(const char *keyword)
+{
+    skipSpaces();
+    int length = static_cast<int>(qstrlen(keyword));
+    if (m_text.midRef(m_position, length).compare(QLatin1String(keyword), Qt::CaseInsensitive) != 0) {
+        return false;
+    }
+    int end = m_position + length;
+    if (end < m_text.length() && (m_text[end].isLetterOrNumber() || m_text[end] == QChar('_'))) {
+        return false;
+    }
+    m_position = end;
+
+    return true;
+}
+
+/**
+ * Private
+ * Takes a word of letters, digits and '_'.
+ * @return              The word. Empty if there is none.
+ */
+QString FilterExpression::takeWord()
+{
+    int begin = m_position;
+    while (m_position < m_text.length() && (m_text[m_position].isLetterOrNumber() || m_text[m_position] == QChar('_'))) {
+        ++m_position;
+    }
+
+    return m_text.mid(begin, m_position - begin);
+}
+
+/**
+ * Private
+ * Takes a value. A quoted value ends with the same quote. Other values
+ * end at a space or a ')'.
+ * @return              The value. A null string on error.
+ */
+QString FilterExpression::takeValue()
+{
+    skipSpaces();
+    if (m_position < m_text.length() && (m_text[m_position] == QChar('\'') || m_text[m_position] == QChar('"'))) {
+        QChar quote = m_text[m_position];
+        int end = m_text.indexOf(quote, m_position + 1);
+        if (end < 0) {
+            m_error = QString("Missing closing quote in filter !");
+            return QString();
+        }
+        QString value = m_text.mid(m_position + 1, end - m_position - 1);
+        m_position = end + 1;
+        return value.isNull() ? QString("") : value;
+    }
+    int begin = m_position;
+    while (m_position < m_text.length() && ! m_text[m_position].isSpace() && m_text[m_position] != QChar(')')) {
+        ++m_position;
+    }
+    if (m_position == begin) {
+        m_error = QString("A value is expected at position %1 of filter !").arg(m_position + 1);
+        return QString();
+    }
+
+    return m_text.mid(begin, m_position - begin);
+}
+
+/**
+ * Private
+ * Moves the position behind white spaces.
+ */
+void FilterExpression::skipSpaces()
+{
+    while (m_position < m_text.length() && m_text[m_position].isSpace()) {
+        ++m_position;
+    }
+}
+
+/**
+ * Private
+ * Counts a level of NOT or parentheses.
+ * @return              False if the filter is nested too deep.
+ */
+bool FilterExpression::enterLevel()
+{
+    if (++m_depth > m_maxDepth) {
+        m_error = QString("Filter is nested deeper than %1 levels at position %2 !").arg(m_maxDepth).arg(m_position + 1);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Appends a node for AND, OR or NOT. A long chain of AND or OR is a deep
+ * tree as well, so the levels of the tree are limited too. Evaluation
+ * and compilation recurse through it.
+ * @param kind
+ * @param left
+ * @param right
+ * @return              Index of the node. Or -1 if the tree is too deep.
+ */
+int FilterExpression::appendNode(const Kind kind, const int left, const int right)
+{
+    int depth = 1 + qMax(m_nodeList[left].depth, right < 0 ? 0 : m_nodeList[right].depth);
+    if (depth > m_maxDepth) {
+        m_error = QString("Filter is nested deeper than %1 levels at position %2 !").arg(m_maxDepth).arg(m_position + 1);
+        return -1;
+    }
+    m_nodeList.append(Node { kind, left, right, QString(), Equal, QString(), QRegularExpression(), QDateTime(), 0.0, false, depth });
+
+    return m_nodeList.size() - 1;
+}
+
+/**
+ * Private
+ * Evaluates a node with three valued logic.
+ * @param node
+ * @param account
+ * @return
+ */
+FilterExpression::Truth FilterExpression::evaluate(const int node, const QVariantMap &account) const
+{
+    const Node& current = m_nodeList[node];
+    switch (current.kind) {
+    case And: {
+        Truth left = evaluate(current.left, account);
+        if (left == IsFalse) {
+            return IsFalse;
+        }
+        Truth right = evaluate(current.right, account);
+        if (right == IsFalse) {
+            return IsFalse;
+        }
+        return (left == IsTrue && right == IsTrue) ? IsTrue : IsUnknown;
+    }
+    case Or: {
+        Truth left = evaluate(current.left, account);
+        if (left == IsTrue) {
+            return IsTrue;
+        }
+        Truth right = evaluate(current.right, account);
+        if (right == IsTrue) {
+            return IsTrue;
+        }
+        return (left == IsFalse && right == IsFalse) ? IsFalse : IsUnknown;
+    }
+    case Not: {
+        Truth operand = evaluate(current.left, account);
+        if (operand == IsUnknown) {
+            return IsUnknown;
+        }
+        return (operand == IsTrue) ? IsFalse : IsTrue;
+    }
+    default:
+        return compare(current, account.value(current.column));
+    }
+}
+
+/**
+ * Private
+ * Compares a value of an Account object with the value of a node. The
+ * type of the account value decides how to compare. Text is ordered by
+ * QString::compare(), which may differ from the collation of the server.
+ * @param node
+ * @param value
+ * @return              Unknown if the value is missing or can not be compared.
+ */
+FilterExpression::Truth FilterExpression::compare(const Node &node, const QVariant &value) const
+{
+    if (value.isNull()) {
+        return IsUnknown;
+    }
+    if (node.op == Prefix) {
+        return value.toString().startsWith(node.value) ? IsTrue : IsFalse;
+    }
+    if (node.op == Pattern) {
+        return node.pattern.match(value.toString()).hasMatch() ? IsTrue : IsFalse;
+    }
+    int order = 0;
+    switch (value.type()) {
+    case QVariant::DateTime:
+    case QVariant::Date: {
+        if (! node.dateTime.isValid()) {
+            return IsUnknown;
+        }
+        QDateTime own = value.toDateTime();
+        order = (own < node.dateTime) ? -1 : (node.dateTime < own) ? 1 : 0;
+        break;
+    }
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double: {
+        if (! node.isNumber) {
+            return IsUnknown;
+        }
+        double own = value.toDouble();
+        order = (own < node.number) ? -1 : (node.number < own) ? 1 : 0;
+        break;
+    }
+    case QVariant::Bool: {
+        QString text = node.value.toLower();
+        bool other = text == QString("t") || text == QString("true") || text == QString("1");
+        order = static_cast<int>(value.toBool()) - static_cast<int>(other);
+        break;
+    }
+    default:
+        order = QString::compare(value.toString(), node.value);
+        break;
+    }
+    bool result = false;
+    switch (node.op) {
+    case Equal:         result = order == 0; break;
+    case NotEqual:      result = order != 0; break;
+    case Less:          result = order < 0; break;
+    case LessEqual:     result = order <= 0; break;
+    case Greater:       result = order > 0; break;
+    case GreaterEqual:  result = order >= 0; break;
+    default:            break;
+    }
+
+    return result ? IsTrue : IsFalse;
+}
+
+/**
+ * Private
+ * SQL of a node. Prefix and pattern compare the text of a column with
+ * LIKE and ILIKE.
+ * @param node
+ * @param quoteName
+ * @param valueList
+ * @return
+ */
+QString FilterExpression::sqlOf(const int node, const std::function<QString (const QString &)> &quoteName, QVariantList &valueList) const
+{
+    const Node& current = m_nodeList[node];
+    switch (current.kind) {
+    case And:
+        return QString("(%1 AND %2)").arg(sqlOf(current.left, quoteName, valueList),
+                                          sqlOf(current.right, quoteName, valueList));
+    case Or:
+        return QString("(%1 OR %2)").arg(sqlOf(current.left, quoteName, valueList),
+                                         sqlOf(current.right, quoteName, valueList));
+    case Not:
+        return QString("NOT (%1)").arg(sqlOf(current.left, quoteName, valueList));
+    default:
+        break;
+    }
+    QString column = quoteName(current.column);
+    switch (current.op) {
+    case Prefix:
+        valueList << QVariant(likePattern(current.value, false) + QChar('%'));
+        return QString("CAST(%1 AS text) LIKE ?").arg(column);
+    case Pattern:
+        valueList << QVariant(likePattern(current.value, true));
+        return QString("CAST(%1 AS text) ILIKE ?").arg(column);
+    default:
+        break;
+    }
+    static const char* const operatorList[] = { "=", "<>", "<", "<=", ">", ">=" };
+    valueList << QVariant(current.value);
+
+    return QString("%1 %2 ?").arg(column, QLatin1String(operatorList[current.op]));
+}
+
+/**
+ * Static private
+ * Escapes the special characters of LIKE. With wildcards '*' and '?'
+ * are translated to '%' and '_'.
+ * @param text
+ * @param withWildcards
+ * @return
+ */
+QString FilterExpression::likePattern(const QString &text, const bool withWildcards)
+{
+    QString pattern;
+    pattern.reserve(text.length() + 4);
+    for (const QChar symbol : text) {
+        if (symbol == QChar('\\') || symbol == QChar('%') || symbol == QChar('_')) {
+            pattern.append(QChar('\\')).append(symbol);
+        } else if (withWildcards && symbol == QChar('*')) {
+            pattern.append(QChar('%'));
+        } else if (withWildcards && symbol == QChar('?')) {
+            pattern.append(QChar('_'));
+        } else {
+            pattern.append(symbol);
+        }
+    }
+
+    return pattern;
+}
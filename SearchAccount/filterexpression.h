@@ -0,0 +1,105 @@
+#ifndef FILTEREXPRESSION_H
+#define FILTEREXPRESSION_H
+
+/* ----------------------------------------------------------------------
+ * Class FilterExpression
+ * ----------------------------------------------------------------------
+ * A filter for Account objects given as text. For instance:
+ *   provider^=aws AND lastmodify<2026-01-01
+ *   NOT (username=horst OR provider~*mail*)
+ *
+ * Grammar:
+ *   expression := term { OR term }
+ *   term       := factor { AND factor }
+ *   factor     := NOT factor | '(' expression ')' | column operator value
+ *   operator   := = | != | < | <= | > | >= | ^= (prefix) | ~ (pattern)
+ *   value      := word | 'quoted text' | "quoted text"
+ * Keywords are case insensitive. Columns are the real names of the
+ * persistence (see Persistence::optionToRealName()). A pattern takes the
+ * wildcards '*' and '?' and ignores case.
+ *
+ * The text is parsed once into a tree of nodes. The tree can be compiled
+ * into a parameterised SQL condition or evaluated for an Account object.
+ * Evaluation follows the three valued logic of SQL: a comparison with a
+ * missing value is unknown, and only a true result matches.
+ * Text is ordered by its UTF-16 code units when evaluated, but by the
+ * collation of the column in SQL. So '<', '<=', '>' and '>=' on text may
+ * select other Account objects from a local copy than from the server
+ * unless the column has collation "C". Equality is exact in both.
+ * A filter may be nested at most 256 levels deep. Each AND, OR, NOT and
+ * parenthesis is a level.
+ * ----------------------------------------------------------------------
+ */
+
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <functional>
+
+class FilterExpression
+{
+public:
+    enum Operator { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual, Prefix, Pattern };
+
+    FilterExpression();
+
+    bool parse(const QString& text);
+    bool isEmpty() const                        { return m_root < 0; }
+    QString error() const                       { return m_error; }
+    QString text() const                        { return m_text; }
+    QStringList columnNames() const;
+
+    bool matches(const QVariantMap& account) const;
+    QString sqlCondition(const std::function<QString(const QString&)>& quoteName, QVariantList& valueList) const;
+
+private:
+    enum Kind { And, Or, Not, Compare };
+    enum Truth { IsFalse, IsTrue, IsUnknown };
+
+    struct Node
+    {
+        Kind kind;
+        int left;                   // Index of first operand. Or -1.
+        int right;                  // Index of second operand. Or -1.
+        QString column;
+        Operator op;
+        QString value;
+        // The value converted once for comparisons.
+        QRegularExpression pattern;
+        QDateTime dateTime;
+        double number;
+        bool isNumber;
+        int depth;                  // Levels of the subtree.
+    };
+
+    QVector<Node> m_nodeList;
+    int m_root;
+    QString m_error;
+    // Parser state
+    QString m_text;
+    int m_position;
+    int m_depth;
+    static const int m_maxDepth = 256;
+
+    // Parser
+    int parseExpression();
+    int parseTerm();
+    int parseFactor();
+    int parseComparison();
+    bool takeKeyword(const char* keyword);
+    QString takeWord();
+    QString takeValue();
+    void skipSpaces();
+    bool enterLevel();
+    int appendNode(const Kind kind, const int left, const int right);
+    // Evaluation
+    Truth evaluate(const int node, const QVariantMap& account) const;
+    Truth compare(const Node& node, const QVariant& value) const;
+    // SQL
+    QString sqlOf(const int node, const std::function<QString(const QString&)>& quoteName, QVariantList& valueList) const;
+    static QString likePattern(const QString& text, const bool withWildcards);
+};
+
+#endif // FILTEREXPRESSION_H
@@ -1,4 +1,8 @@
 #include "consoleinterface.h"
+#ifdef Q_OS_UNIX
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 
 const QString ConsoleInterface::m_colorRed = "\e[0,31m";
@@ -10,7 +14,8 @@ const QString ConsoleInterface::m_colorBraun = "\e[0,33m";
 
 // Constructor
 ConsoleInterface::ConsoleInterface() :
-    outStream(stdout)
+    outStream(stdout),
+    m_rowCount(0)
 {
     m_printOrderList << QString("id") << QString("provider") << QString("username");
 }
@@ -21,6 +26,31 @@ void ConsoleInterface::setPrintOrderList(const QStringList &list)
     m_printOrderList = list;
 }
 
+/**
+ * Sets the columns of secrets. Their values are never cut in a table.
+ * @param columnList
+ */
+void ConsoleInterface::setSecretColumns(const QStringList &columnList)
+{
+    m_secretColumnList = columnList;
+}
+
+/**
+ * Sets the output format of Account objects.
+ * @param formatName        'table', 'jsonl', 'csv' or 'tsv'.
+ * @return                  False if the format is unknown.
+ */
+bool ConsoleInterface::setOutputFormat(const QString &formatName)
+{
+    RecordWriter::Format format;
+    if (! RecordWriter::formatFromName(formatName, format)) {
+        return false;
+    }
+    m_recordWriter.setFormat(format);
+
+    return true;
+}
+
 /**
  * Print an error message to console.
  * Print in text color red and adds a
@@ -28,8 +58,33 @@ void ConsoleInterface::setPrintOrderList(const QStringList &list)
  */
 void ConsoleInterface::printError(const QString &errorMsg)
 {
-    QString coloredMsg = m_colorRed + errorMsg + m_colorStandard;
-    outStream << coloredMsg << '\n';
+    printMessage(QString(errorMsg).append('\n'), m_colorRed);
+}
+
+/**
+ * Print a timing report to the error channel. It does not mix with
+ * the output of a command which may be read by a script.
+ * @param lineList
+ */
+void ConsoleInterface::printProfile(const QStringList &lineList)
+{
+    outStream.flush();
+    QTextStream errorStream(stderr);
+    for (const QString& line : lineList) {
+        errorStream << line << '\n';
+    }
+}
+
+/**
+ * Print the key of the next page to the error channel. The rows of the
+ * page stay readable by a script.
+ * @param key               Value for option '--after'.
+ */
+void ConsoleInterface::printNextPageKey(const QString &key)
+{
+    outStream.flush();
+    QTextStream errorStream(stderr);
+    errorStream << "Next page: --after '" << key << "'\n";
 }
 
 /**
@@ -38,8 +93,7 @@ void ConsoleInterface::printError(const QString &errorMsg)
  */
 void ConsoleInterface::printWarnings(const QString &warnings)
 {
-    QString coloredMsg = m_colorBraun + warnings + m_colorStandard;
-    outStream << coloredMsg << '\n';
+    printMessage(QString(warnings).append('\n'), m_colorBraun);
 }
 
 /**
@@ -54,15 +108,12 @@ void ConsoleInterface::printSingleAccount(const QVariantMap &account)
     if (account.isEmpty()) {
         return;
     }
-    ColumnWidth columnWidth;
-    QStringList keyList = account.keys();
-    foreach (const QString key, keyList) {
-        QVariant valueVariant = account.value(key);
-        QString value = valueVariant.toString();
-        columnWidth.insertWidthValue(key, value.length());
+    if (m_recordWriter.format() != RecordWriter::Table) {
+        m_recordWriter.setColumns(QStringList());
+        writeRecords(QList<QVariantMap>() << account);
+        return;
     }
-    printTableHeader(account, columnWidth);
-    printAccount(account, columnWidth);
+    printTable(QList<QVariantMap>() << account);
     outStream << '\n';
 }
 
@@ -86,8 +137,7 @@ void ConsoleInterface::printHelp(const QStringList &help)
  */
 void ConsoleInterface::printSuccessMsg(const QString &message)
 {
-    QString msg = QString(message).prepend(m_colorGreen).append(m_colorStandard);
-    outStream << msg;
+    printMessage(message, m_colorGreen);
 }
 
 /**
@@ -98,78 +148,243 @@ void ConsoleInterface::printSuccessMsg(const QString &message)
  */
 void ConsoleInterface::printAccountList(const QList<QVariantMap> &accountList)
 {
+    if (m_recordWriter.format() != RecordWriter::Table) {
+        m_recordWriter.setColumns(QStringList());
+        writeRecords(accountList);
+        return;
+    }
     if (accountList.isEmpty()) {
         outStream << m_colorGreen << "Nothing was found.\n" << m_colorStandard;
         return;
     }
-    ColumnWidth tableLayout = getTableLayout(accountList);
-    printTableHeader(accountList[0], tableLayout);
-    foreach (const QVariantMap account, accountList) {
-        printAccount(account, tableLayout);
+    printTable(accountList);
+}
+
+/**
+ * Print a list of passwords. One password per line without any
+ * decoration, so the output can be used by scripts.
+ * @param passwordList
+ */
+void ConsoleInterface::printPasswordList(const QStringList &passwordList)
+{
+    for (const QString& password : passwordList) {
+        outStream << password << '\n';
     }
 }
 
 /**
- * Print an output header.
- * @param account
- * @param columnWidth
+ * Starts a streamed table of Account objects. Columns with a limit get
+ * that width. The width of other columns is taken from the sample
+ * window but never exceeds the maximum cell width.
+ * @param columnLimitTable      Column name and its width in characters.
  */
-void ConsoleInterface::printTableHeader(const QVariantMap &account, const ColumnWidth &columnWidth)
+void ConsoleInterface::beginAccountTable(const QHash<QString, int> &columnLimitTable)
 {
-    QChar line('-');
-    QChar space(' ');
-    QString horzLine = QString(columnWidth.totalWidth(), line).append('\n');
-    outStream << '\n';
-    outStream << horzLine;
-    outStream << "|";
-    foreach (const QString column, m_printOrderList) {
-        if (account.contains(column)) {
-            QString fillSpace = QString(columnWidth.spaceToFillColumn(column, column), space);
-            outStream << ' ' << m_colorLBlue << column << m_colorStandard << fillSpace << '|';
+    m_tableRenderer.setColumns(QStringList());
+    m_tableRenderer.setMaxCellWidth(m_maxCellWidth);
+    m_recordWriter.setColumns(QStringList());
+    m_columnLimitTable = columnLimitTable;
+    m_rowCount = 0;
+}
+
+/**
+ * Prints the next rows of a streamed table. Rows are held back until
+ * the sample window is full. Afterwards the rows of each call are
+ * written at once.
+ * @param accountList
+ */
+void ConsoleInterface::printAccountRows(const QList<QVariantMap> &accountList)
+{
+    if (accountList.isEmpty()) {
+        return;
+    }
+    if (m_recordWriter.format() != RecordWriter::Table) {
+        m_rowCount += accountList.size();
+        writeRecords(accountList);
+        return;
+    }
+    if (! m_tableRenderer.hasColumns()) {
+        m_tableRenderer.setColumns(printedColumns(accountList[0]));
+        for (QHash<QString, int>::const_iterator iter=m_columnLimitTable.constBegin(); iter!=m_columnLimitTable.constEnd(); ++iter) {
+            m_tableRenderer.setColumnLimit(iter.key(), iter.value());
+        }
+        for (const QString& column : m_secretColumnList) {
+            m_tableRenderer.setColumnUncut(column);
+        }
+    }
+    for (const QVariantMap& account : accountList) {
+        m_tableRenderer.appendRow(account);
+        ++m_rowCount;
+        if (! m_tableRenderer.isFixed() && m_rowCount >= m_sampleWindow) {
+            fixTableLayout();
         }
     }
+    if (m_tableRenderer.isFixed()) {
+        QString buffer;
+        m_tableRenderer.render(buffer);
+        outStream << buffer;
+        outStream.flush();
+    }
+}
+
+/**
+ * Ends a streamed table. Prints rows still held back.
+ */
+void ConsoleInterface::endAccountTable()
+{
+    if (m_recordWriter.format() != RecordWriter::Table) {
+        return;
+    }
+    if (m_rowCount == 0) {
+        outStream << m_colorGreen << "Nothing was found.\n" << m_colorStandard;
+        return;
+    }
+    if (! m_tableRenderer.isFixed()) {
+        fixTableLayout();
+    }
+    QString buffer;
+    m_tableRenderer.render(buffer);
+    outStream << buffer;
+    outStream.flush();
+}
+
+/**
+ * Read a passphrase from console. Prints the prompt and switches
+ * off echo of the terminal while the user types.
+ * @param prompt
+ * @return passphrase       The line read from console.
+ */
+QString ConsoleInterface::readPassphrase(const QString &prompt)
+{
+    outStream << prompt;
+    outStream.flush();
+#ifdef Q_OS_UNIX
+    termios oldSettings;
+    bool isTerminal = tcgetattr(STDIN_FILENO, &oldSettings) == 0;
+    if (isTerminal) {
+        termios newSettings = oldSettings;
+        newSettings.c_lflag &= ~static_cast<tcflag_t>(ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newSettings);
+    }
+#endif
+    QTextStream inStream(stdin);
+    QString passphrase = inStream.readLine();
+#ifdef Q_OS_UNIX
+    if (isTerminal) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
+    }
+#endif
     outStream << '\n';
-    outStream << horzLine;
+
+    return passphrase;
 }
 
 /**
- * Print an account.
+ * Asks a question to be answered with yes or no.
+ * @param question
+ * @return                  True if the user answers 'y' or 'yes'.
+ */
+bool ConsoleInterface::readConfirmation(const QString &question)
+{
+    outStream << m_colorBraun << question << " [y/N] " << m_colorStandard;
+    outStream.flush();
+    QTextStream inStream(stdin);
+    QString answer = inStream.readLine().trimmed().toLower();
+
+    return answer == QString("y") || answer == QString("yes");
+}
+
+/**
+ * Private
+ * Prints a message in a color. With a machine readable output format
+ * the message goes to the error channel without color.
+ * @param message
+ * @param colorName
+ */
+void ConsoleInterface::printMessage(const QString &message, const QString &colorName)
+{
+    if (m_recordWriter.format() != RecordWriter::Table) {
+        outStream.flush();
+        QTextStream errorStream(stderr);
+        errorStream << message;
+        return;
+    }
+    outStream << colorName << message << m_colorStandard;
+}
+
+/**
+ * Private
+ * The columns of an account in print order.
  * @param account
- * @param columnWidth
+ * @return
  */
-void ConsoleInterface::printAccount(const QVariantMap &account, const ColumnWidth &columnWidth)
+QStringList ConsoleInterface::printedColumns(const QVariantMap &account) const
 {
-    QChar line('-');
-    QChar space(' ');
-    QString horzLine = QString(columnWidth.totalWidth(), line).append('\n');
-    outStream << '|';
-    foreach (const QString column, m_printOrderList) {
+    QStringList columnList;
+    for (const QString& column : m_printOrderList) {
         if (account.contains(column)) {
-            QVariant value = account.value(column);
-            QString valueString = value.toString();
-            QString fillSpace = QString(columnWidth.spaceToFillColumn(column, valueString), space);
-            outStream << ' ' << valueString << fillSpace << '|';
+            columnList << column;
         }
     }
-    outStream << '\n';
-    outStream << horzLine;
+
+    return columnList;
 }
 
 /**
- * Calculate column width of table.
- * Find longest entry to fit column width.
- * Minimum size is width of column header name.
+ * Private
+ * Print a table with header. The columns are taken from the first
+ * account. Column width is the longest entry or the column name.
+ * The table is rendered into one buffer and written at once.
  * @param accountList
- * @return
  */
-ColumnWidth ConsoleInterface::getTableLayout(const QList<QVariantMap> &accountList)
+void ConsoleInterface::printTable(const QList<QVariantMap> &accountList)
 {
-    ColumnWidth tableLayout;
-    foreach (const QVariantMap account, accountList) {
-        foreach (const QString column, account.keys()) {
-            tableLayout.insertWidthValue(column, account.value(column));
-        }
+    TableRenderer renderer;
+    renderer.setColumns(printedColumns(accountList[0]));
+    for (const QString& column : m_secretColumnList) {
+        renderer.setColumnUncut(column);
+    }
+    for (const QVariantMap& account : accountList) {
+        renderer.appendRow(account);
     }
+    QString buffer;
+    renderer.renderHeader(buffer, m_colorLBlue, m_colorStandard);
+    renderer.render(buffer);
+    outStream << buffer;
+    outStream.flush();
+}
+
+/**
+ * Private
+ * Fixes the column widths of the streamed table after the sample
+ * window. Prints the header and the held back rows.
+ */
+void ConsoleInterface::fixTableLayout()
+{
+    m_tableRenderer.fixWidths();
+    QString buffer;
+    m_tableRenderer.renderHeader(buffer, m_colorLBlue, m_colorStandard);
+    m_tableRenderer.render(buffer);
+    outStream << buffer;
+}
 
-    return tableLayout;
+/**
+ * Private
+ * Writes Account objects in the machine readable output format. The
+ * columns and the header are taken from the first account if not set.
+ * The output buffer is reused for each call.
+ * @param accountList
+ */
+void ConsoleInterface::writeRecords(const QList<QVariantMap> &accountList)
+{
+    m_recordBuffer.resize(0);
+    if (! m_recordWriter.hasColumns() && ! accountList.isEmpty()) {
+        m_recordWriter.setColumns(printedColumns(accountList[0]));
+        m_recordWriter.appendHeader(m_recordBuffer);
+    }
+    for (const QVariantMap& account : accountList) {
+        m_recordWriter.appendRow(account, m_recordBuffer);
+    }
+    outStream << m_recordBuffer;
+    outStream.flush();
 }
@@ -5,9 +5,23 @@
  * Class ConsoleInterface
  * ----------------------------------------------------------------------
  * Provides functions to output messages, help text and results.
+ *
+ * A table of Account objects can be printed at once with
+ * printAccountList() or streamed with beginAccountTable(),
+ * printAccountRows() and endAccountTable(). The streamed table takes
+ * the column widths from the first rows (the sample window) or from
+ * given column limits and prints each row as soon as the widths are
+ * known. Longer values are cut to the column width. Values of the secret
+ * columns (see setSecretColumns()) are never cut.
+ * Tables are rendered by a TableRenderer and written in large blocks.
+ * With a machine readable output format (see RecordWriter) the same
+ * methods write the Account objects in that format instead of a table.
+ * Errors, warnings and messages are written to stderr then, without
+ * colors, so stdout holds only the records.
  */
 
-#include "columnwidth.h"
+#include "tablerenderer.h"
+#include "recordwriter.h"
 #include <QTextStream>
 
 class ConsoleInterface
@@ -16,6 +30,8 @@ public:
     ConsoleInterface();
 
     void setPrintOrderList(const QStringList& list);
+    void setSecretColumns(const QStringList& columnList);
+    bool setOutputFormat(const QString& formatName);
 
     void printError(const QString &errorMsg);
     void printWarnings(const QString& warnings);
@@ -23,10 +39,28 @@ public:
     void printHelp(const QStringList &help);
     void printSuccessMsg(const QString &message);
     void printAccountList(const QList<QVariantMap> &accountList);
+    void printPasswordList(const QStringList &passwordList);
+    void printProfile(const QStringList &lineList);
+    void printNextPageKey(const QString &key);
+    void beginAccountTable(const QHash<QString, int> &columnLimitTable = QHash<QString, int>());
+    void printAccountRows(const QList<QVariantMap> &accountList);
+    void endAccountTable();
+    QString readPassphrase(const QString &prompt);
+    bool readConfirmation(const QString &question);
 
 private:
     QTextStream outStream;
     QStringList m_printOrderList;
+    QStringList m_secretColumnList;
+    // Streamed table
+    TableRenderer m_tableRenderer;
+    QHash<QString, int> m_columnLimitTable;
+    int m_rowCount;
+    // Machine readable output
+    RecordWriter m_recordWriter;
+    QString m_recordBuffer;
+    static const int m_sampleWindow = 64;
+    static const int m_maxCellWidth = 40;
     // const static
     static const QString m_colorRed;
     static const QString m_colorGreen;
@@ -35,9 +69,11 @@ private:
     static const QString m_colorBraun;
 
     // Methods
-    void printTableHeader(const QVariantMap &account, const ColumnWidth &columnWidth);
-    void printAccount(const QVariantMap &account, const ColumnWidth &columnWidth);
-    ColumnWidth getTableLayout(const QList<QVariantMap> &accountList);
+    void printMessage(const QString &message, const QString &colorName);
+    QStringList printedColumns(const QVariantMap &account) const;
+    void printTable(const QList<QVariantMap> &accountList);
+    void fixTableLayout();
+    void writeRecords(const QList<QVariantMap> &accountList);
 };
 
 #endif // CONSOLEINTERFACE_H
@@ -0,0 +1,231 @@
+#include "recordwriter.h"
+#include <cmath>
+
+static const char HexDigits[] = "0123456789abcdef";
+
+// Constructor
+RecordWriter::RecordWriter() :
+    m_format(Table)
+{
+}
+
+/**
+ * Static
+ * Translates the name of a format as given on the command line.
+ * @param name          'table', 'jsonl', 'csv' or 'tsv'.
+ * @param format        Takes the format.
+ * @return              False if the name is unknown.
+ */
+bool RecordWriter::formatFromName(const QString &name, Format &format)
+{
+    QString lowerName = name.toLower();
+    if (lowerName == QString("table")) {
+        format = Table;
+    } else if (lowerName == QString("jsonl") || lowerName == QString("json")) {
+        format = JsonLines;
+    } else if (lowerName == QString("csv")) {
+        format = Csv;
+    } else if (lowerName == QString("tsv")) {
+        format = Tsv;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Appends the header line for CSV and TSV. JSON Lines has no header.
+ * @param buffer
+ */
+void RecordWriter::appendHeader(QString &buffer) const
+{
+    if (m_format != Csv && m_format != Tsv) {
+        return;
+    }
+    for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal) {
+        if (ordinal > 0) {
+            buffer.append(m_format == Csv ? QChar(',') : QChar('\t'));
+        }
+        if (m_format == Csv) {
+            appendCsvField(m_columnList[ordinal], buffer);
+        } else {
+            appendTsvField(m_columnList[ordinal], buffer);
+        }
+    }
+    buffer.append('\n');
+}
+
+/**
+ * Appends one account as a line in the current format.
+ * @param account
+ * @param buffer
+ */
+void RecordWriter::appendRow(const QVariantMap &account, QString &buffer) const
+{
+    if (m_format == JsonLines) {
+        buffer.append('{');
+        for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal) {
+            if (ordinal > 0) {
+                buffer.append(',');
+            }
+            appendJsonString(m_columnList[ordinal], buffer);
+            buffer.append(':');
+            appendJsonValue(account.value(m_columnList[ordinal]), buffer);
+        }
+        buffer.append('}').append('\n');
+        return;
+    }
+    for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal) {
+        QString text = account.value(m_columnList[ordinal]).toString();
+        if (m_format == Csv) {
+            if (ordinal > 0) {
+                buffer.append(',');
+            }
+            appendCsvField(text, buffer);
+        } else {
+            if (ordinal > 0) {
+                buffer.append('\t');
+            }
+            appendTsvField(text, buffer);
+        }
+    }
+    buffer.append('\n');
+}
+
+/**
+ * Private
+ * Appends a value as JSON. Numbers and booleans keep their type. NaN
+ * and infinity have no JSON number and are written as null.
+ * Everything else is written as string.
+ * @param value
+ * @param buffer
+ */
+void RecordWriter::appendJsonValue(const QVariant &value, QString &buffer) const
+{
+    if (value.isNull()) {
+        buffer.append(QLatin1String("null"));
+        return;
+    }
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        buffer.append(value.toString());
+        break;
+    case QVariant::Double:
+    case static_cast<QVariant::Type>(QMetaType::Float):
+        if (std::isfinite(value.toDouble())) {
+            buffer.append(value.toString());
+        } else {
+            buffer.append(QLatin1String("null"));
+        }
+        break;
+    case QVariant::Bool:
+        buffer.append(value.toBool() ? QLatin1String("true") : QLatin1String("false"));
+        break;
+    default:
+        appendJsonString(value.toString(), buffer);
+        break;
+    }
+}
+
+/**
+ * Private
+ * Appends a quoted JSON string. Quote, backslash and control
+ * characters are escaped.
+ * @param text
+ * @param buffer
+ */
+void RecordWriter::appendJsonString(const QString &text, QString &buffer) const
+{
+    buffer.append('"');
+    for (const QChar& character : text) {
+        ushort code = character.unicode();
+        switch (code) {
+        case '"':
+            buffer.append(QLatin1String("\\\""));
+            break;
+        case '\\':
+            buffer.append(QLatin1String("\\\\"));
+            break;
+        case '\n':
+            buffer.append(QLatin1String("\\n"));
+            break;
+        case '\r':
+            buffer.append(QLatin1String("\\r"));
+            break;
+        case '\t':
+            buffer.append(QLatin1String("\\t"));
+            break;
+        default:
+            if (code < 0x20) {
+                buffer.append(QLatin1String("\\u00"));
+                buffer.append(QChar(HexDigits[code >> 4])).append(QChar(HexDigits[code & 0x0f]));
+            } else {
+                buffer.append(character);
+            }
+            break;
+        }
+    }
+    buffer.append('"');
+}
+
+/**
+ * Private
+ * Appends a CSV field. Quotes the field if needed and doubles quotes.
+ * @param text
+ * @param buffer
+ */
+void RecordWriter::appendCsvField(const QString &text, QString &buffer) const
+{
+    bool needsQuotes = false;
+    for (const QChar& character : text) {
+        if (character == ',' || character == '"' || character == '\n' || character == '\r') {
+            needsQuotes = true;
+            break;
+        }
+    }
+    if (! needsQuotes) {
+        buffer.append(text);
+        return;
+    }
+    buffer.append('"');
+    for (const QChar& character : text) {
+        if (character == '"') {
+            buffer.append('"');
+        }
+        buffer.append(character);
+    }
+    buffer.append('"');
+}
+
+/**
+ * Private
+ * Appends a TSV field with tab, line breaks and backslash escaped.
+ * @param text
+ * @param buffer
+ */
+void RecordWriter::appendTsvField(const QString &text, QString &buffer) const
+{
+    for (const QChar& character : text) {
+        switch (character.unicode()) {
+        case '\t':
+            buffer.append(QLatin1String("\\t"));
+            break;
+        case '\n':
+            buffer.append(QLatin1String("\\n"));
+            break;
+        case '\r':
+            buffer.append(QLatin1String("\\r"));
+            break;
+        case '\\':
+            buffer.append(QLatin1String("\\\\"));
+            break;
+        default:
+            buffer.append(character);
+            break;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef RECORDWRITER_H
+#define RECORDWRITER_H
+
+/* ---------------------------------------------------------------------------
+ * Class RecordWriter
+ * ---------------------------------------------------------------------------
+ * Writes Account objects in a machine readable format:
+ * - JSON Lines: one JSON object per line. Numbers and booleans are
+ *   written as JSON values, empty values, NaN and infinity as null.
+ * - CSV: RFC 4180. A header line with the column names. Fields with a
+ *   comma, a quote or a line break are quoted.
+ * - TSV: a header line. Tab, line breaks and backslash are escaped
+ *   as \t, \n, \r and \\.
+ * There is no pre-pass over the rows. Each row is escaped character by
+ * character straight into the caller's buffer, so the buffer can be
+ * reused for each batch without further allocations.
+ */
+
+#include <QStringList>
+#include <QVariantMap>
+
+class RecordWriter
+{
+public:
+    enum Format { Table, JsonLines, Csv, Tsv };
+
+    RecordWriter();
+
+    static bool formatFromName(const QString& name, Format& format);
+    void setFormat(const Format format)                 { m_format = format; }
+    Format format() const                               { return m_format; }
+    void setColumns(const QStringList& columnList)      { m_columnList = columnList; }
+    bool hasColumns() const                             { return ! m_columnList.isEmpty(); }
+
+    void appendHeader(QString& buffer) const;
+    void appendRow(const QVariantMap& account, QString& buffer) const;
+
+private:
+    Format m_format;
+    QStringList m_columnList;
+
+    void appendJsonValue(const QVariant& value, QString& buffer) const;
+    void appendJsonString(const QString& text, QString& buffer) const;
+    void appendCsvField(const QString& text, QString& buffer) const;
+    void appendTsvField(const QString& text, QString& buffer) const;
+};
+
+#endif // RECORDWRITER_H
@@ -0,0 +1,182 @@
+#include "tablerenderer.h"
+
+// Constructor
+TableRenderer::TableRenderer() :
+    m_maxCellWidth(0),
+    m_isFixed(false)
+{
+}
+
+/**
+ * Sets the printed columns in their order. Drops all rows, widths,
+ * limits and uncut columns. The minimum width of a column is the length
+ * of its name.
+ * @param columnList
+ */
+void TableRenderer::setColumns(const QStringList &columnList)
+{
+    m_columnList = columnList;
+    m_widthList.fill(0, columnList.size());
+    m_limitList.fill(0, columnList.size());
+    m_uncutList.fill(false, columnList.size());
+    for (int ordinal=0; ordinal<columnList.size(); ++ordinal) {
+        m_widthList[ordinal] = columnList[ordinal].length();
+    }
+    m_arena.clear();
+    m_cellEndList.clear();
+    m_isFixed = false;
+}
+
+/**
+ * Gives a column a fixed width. Cells are cut to that width.
+ * @param column
+ * @param width
+ */
+void TableRenderer::setColumnLimit(const QString &column, const int width)
+{
+    int ordinal = m_columnList.indexOf(column);
+    if (ordinal >= 0) {
+        m_limitList[ordinal] = width;
+        m_widthList[ordinal] = qMax(width, column.length());
+    }
+}
+
+/**
+ * Never cuts the cells of a column. A cut password or answer would be
+ * shown as a wrong value. Longer cells overflow the column width.
+ * @param column
+ */
+void TableRenderer::setColumnUncut(const QString &column)
+{
+    int ordinal = m_columnList.indexOf(column);
+    if (ordinal >= 0) {
+        m_uncutList[ordinal] = true;
+    }
+}
+
+/**
+ * Converts the cells of an account to text and appends them to the arena.
+ * The width of columns without limit grows with the text until the
+ * widths are fixed. Columns missing in the account are empty.
+ * @param account
+ */
+void TableRenderer::appendRow(const QVariantMap &account)
+{
+    for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal) {
+        int begin = m_arena.size();
+        m_arena.append(account.value(m_columnList[ordinal]).toString());
+        m_cellEndList << m_arena.size();
+        if (! m_isFixed && m_limitList[ordinal] == 0) {
+            int length = m_arena.size() - begin;
+            if (m_maxCellWidth > 0) {
+                length = qMin(length, m_maxCellWidth);
+            }
+            m_widthList[ordinal] = qMax(m_widthList[ordinal], length);
+        }
+    }
+}
+
+/**
+ * Fixes the column widths. Later rows are cut to these widths.
+ */
+void TableRenderer::fixWidths()
+{
+    m_isFixed = true;
+}
+
+/**
+ * Number of rows appended but not rendered yet.
+ * @return
+ */
+int TableRenderer::pendingRowCount() const
+{
+    return m_columnList.isEmpty() ? 0 : m_cellEndList.size() / m_columnList.size();
+}
+
+/**
+ * Renders the table header into the buffer.
+ * @param buffer
+ * @param colorName         Color sequence of the column names.
+ * @param colorStandard     Color sequence after a column name.
+ */
+void TableRenderer::renderHeader(QString &buffer, const QString &colorName, const QString &colorStandard)
+{
+    updateHorzLine();
+    buffer.append('\n').append(m_horzLine);
+    buffer.append('|');
+    for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal) {
+        const QString& column = m_columnList[ordinal];
+        buffer.append(' ').append(colorName).append(column).append(colorStandard);
+        buffer.append(QString(m_widthList[ordinal] - column.length() + 1, QChar(' '))).append('|');
+    }
+    buffer.append('\n').append(m_horzLine);
+}
+
+/**
+ * Renders all pending rows into the buffer and drops them.
+ * @param buffer
+ */
+void TableRenderer::render(QString &buffer)
+{
+    updateHorzLine();
+    int rowCount = pendingRowCount();
+    buffer.reserve(buffer.size() + rowCount * m_horzLine.size() * 2);
+    const QChar* pArena = m_arena.constData();
+    int cell = 0;
+    int begin = 0;
+    for (int row=0; row<rowCount; ++row) {
+        buffer.append('|');
+        for (int ordinal=0; ordinal<m_columnList.size(); ++ordinal, ++cell) {
+            int end = m_cellEndList[cell];
+            appendCell(buffer, pArena + begin, end - begin, m_widthList[ordinal], m_uncutList[ordinal]);
+            begin = end;
+        }
+        buffer.append('\n').append(m_horzLine);
+    }
+    m_arena.clear();
+    m_cellEndList.clear();
+}
+
+/**
+ * Private
+ * Appends one cell with margins and separator. Text longer than the
+ * width is cut and marked with '~'. Unless the column is uncut.
+ * @param buffer
+ * @param pText
+ * @param length
+ * @param width
+ * @param isUncut           Longer text is written whole.
+ */
+void TableRenderer::appendCell(QString &buffer, const QChar *pText, const int length, const int width,
+                               const bool isUncut) const
+{
+    buffer.append(' ');
+    if (length > width && ! isUncut) {
+        buffer.append(pText, qMax(width - 1, 0)).append('~');
+    } else {
+        buffer.append(pText, length);
+        buffer.append(m_spaces.constData(), qMax(width - length, 0));
+    }
+    buffer.append(' ').append('|');
+}
+
+/**
+ * Private
+ * Builds the horizontal line and the fill spaces once for the current
+ * widths.
+ */
+void TableRenderer::updateHorzLine()
+{
+    int total = 1;
+    int maxWidth = 0;
+    for (int width : m_widthList) {
+        total += width + 3;
+        maxWidth = qMax(maxWidth, width);
+    }
+    if (m_spaces.size() < maxWidth) {
+        m_spaces = QString(maxWidth, QChar(' '));
+    }
+    if (m_horzLine.size() != total + 1) {
+        m_horzLine = QString(total, QChar('-')).append('\n');
+    }
+}
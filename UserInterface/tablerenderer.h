@@ -0,0 +1,57 @@
+#ifndef TABLERENDERER_H
+#define TABLERENDERER_H
+
+/* ---------------------------------------------------------------------------
+ * Class TableRenderer
+ * ---------------------------------------------------------------------------
+ * Renders Account objects into the text of an output table.
+ * Each cell is converted to text once when the row is appended. The texts
+ * of all appended rows are kept one after another in a single string (the
+ * arena) with the end offset of each cell. Column widths are kept in an
+ * array indexed by the ordinal of the column.
+ * render() writes the pending rows into one preformatted buffer and drops
+ * them from the arena. The caller writes the buffer with one call.
+ * After fixWidths() the widths do not change anymore and longer cells are
+ * cut to the column width. Cells of uncut columns (secrets like passwords)
+ * are never cut; a longer cell overflows its column.
+ */
+
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+class TableRenderer
+{
+public:
+    TableRenderer();
+
+    void setColumns(const QStringList& columnList);
+    void setColumnLimit(const QString& column, const int width);
+    void setColumnUncut(const QString& column);
+    void setMaxCellWidth(const int width)           { m_maxCellWidth = width; }
+    void appendRow(const QVariantMap& account);
+    void fixWidths();
+    bool isFixed() const                            { return m_isFixed; }
+    bool hasColumns() const                         { return ! m_columnList.isEmpty(); }
+    int pendingRowCount() const;
+
+    void renderHeader(QString& buffer, const QString& colorName, const QString& colorStandard);
+    void render(QString& buffer);
+
+private:
+    QStringList m_columnList;
+    QVector<int> m_widthList;
+    QVector<int> m_limitList;
+    QVector<bool> m_uncutList;
+    QString m_arena;
+    QVector<int> m_cellEndList;
+    QString m_horzLine;
+    QString m_spaces;
+    int m_maxCellWidth;
+    bool m_isFixed;
+
+    void appendCell(QString& buffer, const QChar* pText, const int length, const int width, const bool isUncut) const;
+    void updateHorzLine();
+};
+
+#endif // TABLERENDERER_H
@@ -0,0 +1,69 @@
+#include "startupprofile.h"
+#include <cstring>
+
+/**
+ * Constructor
+ * Starts the timer. The first phase is measured from here.
+ */
+StartupProfile::StartupProfile() :
+    m_lastMark(0),
+    m_isEnabled(false)
+{
+    m_timer.start();
+}
+
+/**
+ * Ends a phase. Does nothing if the profile is not enabled.
+ * @param phase         Name of the phase. Must be a string literal.
+ */
+void StartupProfile::mark(const char *phase)
+{
+    if (! m_isEnabled) {
+        return;
+    }
+    qint64 now = m_timer.nsecsElapsed();
+    m_phaseList.append(Phase { phase, now - m_lastMark });
+    m_lastMark = now;
+}
+
+/**
+ * One line per phase with its time in milliseconds and a line with the
+ * total time.
+ * @return
+ */
+QStringList StartupProfile::report() const
+{
+    QStringList lineList;
+    for (const Phase& phase : m_phaseList) {
+        lineList << QString("%1 %2 ms").arg(QString::fromLatin1(phase.name), -20)
+                                       .arg(phase.nsecs / 1000000.0, 9, 'f', 3);
+    }
+    lineList << QString("%1 %2 ms").arg(QString("total"), -20)
+                                   .arg(m_lastMark / 1000000.0, 9, 'f', 3);
+
+    return lineList;
+}
+
+/**
+ * Static
+ * Removes '--startup-profile' from the command line.
+ * @param argc
+ * @param argv
+ * @return          True if the switch was found.
+ */
+bool StartupProfile::takeSwitch(int &argc, char *argv[])
+{
+    bool isFound = false;
+    int target = 1;
+    for (int index=1; index<argc; ++index) {
+        if (std::strcmp(argv[index], "--startup-profile") == 0) {
+            isFound = true;
+            continue;
+        }
+        argv[target++] = argv[index];
+    }
+    argc = target;
+    argv[argc] = nullptr;
+
+    return isFound;
+}
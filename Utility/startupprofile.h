@@ -0,0 +1,44 @@
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+/* ----------------------------------------------------------------------
+ * Class StartupProfile
+ * ----------------------------------------------------------------------
+ * Measures the wall time of the phases of one application run.
+ * A phase ends with mark(). Its time is the time since the previous
+ * mark (or since construction). The switch '--startup-profile' is not
+ * a command option. takeSwitch() removes it from the command line
+ * before the options are parsed, so it works with every command.
+ */
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVector>
+
+class StartupProfile
+{
+public:
+    StartupProfile();
+
+    bool isEnabled() const                      { return m_isEnabled; }
+    void setEnabled(const bool enabled)         { m_isEnabled = enabled; }
+
+    void mark(const char* phase);
+    QStringList report() const;
+
+    static bool takeSwitch(int& argc, char* argv[]);
+
+private:
+    struct Phase
+    {
+        const char* name;
+        qint64 nsecs;
+    };
+
+    QElapsedTimer m_timer;
+    qint64 m_lastMark;
+    bool m_isEnabled;
+    QVector<Phase> m_phaseList;
+};
+
+#endif // STARTUPPROFILE_H
@@ -3,6 +3,16 @@
 #include "SearchAccount/matchstring.h"
 #include "Utility/sortlist.h"
 #include "SearchAccount/matchobject.h"
+#include "Audit/auditengine.h"
+#include "Audit/breachedcorpus.h"
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+// Options of all columns of an Account object.
+static const char accountOptions[] = { 'i', 'p', 'u', 'k', 'q', 'r', 'l', 's', 't' };
+// Options of the secret columns and their placeholder in a masked listing.
+static const char secretOptions[] = { 'k', 'r' };
+static const char secretMask[] = "********";
 
 /**
  * @brief CommandProcessor::CommandProcessor
@@ -23,23 +33,48 @@ CommandProcessor::CommandProcessor(ConsoleInterface &iface, Persistence *databas
  */
 void CommandProcessor::process(AppCommand::Command command, OptionTable &optionTable)
 {
+    if (optionTable.contains('F') && ! m_userInterface.setOutputFormat(optionTable.take('F').toString())) {
+        m_userInterface.printError("Unknown output format ! Use table, jsonl, csv or tsv.");
+        return;
+    }
     switch (command) {
     case AppCommand::New: {
+        BreachedCorpus corpus;
+        if (! openBreachedCorpus(optionTable, corpus)) {
+            return;
+        }
+        // An upsert keeps the password of an existing account if none is given.
+        bool isUpsert = optionTable.contains('Y');
+        optionTable.remove('Y');
+        QList<char> insertOnlyList;
         if (!optionTable.contains('k')) {
-            PwGenerator pwGenerator;
+            insertOnlyList << 'k';
             int passwordLength = optionTable.value('l').toInt();
             QString characterDefinition = optionTable.value('s').toString();
-            QString password = pwGenerator.passwordFromDefinition(static_cast<ushort>(passwordLength), characterDefinition);
-            if (pwGenerator.hasError()) {
-                m_userInterface.printError(pwGenerator.errorMessage());
+            QStringList passwordList = generatePasswords(1, passwordLength, characterDefinition, corpus);
+            if (passwordList.isEmpty()) {
                 return;
             }
-            optionTable.insert('k', QVariant(password));
+            optionTable.insert('k', QVariant(passwordList.first()));
+        } else if (corpus.contains(optionTable.value('k').toString())) {
+            m_userInterface.printError("The password is in the list of breached passwords !");
+            return;
         }
         optionTable.insert('t', QVariant(QDateTime::currentDateTime()));
-        bool result = m_pDatabase->persistAccountObject(optionTable);
+        bool result = false;
+        QString successMsg("Account successfully persisted.\n");
+        if (isUpsert) {
+            Persistence::UpsertResult upsert = m_pDatabase->upsertAccountObject(optionTable, insertOnlyList);
+            result = (upsert != Persistence::UpsertFailed);
+            if (upsert == Persistence::UpsertUpdated) {
+                successMsg = QString("Existing account successfully updated.\n");
+            }
+        } else {
+            result = m_pDatabase->persistAccountObject(optionTable);
+        }
         if (result) {
-            m_userInterface.printSuccessMsg("Account successfully persisted.\n");
+            m_userInterface.printSuccessMsg(successMsg);
+            // Read after a write goes to the primary. A replica may not have the account yet.
             QVariantMap account = m_pDatabase->findAccount(optionTable);
             m_userInterface.printSingleAccount(account);
         } else {
@@ -49,15 +84,56 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         break;
     }
     case AppCommand::Show: {
-        QList<QVariantMap> list = m_pDatabase->findAccountsLike(optionTable);
+        FilterExpression filter;
+        AccountPage page;
+        QStringList maskedList;
+        QHash<QString, QVariantMap> revealedTable;
+        if (! parseFilter(optionTable, filter) || ! parsePage(optionTable, page) ||
+            ! maskSecrets(optionTable, maskedList, revealedTable)) {
+            return;
+        }
+        // Rows are printed while they are read. Small batches keep the
+        // first row fast and the memory use independent of the result.
+        int rowCount = 0;
+        QVariantMap lastAccount;
+        QString idName = m_pDatabase->optionToRealName('i');
+        m_userInterface.beginAccountTable();
+        m_pDatabase->streamAccountsWhere(optionTable, filter, page, [&](const QList<QVariantMap>& accountList) {
+            if (maskedList.isEmpty()) {
+                m_userInterface.printAccountRows(accountList);
+            } else {
+                QList<QVariantMap> maskedAccountList(accountList);
+                for (QVariantMap& account : maskedAccountList) {
+                    QVariantMap secrets = revealedTable.value(account.value(idName).toString());
+                    for (const QString& name : maskedList) {
+                        account.insert(name, secrets.isEmpty() ? QVariant(QString(secretMask)) : secrets.value(name));
+                    }
+                }
+                m_userInterface.printAccountRows(maskedAccountList);
+            }
+            rowCount += accountList.size();
+            lastAccount = accountList.last();
+            return true;
+        }, m_showBatchSize);
+        // The rows read before an error are still printed.
+        m_userInterface.endAccountTable();
         if (m_pDatabase->hasError()) {
             m_userInterface.printError(m_pDatabase->error());
             break;
         }
-        m_userInterface.printAccountList(list);
+        if (page.limit > 0 && rowCount == page.limit) {
+            QString key = pageKey(lastAccount, page);
+            if (! key.isEmpty()) {
+                m_userInterface.printNextPageKey(key);
+            }
+        }
         break;
     }
     case AppCommand::Remove: {
+        if (optionTable.contains('w')) {
+            changeAccountsWhere(command, optionTable);
+            break;
+        }
         int rowsRemoved = m_pDatabase->deleteAccountObject(optionTable);
         if (m_pDatabase->hasError()) {
             m_userInterface.printError(m_pDatabase->error());
@@ -69,8 +145,13 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
     }
     case AppCommand::Modify: {
         optionTable.insert('t', QDateTime::currentDateTime());
+        if (optionTable.contains('w')) {
+            changeAccountsWhere(command, optionTable);
+            break;
+        }
         if (m_pDatabase->modifyAccountObject(optionTable)) {
             m_userInterface.printSuccessMsg("Account object successfully updated.\n");
+            // Read after a write goes to the primary. A replica may still have the old values.
             QVariantMap account = m_pDatabase->findAccount(optionTable);
             m_userInterface.printSingleAccount(account);
         } else {
@@ -80,6 +161,19 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         break;
     }
     case AppCommand::GeneratePW: {
+        BreachedCorpus corpus;
+        if (! openBreachedCorpus(optionTable, corpus)) {
+            return;
+        }
+        // Bulk generation. Passwords are printed and not stored.
+        if (optionTable.contains('c')) {
+            int count = optionTable.value('c').toInt();
+            int length = optionTable.value('l', QVariant(PwGenerator().standardLength())).toInt();
+            QString definition = optionTable.value('s').toString();
+            QStringList passwordList = generatePasswords(count, length, definition, corpus);
+            m_userInterface.printPasswordList(passwordList);
+            return;
+        }
         // If not have new password definition then get it from m_pDatabase.
         if (! optionTable.contains('l') || ! optionTable.contains('s')) {
             OptionTable searchObj(optionTable);
@@ -99,13 +193,11 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         }
         int length = optionTable.value('l').toInt();
         QString definition = optionTable.value('s').toString();
-        PwGenerator generator;
-        QString password = generator.passwordFromDefinition(length, definition);
-        if (generator.hasError()) {
-            m_userInterface.printError(generator.errorMessage());
+        QStringList passwordList = generatePasswords(1, length, definition, corpus);
+        if (passwordList.isEmpty()) {
             return;
         }
-        optionTable.insert('k', password);
+        optionTable.insert('k', passwordList.first());
         optionTable.insert('t', QDateTime::currentDateTime());
         if (m_pDatabase->modifyAccountObject(optionTable)) {
             m_userInterface.printSuccessMsg("New password generated and stored into m_pDatabase.\n");
@@ -115,23 +207,59 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         }
         break;
     }
-    case AppCommand::File:
+    case AppCommand::File: {
+        QString filePath = optionTable.value('f').toString();
         // Store data to file.
         if (optionTable.contains('o')) {
+            QList<QVariantMap> accountList = m_pDatabase->allPersistedAccounts();
+            if (m_pDatabase->hasError()) {
+                m_userInterface.printError(m_pDatabase->error());
+                return;
+            }
+            FilePersistence filePersist;
+            bool result = false;
             if (optionTable.contains('v')) {
                 // Human readable file.
-                QList<QVariantMap> accountList = m_pDatabase->allPersistedAccounts();
-                FilePersistence filePersist;
-                filePersist.persistReadableFile(optionTable.value('f').toString(), accountList);
+                result = filePersist.persistReadableFile(filePath, accountList);
             } else {
-                // Store data NOT human readable.
+                // Store data NOT human readable. Encrypted vault.
+                QString passphrase = vaultPassphrase(true);
+                if (passphrase.isEmpty()) {
+                    return;
+                }
+                result = filePersist.persistEncryptedFile(filePath, passphrase, accountList);
+            }
+            if (! result) {
+                m_userInterface.printError(filePersist.error());
+                return;
             }
+            m_userInterface.printSuccessMsg(QString("%1 accounts written to file.\n").arg(accountList.size()));
         }
         // Read data from file.
         if (optionTable.contains('g')) {
-            // ...
+            QString passphrase = vaultPassphrase(false);
+            if (passphrase.isEmpty()) {
+                return;
+            }
+            FilePersistence filePersist;
+            QList<QVariantMap> accountList;
+            if (optionTable.contains('R')) {
+                QVariantMap account = filePersist.readEncryptedRecord(filePath, passphrase,
+                                                                      optionTable.value('R').toInt());
+                if (! account.isEmpty()) {
+                    accountList << account;
+                }
+            } else {
+                accountList = filePersist.readEncryptedFile(filePath, passphrase);
+            }
+            if (filePersist.hasError()) {
+                m_userInterface.printError(filePersist.error());
+                return;
+            }
+            m_userInterface.printAccountList(accountList);
         }
         break;
+    }
     case AppCommand::Find: {
         QStringList list = optionTable.value('?').toStringList();
         QString searchMask = (list.isEmpty()) ? QString() : list[0];
@@ -143,6 +271,10 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         readProvider.insert('i', QVariant());
         readProvider.insert('p', QVariant());
         QList<QVariantMap> providerList = m_pDatabase->findAccountsLike(readProvider);
+        if (m_pDatabase->hasError()) {
+            m_userInterface.printError(m_pDatabase->error());
+            break;
+        }
         MatchString match(searchMask.toLower());
         SortList<MatchObject> sortList;
         for (int index=0; index<providerList.size(); ++index) {
@@ -181,7 +313,611 @@ void CommandProcessor::process(AppCommand::Command command, OptionTable &optionT
         m_userInterface.printSingleAccount(user);
         break;
     }
+    case AppCommand::Rotate:
+        rotatePasswords(optionTable);
+        break;
+    case AppCommand::Audit:
+        auditAccounts(optionTable);
+        break;
+    case AppCommand::Migrate:
+        migrateSchema(optionTable);
+        break;
     default:
         break;
     }
 }
+
+/**
+ * Private
+ * Get the passphrase of an encrypted vault file. It is taken from
+ * the environment variable PWMANAGER_PASSPHRASE if set. Otherwise
+ * the user is asked for it, twice for a new vault. An empty or not
+ * repeated passphrase is rejected with an error message.
+ * @param isNewVault        True if the vault is written.
+ * @return passphrase       The passphrase. Or an empty string.
+ */
+QString CommandProcessor::vaultPassphrase(const bool isNewVault)
+{
+    QString passphrase = qEnvironmentVariable("PWMANAGER_PASSPHRASE");
+    if (! passphrase.isEmpty()) {
+        return passphrase;
+    }
+    passphrase = m_userInterface.readPassphrase(QString("Passphrase of vault file: "));
+    if (passphrase.isEmpty()) {
+        m_userInterface.printError("The passphrase must not be empty !\n");
+        return QString();
+    }
+    if (isNewVault && m_userInterface.readPassphrase(QString("Repeat passphrase: ")) != passphrase) {
+        m_userInterface.printError("The passphrases do not match !\n");
+        return QString();
+    }
+
+    return passphrase;
+}
+
+/**
+ * Private
+ * Generates new passwords for all stale accounts of the user. Each
+ * password is generated from the length and definition stored with
+ * the account. Generation runs in parallel on the global thread pool.
+ * The new passwords are written back in batched transactions. The
+ * accounts are selected by days or provider pattern. All accounts are
+ * only rotated with option 'a' and a confirmation.
+ * @param optionTable
+ */
+void CommandProcessor::rotatePasswords(const OptionTable &optionTable)
+{
+    bool hasSelection = optionTable.contains('d') || optionTable.contains('p');
+    if (! hasSelection && ! optionTable.contains('a')) {
+        m_userInterface.printError("Select the accounts with --days or --provider. Or all with --all !\n");
+        return;
+    }
+    if (! hasSelection && ! optionTable.contains('D')
+            && ! m_userInterface.readConfirmation(QString("Rotate the passwords of ALL accounts?"))) {
+        return;
+    }
+    QList<QVariantMap> accountList = staleAccounts(optionTable);
+    if (m_pDatabase->hasError()) {
+        m_userInterface.printError(m_pDatabase->error());
+        return;
+    }
+    if (optionTable.contains('D')) {
+        m_userInterface.printAccountList(accountList);
+        return;
+    }
+
+    struct RotateJob {
+        QVariant id;
+        int length;
+        QString definition;
+        QString password;
+        QString error;
+    };
+    QVector<RotateJob> jobList(accountList.size());
+    for (int index=0; index<accountList.size(); ++index) {
+        const QVariantMap& account = accountList[index];
+        jobList[index].id = account.value(m_pDatabase->optionToRealName('i'));
+        jobList[index].length = account.value(m_pDatabase->optionToRealName('l')).toInt();
+        jobList[index].definition = account.value(m_pDatabase->optionToRealName('s')).toString();
+    }
+    QtConcurrent::blockingMap(jobList, [](RotateJob& job) {
+        PwGenerator generator;
+        job.password = generator.passwordFromDefinition(static_cast<ushort>(job.length), job.definition);
+        if (generator.hasError()) {
+            job.error = generator.errorMessage();
+        }
+    });
+
+    QVariant userId = optionTable.value('U');
+    QDateTime now = QDateTime::currentDateTime();
+    QList<OptionTable> modificationList;
+    QList<QVariantMap> rotatedList;
+    for (int index=0; index<jobList.size(); ++index) {
+        const RotateJob& job = jobList[index];
+        if (! job.error.isEmpty()) {
+            m_userInterface.printWarnings(QString("Account %1 skipped: %2").arg(job.id.toString(), job.error));
+            continue;
+        }
+        QVariantMap rotated;
+        const char shownList[] = { 'i', 'p', 'u' };
+        for (const char option : shownList) {
+            QString columnName = m_pDatabase->optionToRealName(option);
+            rotated.insert(columnName, accountList[index].value(columnName));
+        }
+        rotated.insert(m_pDatabase->optionToRealName('t'), now);
+        rotatedList << rotated;
+        OptionTable modifications;
+        modifications.insert('U', userId);
+        modifications.insert('i', job.id);
+        modifications.insert('k', job.password);
+        modifications.insert('t', now);
+        modificationList << modifications;
+    }
+    // The committed modifications are the first ones of the list.
+    int rotated = m_pDatabase->modifyAccountObjects(modificationList);
+    m_userInterface.printAccountList(rotatedList.mid(0, rotated));
+    if (m_pDatabase->hasError()) {
+        m_userInterface.printError(m_pDatabase->error());
+    }
+    m_userInterface.printSuccessMsg(QString("%1 of %2 passwords rotated.\n").arg(rotated).arg(accountList.size()));
+}
+
+/**
+ * Private
+ * Reads the accounts of the user and selects those which are stale.
+ * An account is stale if its last modify is older than the days of
+ * option 'd' or unknown. Option 'p' takes a wildcard pattern which
+ * the provider name must match.
+ * @param optionTable
+ * @return accountList      The stale accounts.
+ */
+QList<QVariantMap> CommandProcessor::staleAccounts(const OptionTable &optionTable)
+{
+    OptionTable searchObj;
+    searchObj.insert('U', optionTable.value('U'));
+    QList<char> optionList = QList<char>() << 'i' << 'p' << 'u' << 'l' << 's' << 't';
+    for (char option : optionList) {
+        searchObj.insert(option, QVariant());
+    }
+    QList<QVariantMap> accountList = m_pDatabase->findAccountsLike(searchObj);
+
+    QDateTime limit;
+    if (optionTable.contains('d')) {
+        limit = QDateTime::currentDateTime().addDays(-optionTable.value('d').toInt());
+    }
+    QRegularExpression providerPattern;
+    if (optionTable.contains('p')) {
+        QString pattern = QRegularExpression::wildcardToRegularExpression(optionTable.value('p').toString());
+        providerPattern = QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption);
+    }
+    QString lastModifyName = m_pDatabase->optionToRealName('t');
+    QString providerName = m_pDatabase->optionToRealName('p');
+    QList<QVariantMap> staleList;
+    for (const QVariantMap& account : accountList) {
+        QDateTime lastModify = account.value(lastModifyName).toDateTime();
+        if (limit.isValid() && lastModify.isValid() && lastModify >= limit) {
+            continue;
+        }
+        if (! providerPattern.pattern().isEmpty() &&
+            ! providerPattern.match(account.value(providerName).toString()).hasMatch()) {
+            continue;
+        }
+        staleList << account;
+    }
+
+    return staleList;
+}
+
+/**
+ * Private
+ * Generates passwords which are not in the list of breached passwords.
+ * Breached passwords are dropped and generated again. Prints an error
+ * if not all passwords could be generated.
+ * @param count             Number of passwords.
+ * @param length            Password length.
+ * @param definition        Password definition.
+ * @param corpus            List of breached passwords. May be closed.
+ * @return passwordList     The passwords. Empty on error.
+ */
+QStringList CommandProcessor::generatePasswords(const int count, const int length, const QString &definition,
+                                                const BreachedCorpus &corpus)
+{
+    PwGenerator generator;
+    QStringList passwordList;
+    for (int attempt=0; attempt<m_maxAttempts && passwordList.size()<count; ++attempt) {
+        QStringList candidateList = generator.passwordsFromDefinition(count - passwordList.size(),
+                                                                      static_cast<ushort>(length), definition);
+        if (generator.hasError()) {
+            m_userInterface.printError(generator.errorMessage());
+            return QStringList();
+        }
+        for (const QString& candidate : candidateList) {
+            if (! corpus.contains(candidate)) {
+                passwordList << candidate;
+            }
+        }
+    }
+    if (passwordList.size() < count) {
+        m_userInterface.printError("Could not generate passwords which are not in the list of breached passwords !");
+        return QStringList();
+    }
+
+    return passwordList;
+}
+
+/**
+ * Private
+ * Opens the list of breached passwords if option 'b' is given. Option
+ * 'B' puts the Bloom filter in front of the list.
+ * @param optionTable
+ * @param corpus            The list to open.
+ * @return                  False if the list was given but could not be opened.
+ */
+bool CommandProcessor::openBreachedCorpus(const OptionTable &optionTable, BreachedCorpus &corpus)
+{
+    if (! optionTable.contains('b')) {
+        return true;
+    }
+    if (! corpus.open(optionTable.value('b').toString())) {
+        m_userInterface.printError(corpus.error());
+        return false;
+    }
+    if (optionTable.contains('B')) {
+        if (! corpus.useBloomFilter()) {
+            m_userInterface.printWarnings("Could not use Bloom filter. Searching the list only.");
+        } else if (corpus.hasError()) {
+            m_userInterface.printWarnings(corpus.error());
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Takes the filter text of option 'w' out of the option table and
+ * parses it. The columns of the filter must be columns of an Account
+ * object.
+ * @param optionTable
+ * @param filter            Takes the parsed filter. Stays empty without option 'w'.
+ * @return                  False if the filter has an error.
+ */
+bool CommandProcessor::parseFilter(OptionTable &optionTable, FilterExpression &filter)
+{
+    if (! optionTable.contains('w')) {
+        return true;
+    }
+    if (! filter.parse(optionTable.take('w').toString())) {
+        m_userInterface.printError(filter.error());
+        return false;
+    }
+    QStringList columnList = accountColumnNames();
+    for (const QString& name : filter.columnNames()) {
+        if (! columnList.contains(name)) {
+            m_userInterface.printError(QString("Unknown column '%1' in filter ! Use one of: %2")
+                                       .arg(name, columnList.join(", ")));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Removes or modifies all accounts of the user which match the filter
+ * ('w') with one statement. Options with values are conditions of a
+ * remove and new values of a modify. The number of changed accounts is
+ * limited ('L', default m_bulkRowLimit, 0 for no limit). If more accounts
+ * match nothing is changed. Option 'D' only counts the accounts.
+ * @param command           Remove or Modify.
+ * @param optionTable
+ */
+void CommandProcessor::changeAccountsWhere(const AppCommand::Command command, OptionTable &optionTable)
+{
+    FilterExpression filter;
+    if (! parseFilter(optionTable, filter)) {
+        return;
+    }
+    bool isDryRun = optionTable.contains('D');
+    optionTable.remove('D');
+    int maxRows = m_bulkRowLimit;
+    if (optionTable.contains('L')) {
+        bool isInt = false;
+        maxRows = optionTable.take('L').toInt(&isInt);
+        if (! isInt || maxRows < 0) {
+            m_userInterface.printError("The limit must be a number of accounts or 0 for no limit !");
+            return;
+        }
+    }
+    int count = 0;
+    QString action;
+    if (command == AppCommand::Remove) {
+        count = m_pDatabase->deleteAccountsWhere(optionTable, filter, maxRows, isDryRun);
+        action = QString("removed");
+    } else {
+        if (optionTable.contains('i')) {
+            m_userInterface.printError("An id can not be set to several accounts !");
+            return;
+        }
+        count = m_pDatabase->modifyAccountsWhere(optionTable, filter, maxRows, isDryRun);
+        action = QString("modified");
+    }
+    if (m_pDatabase->hasError()) {
+        m_userInterface.printError(m_pDatabase->error());
+    } else if (isDryRun) {
+        m_userInterface.printSuccessMsg(QString("%1 accounts would be %2.\n").arg(count).arg(action));
+    } else if (maxRows > 0 && count > maxRows) {
+        m_userInterface.printError(QString("%1 accounts match, more than the limit of %2. Nothing is %3 !\n"
+                                           "Use --limit to raise the limit.").arg(count).arg(maxRows).arg(action));
+    } else {
+        m_userInterface.printSuccessMsg(QString("%1 accounts %2.\n").arg(count).arg(action));
+    }
+}
+
+/**
+ * Private
+ * Takes the page options out of the option table: the maximum number of
+ * rows ('L'), the order column ('o') and the key of the last row of the
+ * previous page ('A'). The key is the id when ordered by id. Otherwise it
+ * is the value of the order column and the id separated by the last
+ * comma. The id and the order column are added to the printed columns,
+ * so the key of the next page can be taken from the last row.
+ * @param optionTable
+ * @param page              Takes the page. Stays empty without page options.
+ * @return                  False if an option has an error.
+ */
+bool CommandProcessor::parsePage(OptionTable &optionTable, AccountPage &page)
+{
+    if (! optionTable.contains('L') && ! optionTable.contains('o') && ! optionTable.contains('A')) {
+        return true;
+    }
+    if (optionTable.contains('L')) {
+        bool isInt = false;
+        page.limit = optionTable.take('L').toInt(&isInt);
+        if (! isInt || page.limit <= 0) {
+            m_userInterface.printError("The limit must be a positive number !");
+            return false;
+        }
+    }
+    QString idName = m_pDatabase->optionToRealName('i');
+    char orderOption = 'i';
+    if (optionTable.contains('o')) {
+        QString name = optionTable.take('o').toString();
+        QStringList columnList = accountColumnNames();
+        int index = columnList.indexOf(name);
+        if (index < 0) {
+            m_userInterface.printError(QString("Unknown order column '%1' ! Use one of: %2")
+                                       .arg(name, columnList.join(", ")));
+            return false;
+        }
+        orderOption = accountOptions[index];
+        if (name != idName) {
+            page.orderBy = name;
+        }
+    }
+    if (optionTable.contains('A')) {
+        QString key = optionTable.take('A').toString();
+        QString idText = key;
+        if (! page.orderBy.isEmpty()) {
+            int separator = key.lastIndexOf(',');
+            if (separator < 0) {
+                m_userInterface.printError("The key of an ordered page is '<value>,<id>' !");
+                return false;
+            }
+            page.afterValue = key.left(separator);
+            idText = key.mid(separator + 1);
+        }
+        bool isInt = false;
+        page.afterId = idText.trimmed().toInt(&isInt);
+        if (! isInt) {
+            m_userInterface.printError(QString("Invalid id '%1' in page key !").arg(idText));
+            return false;
+        }
+    }
+    for (const char option : { 'i', orderOption }) {
+        if (! optionTable.contains(option)) {
+            optionTable.insert(option, QVariant());
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Takes the options of a masked listing out of the option table ('M' and
+ * 'R'). Secret columns which are shown but not searched are not read
+ * with the listing. Only the secrets of the accounts to reveal are read,
+ * in one query per chunk of ids. The id column is added to the printed columns to match
+ * the revealed secrets.
+ * @param optionTable
+ * @param maskedList        Takes the real names of the masked columns.
+ * @param revealedTable     Takes the secrets of the revealed accounts by id.
+ * @return                  False on error.
+ */
+bool CommandProcessor::maskSecrets(OptionTable &optionTable, QStringList &maskedList,
+                                   QHash<QString, QVariantMap> &revealedTable)
+{
+    if (! optionTable.contains('M') && ! optionTable.contains('R')) {
+        return true;
+    }
+    optionTable.remove('M');
+    QStringList idList;
+    if (optionTable.contains('R')) {
+        for (const QString& text : optionTable.take('R').toString().split(QChar(','), Qt::SkipEmptyParts)) {
+            bool isInt = false;
+            int id = text.trimmed().toInt(&isInt);
+            if (! isInt) {
+                m_userInterface.printError(QString("Invalid id '%1' to reveal !").arg(text));
+                return false;
+            }
+            idList << QString("%1=%2").arg(m_pDatabase->optionToRealName('i')).arg(id);
+        }
+    }
+    OptionTable secretObj;
+    for (const char option : secretOptions) {
+        if (optionTable.contains(option) && ! optionTable.value(option).isValid()) {
+            optionTable.remove(option);
+            secretObj.insert(option, QVariant());
+            maskedList << m_pDatabase->optionToRealName(option);
+        }
+    }
+    if (maskedList.isEmpty() || idList.isEmpty()) {
+        return true;
+    }
+    if (! optionTable.contains('i')) {
+        optionTable.insert('i', QVariant());
+    }
+    secretObj.insert('i', QVariant());
+    if (optionTable.contains('U')) {
+        secretObj.insert('U', optionTable.value('U'));
+    }
+    idList.removeDuplicates();
+    QString idName = m_pDatabase->optionToRealName('i');
+    for (int first=0; first<idList.size(); first+=m_revealChunkSize) {
+        // An empty filter would reveal all accounts. So it is an error.
+        FilterExpression revealFilter;
+        if (! revealFilter.parse(idList.mid(first, m_revealChunkSize).join(" OR ")) || revealFilter.isEmpty()) {
+            m_userInterface.printError(revealFilter.error());
+            return false;
+        }
+        m_pDatabase->streamAccountsWhere(secretObj, revealFilter, AccountPage(), [&revealedTable, &idName](const QList<QVariantMap>& accountList) {
+            for (const QVariantMap& account : accountList) {
+                revealedTable.insert(account.value(idName).toString(), account);
+            }
+            return true;
+        }, m_showBatchSize);
+        if (m_pDatabase->hasError()) {
+            m_userInterface.printError(m_pDatabase->error());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Private
+ * Get the key of a row for option '--after'.
+ * @param account           The last row of a page.
+ * @param page
+ * @return                  The key. Or an empty string if the order value is NULL.
+ */
+QString CommandProcessor::pageKey(const QVariantMap &account, const AccountPage &page) const
+{
+    QString id = account.value(m_pDatabase->optionToRealName('i')).toString();
+    if (page.orderBy.isEmpty()) {
+        return id;
+    }
+    QVariant value = account.value(page.orderBy);
+    if (value.isNull()) {
+        return QString();
+    }
+    QString valueText = (value.type() == QVariant::DateTime) ? value.toDateTime().toString(Qt::ISODateWithMs)
+                                                              : value.toString();
+
+    return valueText + ',' + id;
+}
+
+/**
+ * Private
+ * Get the real names of all columns of an Account object.
+ * The order is the order of accountOptions.
+ * @return
+ */
+QStringList CommandProcessor::accountColumnNames() const
+{
+    QStringList columnList;
+    for (const char option : accountOptions) {
+        columnList << m_pDatabase->optionToRealName(option);
+    }
+
+    return columnList;
+}
+
+/**
+ * Private
+ * Audits all accounts of the user in one pass. Finds passwords which
+ * are used by several accounts, which do not comply with the stored
+ * length and definition, which are older than some days (default 365)
+ * and optionally which are in a list of breached passwords. Passwords
+ * are never printed.
+ * @param optionTable
+ */
+void CommandProcessor::auditAccounts(const OptionTable &optionTable)
+{
+    BreachedCorpus corpus;
+    if (! openBreachedCorpus(optionTable, corpus)) {
+        return;
+    }
+    AuditEngine engine(m_pDatabase);
+    if (optionTable.contains('b')) {
+        engine.setBreachedCorpus(&corpus);
+    }
+    if (optionTable.contains('d')) {
+        engine.setStaleDays(optionTable.value('d').toInt());
+    }
+    if (! engine.run(optionTable.value('U'))) {
+        m_userInterface.printError(engine.error());
+        return;
+    }
+    printAuditFindings(QString("Accounts with breached passwords:"), engine.breachedList(), engine.breachedCount());
+    printAuditFindings(QString("Accounts with passwords not matching their definition:"),
+                       engine.policyList(), engine.policyCount());
+    printAuditFindings(QString("Oldest accounts with passwords older than %1 days:")
+                       .arg(optionTable.value('d', QVariant(365)).toInt()), engine.staleList(), engine.staleCount());
+    for (const QList<qint64>& group : engine.reuseGroupList()) {
+        QStringList idList;
+        for (qint64 accountId : group) {
+            idList << QString::number(accountId);
+        }
+        m_userInterface.printWarnings(QString("Accounts %1 share one password.").arg(idList.join(", ")));
+    }
+    if (engine.reuseGroupCount() > engine.reuseGroupList().size()) {
+        m_userInterface.printWarnings(QString("... and %1 more groups.")
+                                      .arg(engine.reuseGroupCount() - engine.reuseGroupList().size()));
+    }
+    if (engine.uncheckedReuseCount() > 0) {
+        m_userInterface.printWarnings(QString("%1 accounts were not checked for reuse.").arg(engine.uncheckedReuseCount()));
+    }
+    QString summary("%1 accounts audited: %2 breached, %3 reused in %4 groups, %5 not matching definition, %6 stale.\n");
+    m_userInterface.printSuccessMsg(summary.arg(engine.accountCount()).arg(engine.breachedCount())
+                                    .arg(engine.reusedCount()).arg(engine.reuseGroupCount())
+                                    .arg(engine.policyCount()).arg(engine.staleCount()));
+    if (optionTable.contains('T')) {
+        for (const QPair<QString, qint64>& stageTime : engine.stageTimeList()) {
+            m_userInterface.printSuccessMsg(QString("%1: %2 ms\n").arg(stageTime.first, -8).arg(stageTime.second));
+        }
+    }
+}
+
+/**
+ * Private
+ * Prints the accounts of one kind of audit finding. The list holds
+ * the reported accounts, the count all found ones.
+ * @param title
+ * @param accountList
+ * @param count
+ */
+void CommandProcessor::printAuditFindings(const QString &title, const QList<QVariantMap> &accountList, const int count)
+{
+    if (accountList.isEmpty()) {
+        return;
+    }
+    m_userInterface.printWarnings(title);
+    m_userInterface.printAccountList(accountList);
+    if (count > accountList.size()) {
+        m_userInterface.printWarnings(QString("... and %1 more.").arg(count - accountList.size()));
+    }
+}
+
+/**
+ * Private
+ * Applies the pending migrations of the database schema. With option
+ * 'v' it only checks that the statements are served by indexes.
+ * @param optionTable
+ */
+void CommandProcessor::migrateSchema(const OptionTable &optionTable)
+{
+    QStringList reportList;
+    bool isDone = false;
+    if (optionTable.contains('v')) {
+        isDone = m_pDatabase->verifySchema(reportList);
+    } else {
+        int partitionCount = optionTable.value('P', 0).toInt();
+        isDone = m_pDatabase->migrateSchema(optionTable.contains('D'), partitionCount, reportList);
+    }
+    if (! reportList.isEmpty()) {
+        m_userInterface.printSuccessMsg(reportList.join(QString()));
+    }
+    if (m_pDatabase->hasError()) {
+        m_userInterface.printError(m_pDatabase->error());
+    } else if (! isDone && reportList.isEmpty()) {
+        m_userInterface.printError("The persistence has no database schema.");
+    } else if (! isDone) {
+        m_userInterface.printError("Some statements are not served by an index !");
+    } else if (reportList.isEmpty()) {
+        m_userInterface.printSuccessMsg("The database schema is up to date.\n");
+    }
+}
@@ -6,6 +6,8 @@
 #include "PasswordGenerator/pwgenerator.h"
 #include "Persistence/persistence.h"
 
+class BreachedCorpus;
+
 class CommandProcessor
 {
 public:
@@ -13,9 +15,31 @@ public:
 
     void process(AppCommand::Command command, OptionTable& optionTable);
 
+private:
+    QString vaultPassphrase(const bool isNewVault);
+    void rotatePasswords(const OptionTable& optionTable);
+    QList<QVariantMap> staleAccounts(const OptionTable& optionTable);
+    QStringList generatePasswords(const int count, const int length, const QString& definition,
+                                  const BreachedCorpus& corpus);
+    bool openBreachedCorpus(const OptionTable& optionTable, BreachedCorpus& corpus);
+    bool parseFilter(OptionTable& optionTable, FilterExpression& filter);
+    void changeAccountsWhere(const AppCommand::Command command, OptionTable& optionTable);
+    bool parsePage(OptionTable& optionTable, AccountPage& page);
+    bool maskSecrets(OptionTable& optionTable, QStringList& maskedList, QHash<QString, QVariantMap>& revealedTable);
+    QString pageKey(const QVariantMap& account, const AccountPage& page) const;
+    QStringList accountColumnNames() const;
+    void auditAccounts(const OptionTable& optionTable);
+    void printAuditFindings(const QString& title, const QList<QVariantMap>& accountList, const int count);
+    void migrateSchema(const OptionTable& optionTable);
+
 private:
     ConsoleInterface& m_userInterface;
     Persistence* m_pDatabase;
+    static const int m_maxAttempts = 10;
+    static const int m_showBatchSize = 256;
+    static const int m_bulkRowLimit = 100;
+    // Ids per filter to reveal. Below the nesting limit of FilterExpression.
+    static const int m_revealChunkSize = 128;
 };
 
 #endif // COMMANDPROCESSOR_H
@@ -1,21 +1,40 @@
 #include "ConsoleOptions/optionparser.h"
 #include "commandprocessor.h"
 #include "Persistence/persistencefactory.h"
+#include "Utility/startupprofile.h"
 #include <QDebug>
 #include <QDateTime>
+#include <QtConcurrent>
 
 
 
+// Open connection and id of the current user.
+struct UserConnection
+{
+    Persistence* database = nullptr;
+    QVariant userId;
+    QString errorMsg;
+};
+
 // Global method
 void setAllOptions(OptionTable& optionTable);
 QVariantMap variantMapFromOptionTable(const OptionTable& table, const Persistence* db,
                                       const bool onlyValues = false, const QList<char> &removeList = QList<char>());
 OptionTable removeAllValuesExceptOf(const QList<char>& exceptionKeyList, const OptionTable& table);
 void setAttributePrintOrder(ConsoleInterface& iface, Persistence* database);
+bool isDatabaseNeeded(const AppCommand::Command command, const OptionTable& optionTable);
+bool isDatabaseLikelyNeeded(const AppCommand::Command command, const int argc, const char * const argv[]);
+bool isUserResolvedByQuery(const AppCommand::Command command);
+bool isUserNeeded(const AppCommand::Command command);
+UserConnection connectUser(const AppCommand::Command command);
+int finish(ConsoleInterface& iface, StartupProfile& profile, Persistence* database = nullptr);
 
 
 int main(int argc, char *argv[])
 {
+    // '--startup-profile' is taken before the command line is parsed.
+    StartupProfile profile;
+    profile.setEnabled(StartupProfile::takeSwitch(argc, argv));
     ConsoleInterface userInterface;
 
     // Get command (first parameter after application name)
@@ -24,58 +43,71 @@ int main(int argc, char *argv[])
     AppCommand::Command command = appCommand.command();
     if (command == AppCommand::Help) {
         userInterface.printHelp(appCommand.getHelpText());
-        return 0;
+        profile.mark("help");
+        return finish(userInterface, profile);
     }
 
     // Get options from command line input.
-    QList<OptionDefinition> optionDefinitionList = appCommand.commandsOptions();
-    OptionParser parser(optionDefinitionList, appCommand.requiredParam(), appCommand.allowedParam());
-    OptionTable optionTable = parser.parseParameter(argc, argv, 2);
+    // Options are parsed in a worker thread while this thread connects to the
+    // database. A Qt SQL connection may only be used by the thread which has
+    // created it. So the connection stays in the main thread.
+    OptionParser parser(appCommand.commandsOptions(), appCommand.requiredParam(), appCommand.allowedParam());
+    QFuture<OptionTable> parsing = QtConcurrent::run([&parser, &appCommand, argc, argv]() {
+        OptionTable optionTable = parser.parseParameter(argc, argv, 2);
+        if (parser.hasError()) {
+            return optionTable;
+        }
+        appCommand.takeSwitches(optionTable);
+        // If option '-a' is set.
+        // This option must be replaced with all available options for the command.
+        if (appCommand.isOptionAllSet()) {
+            setAllOptions(optionTable);
+        }
+        return optionTable;
+    });
+
+    // Open database and check current user.
+    UserConnection connection;
+    if (isDatabaseLikelyNeeded(command, argc, argv)) {
+        connection = connectUser(command);
+        profile.mark("connect, find user");
+    }
+    OptionTable optionTable = parsing.result();
+    profile.mark("parse options");
     if (parser.hasError()) {
         userInterface.printError(parser.errorMsg());
-        userInterface.printHelp(appCommand.getHelpText(optionDefinitionList));
-        return 0;
+        userInterface.printHelp(appCommand.getHelpText(true));
+        return finish(userInterface, profile, connection.database);
     }
 
     // Need help?
-    // Handle help before open database because it is not required for help text.
-    if (command == AppCommand::Help || appCommand.isHelpNeeded()) {
-        userInterface.printHelp(appCommand.getHelpText(optionDefinitionList));
-        return 0;
+    if (appCommand.isHelpNeeded()) {
+        userInterface.printHelp(appCommand.getHelpText(true));
+        profile.mark("help");
+        return finish(userInterface, profile, connection.database);
     }
 
-    // If option '-a' is set.
-    // This option must be replaced with all available options for the command.
-    if (appCommand.isOptionAllSet()) {
-        setAllOptions(optionTable);
+    // Commands without database do not load the driver, read the
+    // credentials or look up the user.
+    if (! isDatabaseNeeded(command, optionTable)) {
+        CommandProcessor processor(userInterface, nullptr);
+        processor.process(command, optionTable);
+        profile.mark("command");
+        return finish(userInterface, profile, connection.database);
     }
 
-    // Open database
-    Persistence* database = PersistenceFactory::createPersistence(PersistenceFactory::SqlPostgre);
-    if (! database->open()) {
-        userInterface.printError(database->error());
-        delete database;
-        return 0;
+    // The command line was not conclusive. Connect now.
+    if (connection.database == nullptr) {
+        connection = connectUser(command);
+        profile.mark("connect, find user");
     }
-
-    // Check current user. (WhoAmI)
-    char* username = getenv("USER");
-    if (! username) {
-        username = getenv("USERNAME");
+    if (! connection.errorMsg.isEmpty()) {
+        userInterface.printError(connection.errorMsg);
+        return finish(userInterface, profile, connection.database);
     }
-    OptionTable userInfo;
-    userInfo.insert('n', QVariant(QString(username)));
-    userInfo.insert('i', QVariant());
-    QVariantMap userData = database->findUser(userInfo);
-    if (database->hasError()) {
-        userInterface.printError(database->error());
-        return 0;
-    }
-    if (userData.isEmpty()) {
-        userInterface.printError("You are not registered in this application.");
-        return 0;
-    }
-    optionTable.insert('U', userData.value(database->optionToRealName('i')));
+    Persistence* database = connection.database;
+    // An invalid user id selects the column. The database finds the user.
+    optionTable.insert('U', connection.userId);
 
     // Get print order for console interface.
     setAttributePrintOrder(userInterface, database);
@@ -83,12 +115,13 @@ int main(int argc, char *argv[])
     // Execute command
     CommandProcessor processor(userInterface, database);
     processor.process(command, optionTable);
+    profile.mark("command");
 
     // Close open persistence.
     database->close();
-    delete database;
+    profile.mark("close database");
 
-    return 0;
+    return finish(userInterface, profile, database);
 }
 
 
@@ -120,4 +153,139 @@ void setAttributePrintOrder(ConsoleInterface& iface, Persistence* database) {
         printOrder << database->optionToRealName(optionList[index]);
     }
     iface.setPrintOrderList(printOrder);
+    iface.setSecretColumns(QStringList() << database->optionToRealName('k') << database->optionToRealName('r'));
+}
+
+/**
+ * Some commands can be executed without database. Help is handled
+ * before. 'generatepw --count' only prints new passwords.
+ * @param command
+ * @param optionTable
+ * @return
+ */
+bool isDatabaseNeeded(const AppCommand::Command command, const OptionTable &optionTable)
+{
+    if (command == AppCommand::GeneratePW && optionTable.contains('c')) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Guesses from the raw command line if the command will need the database.
+ * It is used to start the connection before the options are parsed. A wrong
+ * guess costs time but no correctness. isDatabaseNeeded() decides later.
+ * @param command
+ * @param argc
+ * @param argv
+ * @return
+ */
+bool isDatabaseLikelyNeeded(const AppCommand::Command command, const int argc, const char * const argv[])
+{
+    for (int index=2; index<argc; ++index) {
+        QByteArray parameter(argv[index]);
+        if (parameter == "-h" || parameter == "--help") {
+            return false;
+        }
+        if (command == AppCommand::GeneratePW && (parameter.startsWith("-c") || parameter.startsWith("--count"))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Commands whose statements can find the current user by name. They do
+ * not need a separate query for the user.
+ * @param command
+ * @return
+ */
+bool isUserResolvedByQuery(const AppCommand::Command command)
+{
+    switch (command) {
+    case AppCommand::New:
+    case AppCommand::Show:
+    case AppCommand::Modify:
+    case AppCommand::Remove:
+    case AppCommand::Find:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Commands which work on the database itself. They run before the tables
+ * of the users exist, so the current user is not looked up.
+ * @param command
+ * @return
+ */
+bool isUserNeeded(const AppCommand::Command command)
+{
+    return command != AppCommand::Migrate;
+}
+
+/**
+ * Opens the database and finds the current user. (WhoAmI)
+ * The user is taken from environment variable USER or USERNAME.
+ * If the persistence can find the user within the statements of the
+ * command the user id stays invalid. An unknown user is reported by the
+ * statement then.
+ * @param command
+ * @return          The open persistence and the user id. Or an error message.
+ */
+UserConnection connectUser(const AppCommand::Command command)
+{
+    UserConnection connection;
+    connection.database = PersistenceFactory::createPersistence(PersistenceFactory::databaseType());
+    if (! connection.database->open()) {
+        connection.errorMsg = connection.database->error();
+        return connection;
+    }
+    if (! isUserNeeded(command)) {
+        return connection;
+    }
+    char* username = getenv("USER");
+    if (! username) {
+        username = getenv("USERNAME");
+    }
+    if (isUserResolvedByQuery(command) && connection.database->resolveUserByName(QString(username))) {
+        return connection;
+    }
+    OptionTable userInfo;
+    userInfo.insert('n', QVariant(QString(username)));
+    userInfo.insert('i', QVariant());
+    QVariantMap userData = connection.database->findUser(userInfo);
+    if (connection.database->hasError()) {
+        connection.errorMsg = connection.database->error();
+    } else if (userData.isEmpty()) {
+        connection.errorMsg = QString("You are not registered in this application.");
+    } else {
+        connection.userId = userData.value(connection.database->optionToRealName('i'));
+    }
+
+    return connection;
+}
+
+/**
+ * Ends the application. Closes and deletes the persistence and prints the timing
+ * report if '--startup-profile' was given.
+ * @param iface
+ * @param profile
+ * @param database      Persistence or nullptr.
+ * @return              Exit code of the application.
+ */
+int finish(ConsoleInterface &iface, StartupProfile &profile, Persistence *database)
+{
+    if (database != nullptr && database->isOpen()) {
+        database->close();
+    }
+    delete database;
+    if (profile.isEnabled()) {
+        iface.printProfile(profile.report());
+    }
+
+    return 0;
 }